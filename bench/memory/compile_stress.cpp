@@ -0,0 +1,134 @@
+// Compiles one shader over and over with a single Compiler, the way a long running process
+// such as the compile server does, and checks that resident memory stays flat.
+//
+// Usage: compile_stress <shader> [compiles] [max growth in MB]
+//
+// Resident memory is sampled once the first compiles have warmed up glslang's tables and
+// pools, and again at the end. Exits with 1 if any compile fails or resident memory grew by
+// more than the given amount, 4 MB by default.
+
+#include "compiler.h"
+#include "profile.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const size_t s_warmupCompiles = 100;
+static const size_t s_sampleInterval = 1000;
+
+static std::shared_ptr<const std::string> ReadFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+    return std::make_shared<const std::string>(
+        std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>()
+    );
+}
+
+static EShLanguage StageFromFileName(const std::filesystem::path& path) {
+    static const std::map<std::string, EShLanguage> s_stages = {
+        { ".vert", EShLangVertex },         { ".tesc", EShLangTessControl },
+        { ".tese", EShLangTessEvaluation }, { ".geom", EShLangGeometry },
+        { ".frag", EShLangFragment },       { ".comp", EShLangCompute },
+    };
+    auto stage = s_stages.find(path.extension().string());
+    return stage != s_stages.end() ? stage->second : EShLangVertex;
+}
+
+static double Megabytes(int64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <shader> [compiles] [max growth in MB]\n", argv[0]);
+        return 1;
+    }
+
+    std::filesystem::path shaderPath = argv[1];
+    size_t compiles = argc > 2 ? strtoull(argv[2], nullptr, 10) : 10000;
+    double maxGrowth = argc > 3 ? atof(argv[3]) : 4.0;
+    if (compiles <= s_warmupCompiles) {
+        fprintf(stderr, "Need more than %zu compiles\n", s_warmupCompiles);
+        return 1;
+    }
+
+    std::shared_ptr<const std::string> source = ReadFile(shaderPath);
+    if (!source) {
+        fprintf(stderr, "Failed to open %s\n", shaderPath.string().c_str());
+        return 1;
+    }
+
+    // Includes are read once and shared by every compile, like glslop's include cache.
+    std::mutex includesMutex;
+    std::map<std::string, std::shared_ptr<const std::string>> includes;
+
+    CompileRequest request;
+    request.stages.push_back({ StageFromFileName(shaderPath), shaderPath.string(), *source });
+    request.includeResolver = [&](
+                                  const std::string& headerName,
+                                  const std::string& includerName
+                              ) -> std::optional<ResolvedInclude> {
+        std::filesystem::path directory = std::filesystem::path(includerName).parent_path();
+        std::string path = (directory / headerName).lexically_normal().string();
+
+        std::lock_guard<std::mutex> lock(includesMutex);
+        std::shared_ptr<const std::string>& contents = includes[path];
+        if (!contents) {
+            contents = ReadFile(path);
+            if (!contents) {
+                fprintf(stderr, "Failed to open include file %s\n", path.c_str());
+                return std::nullopt;
+            }
+        }
+        return ResolvedInclude { path, contents };
+    };
+
+    Compiler compiler;
+    int64_t warmResidentBytes = 0;
+
+    for (size_t i = 0; i < compiles; i++) {
+        CompileResult result = compiler.compile(request);
+        if (!result.success()) {
+            fprintf(stderr, "Compile %zu failed:\n%s", i, result.log.c_str());
+            return 1;
+        }
+
+        if (i + 1 == s_warmupCompiles) {
+            warmResidentBytes = ResidentBytes();
+        }
+        if ((i + 1) % s_sampleInterval == 0) {
+            printf("%8zu compiles: %.1f MB resident\n", i + 1, Megabytes(ResidentBytes()));
+        }
+    }
+
+    int64_t residentBytes = ResidentBytes();
+    double growth = Megabytes(residentBytes - warmResidentBytes);
+    printf(
+        "%zu compiles of %s: %.1f MB resident after warmup, %.1f MB at the end (%+.1f MB), "
+        "peak %.1f MB\n",
+        compiles,
+        shaderPath.string().c_str(),
+        Megabytes(warmResidentBytes),
+        Megabytes(residentBytes),
+        growth,
+        Megabytes(PeakResidentBytes())
+    );
+
+    if (residentBytes == 0) {
+        printf("Resident memory can't be read on this platform\n");
+    } else if (growth > maxGrowth) {
+        fprintf(stderr, "Resident memory grew by more than %.1f MB\n", maxGrowth);
+        return 1;
+    }
+
+    return 0;
+}
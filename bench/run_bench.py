@@ -0,0 +1,288 @@
+#!/usr/bin/env python3
+"""Benchmarks glslop on the shader corpus in bench/shaders.
+
+Measures:
+  - throughput in shaders per second over the whole corpus, both cold and with a warm
+    compile cache,
+  - the latency of each compile phase, from glslop's --time-report,
+  - the size of every generated header,
+  - how long a C or C++ compiler takes to compile each generated header.
+
+Results are written as JSON. Pass --baseline with the results of an earlier run to print
+how the headline numbers changed, and --max-regression to fail when any got worse by more
+than the given percentage.
+
+Arguments after -- are passed to glslop, e.g. `-- -O -f string`.
+"""
+
+import argparse
+import datetime
+import json
+import os
+import platform
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+STAGE_EXTENSIONS = (".vert", ".tesc", ".tese", ".geom", ".frag", ".comp")
+
+
+def find_shaders(corpus):
+    shaders = []
+    for root, _, files in os.walk(corpus):
+        for name in files:
+            if name.endswith(STAGE_EXTENSIONS):
+                shaders.append(os.path.relpath(os.path.join(root, name), corpus))
+    return sorted(shaders)
+
+
+def header_name(shader):
+    return shader.replace(os.sep, "_").replace(".", "_") + ".h"
+
+
+def write_response_file(path, corpus, shaders, output_dir):
+    with open(path, "w") as file:
+        for shader in shaders:
+            input_path = os.path.join(corpus, shader)
+            output_path = os.path.join(output_dir, header_name(shader))
+            file.write('"{}" -o "{}"\n'.format(input_path, output_path))
+
+
+def run_glslop(glslop, args):
+    start = time.perf_counter()
+    result = subprocess.run([glslop] + args, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    elapsed = time.perf_counter() - start
+    if result.returncode != 0:
+        sys.stderr.write(result.stdout.decode(errors="replace"))
+        raise SystemExit("glslop failed with exit code {}".format(result.returncode))
+    return elapsed
+
+
+def measure_throughput(glslop, args, shader_count, iterations):
+    times = [run_glslop(glslop, args) for _ in range(iterations)]
+    median = statistics.median(times)
+    return {
+        "minSeconds": min(times),
+        "medianSeconds": median,
+        "shadersPerSecond": shader_count / median if median > 0 else 0.0,
+    }
+
+
+def measure_phases(glslop, args, report_path):
+    report_args = ["-j", "1", "--time-report", "json", "--time-report-file", report_path]
+    run_glslop(glslop, args + report_args)
+    with open(report_path) as file:
+        report = json.load(file)
+
+    phases = {}
+    for phase in report["phases"]:
+        phases[phase["phase"]] = {
+            "count": phase["count"],
+            "totalMicroseconds": phase["totalMicroseconds"],
+            "meanMicroseconds": phase["totalMicroseconds"] / max(phase["count"], 1),
+            "maxMicroseconds": phase["maxMicroseconds"],
+            "maxHeapDelta": phase["maxHeapDelta"],
+        }
+
+    return phases, report["peakResidentBytes"]
+
+
+def measure_headers(shaders, output_dir, work_dir, compiler, language, iterations):
+    extension = ".c" if language == "c" else ".cpp"
+    files = []
+
+    for shader in shaders:
+        header = os.path.join(output_dir, header_name(shader))
+        entry = {"shader": shader, "bytes": os.path.getsize(header)}
+
+        if compiler:
+            source = os.path.join(work_dir, "tu_" + header_name(shader) + extension)
+            with open(source, "w") as file:
+                # Nothing else is included, so any header that isn't self-contained fails.
+                file.write("#include \"{}\"\n".format(header))
+
+            command = [compiler, "-x", language, "-c", source, "-o", os.devnull]
+            times = []
+            for _ in range(iterations):
+                start = time.perf_counter()
+                result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+                times.append(time.perf_counter() - start)
+
+            entry["compiled"] = result.returncode == 0
+            entry["compileSeconds"] = min(times)
+            if result.returncode != 0:
+                entry["compileErrors"] = result.stdout.decode(errors="replace")
+
+        files.append(entry)
+
+    headers = {
+        "totalBytes": sum(entry["bytes"] for entry in files),
+        "files": files,
+    }
+    if compiler:
+        headers["compiler"] = compiler
+        headers["language"] = language
+        headers["totalCompileSeconds"] = sum(entry["compileSeconds"] for entry in files)
+        headers["failedCompiles"] = sum(1 for entry in files if not entry["compiled"])
+
+    return headers
+
+
+def git_commit():
+    try:
+        result = subprocess.run(
+            ["git", "-C", BENCH_DIR, "rev-parse", "HEAD"],
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+        )
+        return result.stdout.decode().strip() or None
+    except OSError:
+        return None
+
+
+# Headline numbers compared against a baseline, with whether higher is better.
+def headline_metrics(results):
+    metrics = {
+        "cold shaders/s": (results["cold"]["shadersPerSecond"], True),
+        "warm cache shaders/s": (results["warmCache"]["shadersPerSecond"], True),
+        "header bytes": (results["headers"]["totalBytes"], False),
+    }
+    if "totalCompileSeconds" in results["headers"]:
+        metrics["header compile s"] = (results["headers"]["totalCompileSeconds"], False)
+    for name, phase in results["phases"].items():
+        metrics[name + " mean us"] = (phase["meanMicroseconds"], False)
+    return metrics
+
+
+def compare(results, baseline, max_regression):
+    current = headline_metrics(results)
+    previous = headline_metrics(baseline)
+    regressed = False
+
+    print("Compared to baseline {}:".format(baseline.get("commit") or "(unknown commit)"))
+    for name, (value, higher_is_better) in current.items():
+        if name not in previous or previous[name][0] == 0:
+            continue
+
+        change = (value - previous[name][0]) / previous[name][0] * 100.0
+        worse = -change if higher_is_better else change
+        flag = ""
+        if max_regression is not None and worse > max_regression:
+            flag = "  REGRESSION"
+            regressed = True
+        print("  {:<24} {:>14.2f} -> {:>14.2f} ({:+.1f}%){}".format(
+            name, previous[name][0], value, change, flag))
+
+    return not regressed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--glslop", required=True, help="path to the glslop executable")
+    parser.add_argument("--corpus", default=os.path.join(BENCH_DIR, "shaders"),
+                        help="directory of shaders to compile (default: bench/shaders)")
+    parser.add_argument("--iterations", type=int, default=5,
+                        help="runs over the corpus per measurement (default: 5)")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1,
+                        help="glslop worker threads (default: all cores)")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"),
+                        help="compiler for the generated headers, '' to skip (default: $CC or cc)")
+    parser.add_argument("--language", choices=("c", "c++"), default="c",
+                        help="language to compile the generated headers as (default: c)")
+    parser.add_argument("--output", help="write results as JSON to this file")
+    parser.add_argument("--baseline", help="results of an earlier run to compare against")
+    parser.add_argument("--max-regression", type=float,
+                        help="fail if a headline number is this many percent worse than baseline")
+    parser.add_argument("glslop_args", nargs=argparse.REMAINDER,
+                        help="extra glslop arguments, after --")
+    options = parser.parse_args()
+
+    glslop_args = options.glslop_args
+    if glslop_args and glslop_args[0] == "--":
+        glslop_args = glslop_args[1:]
+
+    corpus = os.path.abspath(options.corpus)
+    shaders = find_shaders(corpus)
+    if not shaders:
+        raise SystemExit("No shaders found in {}".format(corpus))
+
+    work_dir = tempfile.mkdtemp(prefix="glslop-bench-")
+    try:
+        output_dir = os.path.join(work_dir, "out")
+        cache_dir = os.path.join(work_dir, "cache")
+        os.makedirs(output_dir)
+
+        response_file = os.path.join(work_dir, "inputs.rsp")
+        write_response_file(response_file, corpus, shaders, output_dir)
+        args = ["@" + response_file, "-j", str(options.jobs)] + glslop_args
+
+        cold = measure_throughput(glslop=options.glslop, args=args,
+                                  shader_count=len(shaders), iterations=options.iterations)
+
+        cached_args = args + ["--cache-dir", cache_dir]
+        run_glslop(options.glslop, cached_args)
+        warm = measure_throughput(glslop=options.glslop, args=cached_args,
+                                  shader_count=len(shaders), iterations=options.iterations)
+
+        phases, peak_resident_bytes = measure_phases(
+            options.glslop, args, os.path.join(work_dir, "report.json"))
+
+        compiler = options.cc if options.cc and shutil.which(options.cc) else None
+        if options.cc and not compiler:
+            print("Compiler {} not found, skipping header compile times".format(options.cc))
+        headers = measure_headers(shaders, output_dir, work_dir, compiler, options.language,
+                                  iterations=3)
+    finally:
+        shutil.rmtree(work_dir, ignore_errors=True)
+
+    results = {
+        "schema": 1,
+        "timestamp": datetime.datetime.now(datetime.timezone.utc).isoformat(),
+        "commit": git_commit(),
+        "platform": platform.platform(),
+        "cpuCount": os.cpu_count(),
+        "glslopArgs": glslop_args,
+        "jobs": options.jobs,
+        "iterations": options.iterations,
+        "corpus": {
+            "shaders": len(shaders),
+            "sourceBytes": sum(os.path.getsize(os.path.join(corpus, s)) for s in shaders),
+        },
+        "cold": cold,
+        "warmCache": warm,
+        "phases": phases,
+        "peakResidentBytes": peak_resident_bytes,
+        "headers": headers,
+    }
+
+    print("{} shaders: {:.1f} shaders/s cold, {:.1f} shaders/s with a warm cache".format(
+        len(shaders), cold["shadersPerSecond"], warm["shadersPerSecond"]))
+    for name, phase in phases.items():
+        print("  {:<12} {:>10.1f} us mean {:>10.1f} us max".format(
+            name, phase["meanMicroseconds"], phase["maxMicroseconds"]))
+    print("Headers: {} bytes".format(headers["totalBytes"]), end="")
+    if compiler:
+        print(", {:.3f} s to compile, {} failed".format(
+            headers["totalCompileSeconds"], headers["failedCompiles"]), end="")
+    print()
+
+    if options.output:
+        with open(options.output, "w") as file:
+            json.dump(results, file, indent=2)
+            file.write("\n")
+
+    if options.baseline:
+        with open(options.baseline) as file:
+            baseline = json.load(file)
+        if not compare(results, baseline, options.max_regression):
+            return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,70 @@
+// Reads a pack back through the header glslop generated for it, as an engine would, and
+// checks every module: that glslop_pack_find finds it by the hash of its name, that its
+// SPIR-V starts with the SPIR-V magic number and that its blobs lie within the pack.
+//
+// Usage: read_pack <pack>
+
+#include "shaders_pack.h"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+
+static const uint32_t s_spirvMagic = 0x07230203;
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <pack>\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file.is_open()) {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return 1;
+    }
+    std::string contents(std::istreambuf_iterator<char>(file), {});
+
+    // Readers need 8-byte alignment, which mmap would give.
+    std::vector<uint64_t> data((contents.size() + 7) / 8);
+    memcpy(data.data(), contents.data(), contents.size());
+    size_t size = contents.size();
+
+    uint32_t count = 0;
+    const glslop_pack_entry* entries = glslop_pack_entries(data.data(), size, &count);
+    if (!entries) {
+        fprintf(stderr, "%s: not a pack of version %d\n", argv[1], GLSLOP_PACK_VERSION);
+        return 1;
+    }
+
+    int failures = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const glslop_pack_entry* entry = &entries[i];
+        const char* name = glslop_pack_name(data.data(), entry);
+
+        if (glslop_pack_find(data.data(), size, glslop_pack_hash(name)) != entry) {
+            fprintf(stderr, "%s: not found by its name hash\n", name);
+            failures++;
+        }
+
+        if (entry->spirv_offset > size || entry->spirv_size > size - entry->spirv_offset ||
+            entry->reflection_offset > size ||
+            entry->reflection_size > size - entry->reflection_offset) {
+            fprintf(stderr, "%s: blobs out of bounds\n", name);
+            failures++;
+            continue;
+        }
+
+        if (entry->spirv_size < 4 || entry->spirv_size % 4 != 0 ||
+            glslop_pack_spirv(data.data(), entry)[0] != s_spirvMagic) {
+            fprintf(stderr, "%s: not SPIR-V\n", name);
+            failures++;
+        }
+    }
+
+    printf("%s: read %u modules, %d failed\n", argv[1], count, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#version 450
+
+layout(location = 0) in vec2 inUv;
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D hdrColor;
+layout(set = 0, binding = 1) uniform sampler2D bloom;
+layout(set = 0, binding = 2) uniform sampler3D colorGrade;
+
+layout(set = 0, binding = 3) uniform TonemapParams {
+    float exposure;
+    float bloomStrength;
+    float gamma;
+    float vignette;
+    vec3 whitePoint;
+    int gradeEnabled;
+} params;
+
+vec3 Aces(vec3 x) {
+    const float a = 2.51;
+    const float b = 0.03;
+    const float c = 2.43;
+    const float d = 0.59;
+    const float e = 0.14;
+    return clamp((x * (a * x + b)) / (x * (c * x + d) + e), 0.0, 1.0);
+}
+
+void main() {
+    vec3 color = texture(hdrColor, inUv).rgb;
+    color += texture(bloom, inUv).rgb * params.bloomStrength;
+    color *= params.exposure;
+    color = Aces(color / params.whitePoint);
+
+    if (params.gradeEnabled != 0) {
+        color = texture(colorGrade, color).rgb;
+    }
+
+    vec2 centered = inUv - 0.5;
+    color *= 1.0 - dot(centered, centered) * params.vignette;
+
+    outColor = vec4(pow(color, vec3(1.0 / params.gamma)), 1.0);
+}
@@ -0,0 +1,49 @@
+#ifndef BRDF_GLSL
+#define BRDF_GLSL
+
+#include "common.glsl"
+
+float DistributionGgx(float nDotH, float roughness) {
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float d = nDotH * nDotH * (a2 - 1.0) + 1.0;
+    return a2 / (PI * d * d);
+}
+
+float VisibilitySmithGgxCorrelated(float nDotV, float nDotL, float roughness) {
+    float a2 = roughness * roughness * roughness * roughness;
+    float ggxV = nDotL * sqrt(nDotV * nDotV * (1.0 - a2) + a2);
+    float ggxL = nDotV * sqrt(nDotL * nDotL * (1.0 - a2) + a2);
+    return 0.5 / max(ggxV + ggxL, EPSILON);
+}
+
+vec3 FresnelSchlick(float vDotH, vec3 f0) {
+    return f0 + (1.0 - f0) * pow(1.0 - vDotH, 5.0);
+}
+
+vec3 EvaluateBrdf(
+    vec3 normal,
+    vec3 view,
+    vec3 light,
+    vec3 albedo,
+    float metallic,
+    float roughness
+) {
+    vec3 halfway = normalize(view + light);
+    float nDotV = max(dot(normal, view), EPSILON);
+    float nDotL = Saturate(dot(normal, light));
+    float nDotH = Saturate(dot(normal, halfway));
+    float vDotH = Saturate(dot(view, halfway));
+
+    vec3 f0 = mix(vec3(0.04), albedo, metallic);
+    vec3 fresnel = FresnelSchlick(vDotH, f0);
+    float distribution = DistributionGgx(nDotH, roughness);
+    float visibility = VisibilitySmithGgxCorrelated(nDotV, nDotL, roughness);
+
+    vec3 specular = distribution * visibility * fresnel;
+    vec3 diffuse = (1.0 - fresnel) * (1.0 - metallic) * albedo * INV_PI;
+
+    return (diffuse + specular) * nDotL;
+}
+
+#endif
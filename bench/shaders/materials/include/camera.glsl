@@ -0,0 +1,16 @@
+#ifndef CAMERA_GLSL
+#define CAMERA_GLSL
+
+layout(set = 0, binding = 0) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseViewProjection;
+    vec3 position;
+    float time;
+    vec2 viewportSize;
+    float nearPlane;
+    float farPlane;
+} camera;
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef COMMON_GLSL
+#define COMMON_GLSL
+
+const float PI = 3.14159265359;
+const float INV_PI = 0.31830988618;
+const float EPSILON = 1e-5;
+
+float Saturate(float x) {
+    return clamp(x, 0.0, 1.0);
+}
+
+vec3 Saturate(vec3 x) {
+    return clamp(x, vec3(0.0), vec3(1.0));
+}
+
+float Luminance(vec3 color) {
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+vec3 SrgbToLinear(vec3 color) {
+    return mix(
+        color / 12.92,
+        pow((color + 0.055) / 1.055, vec3(2.4)),
+        greaterThan(color, vec3(0.04045))
+    );
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef LIGHTING_GLSL
+#define LIGHTING_GLSL
+
+#include "common.glsl"
+
+const uint LIGHT_DIRECTIONAL = 0;
+const uint LIGHT_POINT = 1;
+const uint LIGHT_SPOT = 2;
+
+struct Light {
+    vec3 position;
+    float range;
+    vec3 direction;
+    float spotAngleScale;
+    vec3 color;
+    float spotAngleOffset;
+    uint type;
+    uint shadowIndex;
+    float intensity;
+    float padding;
+};
+
+layout(set = 0, binding = 1) readonly buffer LightBuffer {
+    uint lightCount;
+    uint directionalCount;
+    Light lights[];
+} lightBuffer;
+
+layout(set = 0, binding = 2) uniform sampler2DArrayShadow shadowMaps;
+
+layout(set = 0, binding = 3) uniform ShadowData {
+    mat4 lightViewProjection[4];
+    vec4 cascadeSplits;
+    float bias;
+    float normalBias;
+    float softness;
+    int cascadeCount;
+} shadows;
+
+float Attenuation(Light light, vec3 toLight) {
+    if (light.type == LIGHT_DIRECTIONAL) {
+        return 1.0;
+    }
+
+    float distanceSquared = dot(toLight, toLight);
+    float factor = distanceSquared / (light.range * light.range);
+    float smoothFactor = Saturate(1.0 - factor * factor);
+    float attenuation = smoothFactor * smoothFactor / max(distanceSquared, 1e-4);
+
+    if (light.type == LIGHT_SPOT) {
+        float cd = dot(normalize(-toLight), light.direction);
+        float spot = Saturate(cd * light.spotAngleScale + light.spotAngleOffset);
+        attenuation *= spot * spot;
+    }
+
+    return attenuation;
+}
+
+float SampleShadow(vec3 worldPosition, float viewDepth) {
+    int cascade = 0;
+    for (int i = 0; i < shadows.cascadeCount - 1; i++) {
+        if (viewDepth > shadows.cascadeSplits[i]) {
+            cascade = i + 1;
+        }
+    }
+
+    vec4 shadowPosition = shadows.lightViewProjection[cascade] * vec4(worldPosition, 1.0);
+    shadowPosition.xyz /= shadowPosition.w;
+    vec2 uv = shadowPosition.xy * 0.5 + 0.5;
+
+    float shadow = 0.0;
+    vec2 texel = 1.0 / vec2(textureSize(shadowMaps, 0).xy);
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            vec2 offset = vec2(x, y) * texel * shadows.softness;
+            shadow += texture(
+                shadowMaps,
+                vec4(uv + offset, float(cascade), shadowPosition.z - shadows.bias)
+            );
+        }
+    }
+
+    return shadow / 9.0;
+}
+
+#endif
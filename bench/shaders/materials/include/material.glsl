@@ -0,0 +1,22 @@
+#ifndef MATERIAL_GLSL
+#define MATERIAL_GLSL
+
+layout(set = 1, binding = 0) uniform MaterialParams {
+    vec4 baseColorFactor;
+    vec3 emissiveFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    float normalScale;
+    float occlusionStrength;
+    float alphaCutoff;
+    vec2 uvScale;
+    vec2 uvOffset;
+} material;
+
+layout(set = 1, binding = 1) uniform sampler2D baseColorTexture;
+layout(set = 1, binding = 2) uniform sampler2D normalTexture;
+layout(set = 1, binding = 3) uniform sampler2D metallicRoughnessTexture;
+layout(set = 1, binding = 4) uniform sampler2D occlusionTexture;
+layout(set = 1, binding = 5) uniform sampler2D emissiveTexture;
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SURFACE_GLSL
+#define SURFACE_GLSL
+
+#include "common.glsl"
+#include "camera.glsl"
+#include "lighting.glsl"
+#include "brdf.glsl"
+
+layout(location = 0) in vec3 inWorldPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec4 inTangent;
+layout(location = 3) in vec2 inUv;
+layout(location = 4) in float inViewDepth;
+
+layout(location = 0) out vec4 outColor;
+
+struct Surface {
+    vec3 albedo;
+    float alpha;
+    vec3 normal;
+    float metallic;
+    vec3 emissive;
+    float roughness;
+    float occlusion;
+};
+
+vec3 PerturbNormal(vec3 tangentNormal) {
+    vec3 normal = normalize(inNormal);
+    vec3 tangent = normalize(inTangent.xyz);
+    vec3 bitangent = cross(normal, tangent) * inTangent.w;
+    return normalize(mat3(tangent, bitangent, normal) * tangentNormal);
+}
+
+vec3 ShadeSurface(Surface surface) {
+    vec3 view = normalize(camera.position - inWorldPosition);
+    vec3 color = vec3(0.0);
+
+    for (uint i = 0; i < lightBuffer.lightCount; i++) {
+        Light light = lightBuffer.lights[i];
+
+        vec3 toLight = light.type == LIGHT_DIRECTIONAL ? -light.direction
+                                                       : light.position - inWorldPosition;
+        float attenuation = Attenuation(light, toLight);
+        if (attenuation <= 0.0) {
+            continue;
+        }
+
+        float shadow = 1.0;
+        if (light.shadowIndex != 0xffffffffu) {
+            shadow = SampleShadow(inWorldPosition, inViewDepth);
+        }
+
+        vec3 radiance = light.color * light.intensity * attenuation * shadow;
+        color += EvaluateBrdf(
+                     surface.normal,
+                     view,
+                     normalize(toLight),
+                     surface.albedo,
+                     surface.metallic,
+                     surface.roughness
+                 ) *
+                 radiance;
+    }
+
+    vec3 ambient = surface.albedo * 0.03 * surface.occlusion;
+    return color + ambient + surface.emissive;
+}
+
+#endif
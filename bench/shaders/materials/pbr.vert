@@ -0,0 +1,31 @@
+#version 450
+
+#include "include/camera.glsl"
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec4 inTangent;
+layout(location = 3) in vec2 inUv;
+
+layout(location = 0) out vec3 outWorldPosition;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec4 outTangent;
+layout(location = 3) out vec2 outUv;
+layout(location = 4) out float outViewDepth;
+
+layout(push_constant) uniform ObjectConstants {
+    mat4 model;
+    mat4 normalMatrix;
+    vec2 uvScale;
+    vec2 uvOffset;
+} object;
+
+void main() {
+    vec4 worldPosition = object.model * vec4(inPosition, 1.0);
+    outWorldPosition = worldPosition.xyz;
+    outNormal = mat3(object.normalMatrix) * inNormal;
+    outTangent = vec4(mat3(object.model) * inTangent.xyz, inTangent.w);
+    outUv = inUv * object.uvScale + object.uvOffset;
+    outViewDepth = -(camera.view * worldPosition).z;
+    gl_Position = camera.viewProjection * worldPosition;
+}
@@ -0,0 +1,28 @@
+#version 450
+
+#include "include/surface.glsl"
+#include "include/material.glsl"
+
+void main() {
+    vec2 uv = inUv * material.uvScale + material.uvOffset;
+
+    vec4 baseColor = texture(baseColorTexture, uv) * material.baseColorFactor;
+    if (baseColor.a < material.alphaCutoff) {
+        discard;
+    }
+
+    vec3 tangentNormal = texture(normalTexture, uv).xyz * 2.0 - 1.0;
+    tangentNormal.xy *= material.normalScale;
+    vec2 metallicRoughness = texture(metallicRoughnessTexture, uv).bg;
+
+    Surface surface;
+    surface.albedo = SrgbToLinear(baseColor.rgb);
+    surface.alpha = baseColor.a;
+    surface.normal = PerturbNormal(normalize(tangentNormal));
+    surface.metallic = metallicRoughness.x * material.metallicFactor;
+    surface.roughness = max(metallicRoughness.y * material.roughnessFactor, 0.045);
+    surface.occlusion = 1.0;
+    surface.emissive = vec3(0.0);
+
+    outColor = vec4(ShadeSurface(surface), baseColor.a);
+}
@@ -0,0 +1,24 @@
+#version 450
+
+#include "include/surface.glsl"
+#include "include/material.glsl"
+
+void main() {
+    vec2 uv = inUv * material.uvScale + material.uvOffset;
+
+    vec4 baseColor = texture(baseColorTexture, uv) * material.baseColorFactor;
+    vec3 tangentNormal = texture(normalTexture, uv).xyz * 2.0 - 1.0;
+    tangentNormal.xy *= material.normalScale;
+    vec2 metallicRoughness = texture(metallicRoughnessTexture, uv).bg;
+
+    Surface surface;
+    surface.albedo = SrgbToLinear(baseColor.rgb);
+    surface.alpha = 1.0;
+    surface.normal = PerturbNormal(normalize(tangentNormal));
+    surface.metallic = metallicRoughness.x * material.metallicFactor;
+    surface.roughness = max(metallicRoughness.y * material.roughnessFactor, 0.045);
+    surface.occlusion = mix(1.0, texture(occlusionTexture, uv).r, material.occlusionStrength);
+    surface.emissive = texture(emissiveTexture, uv).rgb * material.emissiveFactor;
+
+    outColor = vec4(ShadeSurface(surface), 1.0);
+}
@@ -0,0 +1,53 @@
+#version 450
+
+#include "include/surface.glsl"
+
+const int LAYER_COUNT = 4;
+
+layout(set = 1, binding = 0) uniform TerrainParams {
+    vec4 layerTiling[LAYER_COUNT];
+    vec4 layerTint[LAYER_COUNT];
+    float layerRoughness[LAYER_COUNT];
+    float heightBlendSharpness;
+    float macroVariationScale;
+    vec2 terrainSize;
+} terrain;
+
+layout(set = 1, binding = 1) uniform sampler2D splatMap;
+layout(set = 1, binding = 2) uniform sampler2DArray layerAlbedo;
+layout(set = 1, binding = 3) uniform sampler2DArray layerNormal;
+layout(set = 1, binding = 4) uniform sampler2D macroVariation;
+
+void main() {
+    vec2 terrainUv = inWorldPosition.xz / terrain.terrainSize;
+    vec4 weights = texture(splatMap, terrainUv);
+
+    vec3 albedo = vec3(0.0);
+    vec3 tangentNormal = vec3(0.0);
+    float roughness = 0.0;
+    float totalWeight = EPSILON;
+
+    for (int i = 0; i < LAYER_COUNT; i++) {
+        vec3 uv = vec3(inUv * terrain.layerTiling[i].xy, float(i));
+        vec4 layer = texture(layerAlbedo, uv);
+        float weight = pow(weights[i] * (layer.a + 1.0), terrain.heightBlendSharpness);
+
+        albedo += layer.rgb * terrain.layerTint[i].rgb * weight;
+        tangentNormal += (texture(layerNormal, uv).xyz * 2.0 - 1.0) * weight;
+        roughness += terrain.layerRoughness[i] * weight;
+        totalWeight += weight;
+    }
+
+    float macro = texture(macroVariation, terrainUv * terrain.macroVariationScale).r;
+
+    Surface surface;
+    surface.albedo = SrgbToLinear(albedo / totalWeight) * mix(0.8, 1.2, macro);
+    surface.alpha = 1.0;
+    surface.normal = PerturbNormal(normalize(tangentNormal / totalWeight));
+    surface.metallic = 0.0;
+    surface.roughness = roughness / totalWeight;
+    surface.occlusion = 1.0;
+    surface.emissive = vec3(0.0);
+
+    outColor = vec4(ShadeSurface(surface), 1.0);
+}
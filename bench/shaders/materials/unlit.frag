@@ -0,0 +1,14 @@
+#version 450
+
+#include "include/common.glsl"
+#include "include/material.glsl"
+
+layout(location = 3) in vec2 inUv;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec2 uv = inUv * material.uvScale + material.uvOffset;
+    vec4 color = texture(baseColorTexture, uv) * material.baseColorFactor;
+    outColor = vec4(SrgbToLinear(color.rgb) + material.emissiveFactor, color.a);
+}
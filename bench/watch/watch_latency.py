@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Measures how long glslop --watch takes to rewrite a header after one shader changes.
+
+Generates a tree of shaders that share a few includes, starts glslop --watch on all of
+them, then repeatedly edits one shader and times how long its header takes to change on
+disk. The latency includes the watch debounce. Fails if the median is over --target-ms.
+"""
+
+import argparse
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+INCLUDE_COUNT = 16
+
+
+def shader_source(index, value):
+    return (
+        "#version 450\n"
+        "#include \"common/shade{}.glsl\"\n"
+        "layout(location = 0) out vec4 color;\n"
+        "void main() {{\n"
+        "    color = shade(vec4({}.0));\n"
+        "}}\n"
+    ).format(index % INCLUDE_COUNT, value)
+
+
+def write_tree(work_dir, shader_count):
+    os.makedirs(os.path.join(work_dir, "shaders", "common"))
+    os.makedirs(os.path.join(work_dir, "out"))
+
+    for index in range(INCLUDE_COUNT):
+        path = os.path.join(work_dir, "shaders", "common", "shade{}.glsl".format(index))
+        with open(path, "w") as file:
+            file.write("vec4 shade(vec4 value) {{ return value * {}.0; }}\n".format(index + 1))
+
+    shaders = []
+    with open(os.path.join(work_dir, "inputs.rsp"), "w") as response:
+        for index in range(shader_count):
+            shader = os.path.join(work_dir, "shaders", "s{}.frag".format(index))
+            header = os.path.join(work_dir, "out", "s{}.h".format(index))
+            with open(shader, "w") as file:
+                file.write(shader_source(index, 0))
+            response.write('"{}" -o "{}"\n'.format(shader, header))
+            shaders.append((shader, header))
+
+    return shaders
+
+
+def stamp(path):
+    try:
+        status = os.stat(path)
+    except FileNotFoundError:
+        return None
+    return (status.st_mtime_ns, status.st_size)
+
+
+def wait_for(condition, timeout):
+    deadline = time.perf_counter() + timeout
+    while not condition():
+        if time.perf_counter() > deadline:
+            return False
+        time.sleep(0.001)
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--glslop", required=True, help="path to the glslop executable")
+    parser.add_argument("--shaders", type=int, default=1000,
+                        help="shaders in the watched tree (default: 1000)")
+    parser.add_argument("--edits", type=int, default=20,
+                        help="single-shader edits to time (default: 20)")
+    parser.add_argument("--target-ms", type=float, default=100.0,
+                        help="fail if the median latency is over this (default: 100)")
+    parser.add_argument("--timeout", type=float, default=600.0,
+                        help="seconds to wait for the first compile of the tree (default: 600)")
+    options = parser.parse_args()
+
+    work_dir = tempfile.mkdtemp(prefix="glslop-watch-")
+    process = None
+    try:
+        shaders = write_tree(work_dir, options.shaders)
+        process = subprocess.Popen(
+            [options.glslop, "@" + os.path.join(work_dir, "inputs.rsp"), "--watch"],
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
+        )
+
+        start = time.perf_counter()
+        if not wait_for(lambda: all(stamp(h) for _, h in shaders), options.timeout):
+            raise SystemExit("glslop didn't write every header within {} s".format(
+                options.timeout))
+        print("Compiled {} shaders in {:.2f} s".format(
+            len(shaders), time.perf_counter() - start))
+        # Lets the watch settle before the first edit.
+        time.sleep(1.0)
+
+        latencies = []
+        for edit in range(options.edits):
+            shader, header = shaders[edit * 37 % len(shaders)]
+            before = stamp(header)
+            with open(shader, "w") as file:
+                file.write(shader_source(edit * 37 % len(shaders), edit + 1))
+            start = time.perf_counter()
+            if not wait_for(lambda: stamp(header) != before, 10.0):
+                raise SystemExit("{} didn't change within 10 s of editing {}".format(
+                    header, shader))
+            latencies.append((time.perf_counter() - start) * 1000.0)
+            # Keeps edits apart, so that each is debounced on its own.
+            time.sleep(0.2)
+    finally:
+        if process:
+            process.terminate()
+            process.wait()
+        shutil.rmtree(work_dir, ignore_errors=True)
+
+    median = statistics.median(latencies)
+    print("Change to header over {} edits: {:.1f} ms median, {:.1f} ms max".format(
+        len(latencies), median, max(latencies)))
+
+    if median > options.target_ms:
+        print("Median is over the {:.0f} ms target".format(options.target_ms))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
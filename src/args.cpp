@@ -0,0 +1,686 @@
+#include "args.h"
+#include "log.h"
+#include "permutation.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string_view>
+#include <thread>
+
+#include <stdlib.h>
+
+uint64_t Args::parseSize(const std::string& size) {
+    char* end = nullptr;
+    unsigned long long value = strtoull(size.c_str(), &end, 10);
+    if (end == size.c_str()) {
+        return 0;
+    }
+
+    std::string_view suffix = end;
+    if (suffix == "" || suffix == "B") {
+        return value;
+    } else if (suffix == "K" || suffix == "KB") {
+        return value << 10;
+    } else if (suffix == "M" || suffix == "MB") {
+        return value << 20;
+    } else if (suffix == "G" || suffix == "GB") {
+        return value << 30;
+    }
+
+    return 0;
+}
+
+EShLanguage Args::guessStageFromFileName(const std::string& fileName) {
+    if (fileName.find(".vert") != std::string::npos) {
+        return EShLanguage::EShLangVertex;
+    } else if (fileName.find(".tesc") != std::string::npos) {
+        return EShLanguage::EShLangTessControl;
+    } else if (fileName.find(".tese") != std::string::npos) {
+        return EShLanguage::EShLangTessEvaluation;
+    } else if (fileName.find(".geom") != std::string::npos) {
+        return EShLanguage::EShLangGeometry;
+    } else if (fileName.find(".frag") != std::string::npos) {
+        return EShLanguage::EShLangFragment;
+    } else if (fileName.find(".comp") != std::string::npos) {
+        return EShLanguage::EShLangCompute;
+    } else {
+        return EShLanguage::EShLangVertex; // default to vertex shader
+    }
+}
+
+std::string Args::defaultOutputFile(const std::string& inputFile) {
+    size_t lastSlash = inputFile.find_last_of("/\\");
+    size_t lastDot = inputFile.find_last_of(".");
+    if (lastDot == std::string::npos) {
+        lastDot = inputFile.size();
+    }
+
+    if (lastSlash == std::string::npos) {
+        lastSlash = 0;
+    } else {
+        lastSlash++;
+    }
+
+    size_t start = lastSlash;
+    size_t end = lastDot;
+
+    return inputFile.substr(start, end - start) + ".h";
+}
+
+std::vector<std::string> Args::splitResponseLine(const std::string& line) {
+    std::vector<std::string> result;
+    std::string current;
+    bool inQuotes = false;
+    bool hasArg = false;
+
+    for (char c : line) {
+        if (c == '"') {
+            inQuotes = !inQuotes;
+            hasArg = true;
+        } else if (!inQuotes && (c == ' ' || c == '\t' || c == '\r')) {
+            if (hasArg) {
+                result.push_back(current);
+                current.clear();
+                hasArg = false;
+            }
+        } else {
+            current += c;
+            hasArg = true;
+        }
+    }
+
+    if (hasArg) {
+        result.push_back(current);
+    }
+
+    return result;
+}
+
+bool Args::parseInputOption(
+    const std::vector<std::string>& args,
+    size_t& i,
+    InputOptions& options
+) {
+    std::string_view arg = args[i];
+
+    if (arg == "-o" || arg == "--output") {
+        if (i + 1 < args.size()) {
+            options.outputFile = args[++i];
+        } else {
+            Print("No output file specified\n");
+            throw ArgsExit { 1 };
+        }
+    } else if (arg == "-s" || arg == "--stage") {
+        if (i + 1 < args.size()) {
+            std::string_view stageStr = args[++i];
+            if (stageStr == "vert" || stageStr == "vertex") {
+                options.stage = EShLanguage::EShLangVertex;
+            } else if (stageStr == "tesc") {
+                options.stage = EShLanguage::EShLangTessControl;
+            } else if (stageStr == "tese") {
+                options.stage = EShLanguage::EShLangTessEvaluation;
+            } else if (stageStr == "geom" || stageStr == "geometry") {
+                options.stage = EShLanguage::EShLangGeometry;
+            } else if (stageStr == "frag" || stageStr == "fragment") {
+                options.stage = EShLanguage::EShLangFragment;
+            } else if (stageStr == "comp" || stageStr == "compute") {
+                options.stage = EShLanguage::EShLangCompute;
+            } else {
+                Print("Unknown stage %s\n", stageStr.data());
+                throw ArgsExit { 1 };
+            }
+        } else {
+            Print("No stage specified\n");
+            throw ArgsExit { 1 };
+        }
+    } else if (arg == "-n" || arg == "--name") {
+        if (i + 1 < args.size()) {
+            options.name = args[++i];
+        } else {
+            Print("No shader name specified\n");
+            throw ArgsExit { 1 };
+        }
+    } else if (arg == "-p" || arg == "--prefix") {
+        if (i + 1 < args.size()) {
+            options.structPrefix = args[++i];
+        } else {
+            Print("No struct prefix specified\n");
+            throw ArgsExit { 1 };
+        }
+    } else if (arg == "-g" || arg == "--global-prefix") {
+        if (i + 1 < args.size()) {
+            options.globalPrefix = args[++i];
+        } else {
+            Print("No global prefix specified\n");
+            throw ArgsExit { 1 };
+        }
+    } else if (arg == "-MD") {
+        options.writeDepFile = true;
+    } else if (arg == "-MF") {
+        if (i + 1 < args.size()) {
+            options.depFile = args[++i];
+        } else {
+            Print("No dependency file specified\n");
+            throw ArgsExit { 1 };
+        }
+    } else if (arg == "--permutations") {
+        if (i + 1 < args.size()) {
+            options.permutationFile = args[++i];
+        } else {
+            Print("No permutation file specified\n");
+            throw ArgsExit { 1 };
+        }
+    } else if (arg == "--vertex-format") {
+        if (i + 1 < args.size()) {
+            std::string_view vertexFormat = args[++i];
+            size_t equals = vertexFormat.find('=');
+            std::optional<VertexFormat> format;
+            if (equals != std::string::npos) {
+                format = ParseVertexFormat(vertexFormat.substr(equals + 1));
+            }
+            if (!format) {
+                Print("Invalid vertex format %s\n", vertexFormat.data());
+                throw ArgsExit { 1 };
+            }
+
+            options.vertexFormats[std::string(vertexFormat.substr(0, equals))] = *format;
+        } else {
+            Print("No vertex format specified\n");
+            throw ArgsExit { 1 };
+        }
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+void Args::addInput(
+    const std::vector<std::string>& inputFiles,
+    const InputOptions& options,
+    const InputOptions& defaults
+) {
+    ShaderInput input;
+
+    std::optional<EShLanguage> stage = options.stage ? options.stage : defaults.stage;
+    if (stage && inputFiles.size() > 1) {
+        Print("A stage can only be specified for a single input, not when linking\n");
+        throw ArgsExit { 1 };
+    }
+
+    for (const std::string& inputFile : inputFiles) {
+        input.stages.push_back({ inputFile,
+                                 stage ? *stage : guessStageFromFileName(inputFile) });
+    }
+
+    std::stable_sort(
+        input.stages.begin(),
+        input.stages.end(),
+        [](const ShaderStageInput& a, const ShaderStageInput& b) {
+            return a.stage < b.stage;
+        }
+    );
+
+    for (size_t i = 1; i < input.stages.size(); i++) {
+        if (input.stages[i].stage == input.stages[i - 1].stage) {
+            Print(
+                "%s and %s are both %s shaders, only one per stage can be linked\n",
+                input.stages[i - 1].inputFile.c_str(),
+                input.stages[i].inputFile.c_str(),
+                StageName(input.stages[i].stage)
+            );
+            throw ArgsExit { 1 };
+        }
+    }
+
+    if (options.outputFile) {
+        input.outputFile = *options.outputFile;
+    } else if (defaults.outputFile) {
+        input.outputFile = *defaults.outputFile;
+    } else {
+        input.outputFile = defaultOutputFile(inputFiles[0]);
+    }
+
+    input.name = options.name ? options.name : defaults.name;
+    input.structPrefix =
+        options.structPrefix ? options.structPrefix : defaults.structPrefix;
+    input.globalPrefix =
+        options.globalPrefix ? options.globalPrefix : defaults.globalPrefix;
+
+    if (options.depFile) {
+        input.depFile = *options.depFile;
+    } else if (defaults.depFile) {
+        input.depFile = *defaults.depFile;
+    } else if (options.writeDepFile || defaults.writeDepFile) {
+        input.depFile = input.outputFile + ".d";
+    }
+
+    input.vertexFormats = defaults.vertexFormats;
+    for (const auto& [name, format] : options.vertexFormats) {
+        input.vertexFormats[name] = format;
+    }
+
+    input.permutationFile =
+        options.permutationFile ? options.permutationFile : defaults.permutationFile;
+    if (input.permutationFile) {
+        input.permutations = ReadPermutationSpec(
+            resolvePath(*input.permutationFile),
+            *input.permutationFile
+        );
+        if (!input.permutations) {
+            throw ArgsExit { 1 };
+        }
+    }
+
+    inputs.push_back(input);
+}
+
+void Args::readResponseFile(const std::string& responseFile, const InputOptions& defaults) {
+    std::ifstream file(resolvePath(responseFile));
+    if (!file.is_open()) {
+        Print("Failed to open response file %s\n", responseFile.c_str());
+        throw ArgsExit { 1 };
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+
+        std::vector<std::string> lineArgs = splitResponseLine(line);
+        if (lineArgs.empty() || lineArgs[0][0] == '#') {
+            continue;
+        }
+
+        std::vector<std::string> inputFiles;
+        InputOptions options;
+
+        for (size_t i = 0; i < lineArgs.size(); i++) {
+            if (parseInputOption(lineArgs, i, options)) {
+                continue;
+            }
+
+            inputFiles.push_back(lineArgs[i]);
+        }
+
+        if (inputFiles.empty()) {
+            Print("%s:%d: no input file specified\n", responseFile.c_str(), lineNumber);
+            throw ArgsExit { 1 };
+        }
+
+        addInput(inputFiles, options, defaults);
+    }
+}
+
+std::filesystem::path Args::resolvePath(const std::filesystem::path& path) const {
+    return workingDirectory / path;
+}
+
+Args::Args(int argc, char* argv[], const std::filesystem::path& workingDirectory)
+    : workingDirectory(workingDirectory) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::vector<std::string> inputFiles;
+    std::vector<std::string> responseFiles;
+    std::optional<unsigned int> jobs;
+    InputOptions defaults;
+
+    cacheSize = 256ull << 20;
+
+    for (size_t i = 0; i < args.size(); i++) {
+        std::string_view arg = args[i];
+
+        if (parseInputOption(args, i, defaults)) {
+            continue;
+        } else if (arg == "-m" || arg == "--map") {
+            if (i + 1 < args.size()) {
+                std::string_view typeMap = args[++i];
+                size_t equals = typeMap.find('=');
+                if (equals == std::string::npos) {
+                    Print("Invalid type map %s\n", typeMap.data());
+                    throw ArgsExit { 1 };
+                }
+
+                std::string_view key = typeMap.substr(0, equals);
+                std::string_view value = typeMap.substr(equals + 1);
+
+                customTypeMap[std::string(key)] = std::string(value);
+            } else {
+                Print("No type map specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "--half-type") {
+            if (i + 1 < args.size() && !args[i + 1].empty()) {
+                halfType = args[++i];
+            } else {
+                Print("No half type specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "-P" || arg == "--prelude") {
+            if (i + 1 < args.size()) {
+                std::string extraPreludeFile = args[++i];
+                std::ifstream file(resolvePath(extraPreludeFile));
+                if (!file.is_open()) {
+                    Print(
+                        "Failed to open extra prelude file %s\n",
+                        extraPreludeFile.data()
+                    );
+                    throw ArgsExit { 1 };
+                }
+
+                extraPrelude = std::string(
+                    (std::istreambuf_iterator<char>(file)),
+                    std::istreambuf_iterator<char>()
+                );
+            } else {
+                Print("No extra prelude file specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "-j" || arg == "--jobs") {
+            if (i + 1 < args.size()) {
+                int count = atoi(args[++i].c_str());
+                if (count <= 0) {
+                    Print("Invalid job count %s\n", args[i].c_str());
+                    throw ArgsExit { 1 };
+                }
+                jobs = count;
+            } else {
+                Print("No job count specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "-f" || arg == "--spv-format") {
+            if (i + 1 < args.size()) {
+                std::string_view format = args[++i];
+                if (format == "decimal") {
+                    spirvFormat = SpirvFormat::Decimal;
+                } else if (format == "hex") {
+                    spirvFormat = SpirvFormat::Hex;
+                } else if (format == "string") {
+                    spirvFormat = SpirvFormat::String;
+                } else if (format == "embed") {
+                    spirvFormat = SpirvFormat::Embed;
+                } else {
+                    Print("Unknown SPIR-V format %s\n", format.data());
+                    throw ArgsExit { 1 };
+                }
+            } else {
+                Print("No SPIR-V format specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "--pack") {
+            if (i + 1 < args.size()) {
+                packFile = args[++i];
+            } else {
+                Print("No pack file specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "--pack-header") {
+            if (i + 1 < args.size()) {
+                packHeaderFile = args[++i];
+            } else {
+                Print("No pack header file specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "--layout-report") {
+            if (i + 1 < args.size()) {
+                layoutReportFile = args[++i];
+            } else {
+                Print("No layout report file specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "--reorder-blocks") {
+            reorderBlocks = true;
+        } else if (arg == "--dirty-tracking") {
+            dirtyTracking = true;
+        } else if (arg == "--soa-packers") {
+            soaPackers = true;
+        } else if (arg == "--cost-report") {
+            if (i + 1 < args.size()) {
+                costReportFile = args[++i];
+            } else {
+                Print("No cost report file specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "--cost-baseline") {
+            if (i + 1 < args.size()) {
+                costBaselineFile = args[++i];
+            } else {
+                Print("No cost baseline file specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "--cost-limit") {
+            if (i + 1 < args.size()) {
+                std::optional<CostLimit> limit = ParseCostLimit(args[++i]);
+                if (!limit) {
+                    Print("Invalid cost limit %s\n", args[i].c_str());
+                    throw ArgsExit { 1 };
+                }
+                costLimits.push_back(*limit);
+            } else {
+                Print("No cost limit specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "-O0") {
+            optimizerOptions.level = OptimizationLevel::None;
+        } else if (arg == "-O") {
+            optimizerOptions.level = OptimizationLevel::Performance;
+        } else if (arg == "-Os") {
+            optimizerOptions.level = OptimizationLevel::Size;
+        } else if (arg == "--strip-debug") {
+            optimizerOptions.stripDebugInfo = true;
+        } else if (arg == "--validate") {
+            optimizerOptions.validate = true;
+        } else if (arg == "--cache-dir") {
+            if (i + 1 < args.size()) {
+                cacheDir = args[++i];
+            } else {
+                Print("No cache directory specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "--cache-size") {
+            if (i + 1 < args.size()) {
+                cacheSize = parseSize(args[++i]);
+                if (cacheSize == 0) {
+                    Print("Invalid cache size %s\n", args[i].c_str());
+                    throw ArgsExit { 1 };
+                }
+            } else {
+                Print("No cache size specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "--cache-stats") {
+            cacheStats = true;
+        } else if (arg == "--max-rss") {
+            if (i + 1 < args.size()) {
+                maxResidentBytes = parseSize(args[++i]);
+                if (maxResidentBytes == 0) {
+                    Print("Invalid resident memory limit %s\n", args[i].c_str());
+                    throw ArgsExit { 1 };
+                }
+            } else {
+                Print("No resident memory limit specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "--timing") {
+            timing = true;
+        } else if (arg == "--time-report") {
+            if (i + 1 < args.size()) {
+                std::string_view format = args[++i];
+                if (format == "text") {
+                    timeReport = TimeReportFormat::Text;
+                } else if (format == "json") {
+                    timeReport = TimeReportFormat::Json;
+                } else if (format == "trace") {
+                    timeReport = TimeReportFormat::Trace;
+                } else {
+                    Print("Unknown time report format %s\n", format.data());
+                    throw ArgsExit { 1 };
+                }
+            } else {
+                Print("No time report format specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "--time-report-file") {
+            if (i + 1 < args.size()) {
+                timeReportFile = args[++i];
+            } else {
+                Print("No time report file specified\n");
+                throw ArgsExit { 1 };
+            }
+        } else if (arg == "-l" || arg == "--link") {
+            link = true;
+        } else if (arg == "--verify-determinism") {
+            verifyDeterminism = true;
+        } else if (arg == "--watch") {
+            watch = true;
+        } else if (arg == "-h" || arg == "--help") {
+            Print("Usage: %s [options] <input file>...\n", argv[0]);
+            Print("       %s [options] @<response file>\n", argv[0]);
+            Print("Options:\n");
+            Print("  -o, --output <file>      Output file\n");
+            Print("  -s, --stage <stage>      vert, tesc, tese, geom, frag or comp\n");
+            Print("  -n, --name <name>        Shader name used in generated symbols\n");
+            Print("  -p, --prefix <prefix>    Struct prefix\n");
+            Print("  -g, --global-prefix <prefix> Global prefix\n");
+            Print("  -MD                      Write a depfile next to the output\n");
+            Print("  -MF <file>               Write a depfile to the given path\n");
+            Print("  --permutations <file>    Compile every variant of a define matrix\n");
+            Print("  --vertex-format <input>=<format> Vertex buffer format of an input,\n");
+            Print("                           e.g. color=unorm8x4 or uv=half\n");
+            Print("  -m, --map <key>=<value>  Custom type map\n");
+            Print("  --half-type <type>       C type of float16_t, e.g. _Float16\n");
+            Print("                           (default uint16_t)\n");
+            Print("  -P, --prelude <file>     Extra prelude file\n");
+            Print("  -l, --link               Link all inputs into one program\n");
+            Print("  -j, --jobs <n>           Number of worker threads\n");
+            Print("  -f, --spv-format <fmt>   SPIR-V as decimal, hex, string or embed\n");
+            Print("  --pack <file>            Write all SPIR-V into one mappable pack\n");
+            Print("  --pack-header <file>     Pack accessor header (default <pack>.h)\n");
+            Print("  --verify-pack <file>     Check a pack file and exit\n");
+            Print("  --layout-report <file>   Write the padding of every block as JSON\n");
+            Print("  --reorder-blocks         Emit block member orders that pad less\n");
+            Print("                           as C structs and a GLSL include\n");
+            Print("  --dirty-tracking         Emit block setters that track changed\n");
+            Print("                           bytes, and flush only those\n");
+            Print("  --soa-packers            Emit functions that fill trailing struct\n");
+            Print("                           arrays from one array per member\n");
+            Print("  --cost-report <file>     Write static SPIR-V costs as JSON\n");
+            Print("  --cost-baseline <file>   Diff the cost report against an older one\n");
+            Print("  --cost-limit <metric>=<n> Fail if an entry point exceeds n, e.g.\n");
+            Print("                           texture=16 or maxLiveIds=128\n");
+            Print("  -O                       Optimize SPIR-V for performance\n");
+            Print("  -Os                      Optimize SPIR-V for size\n");
+            Print("  -O0                      Don't optimize SPIR-V (default)\n");
+            Print("  --strip-debug            Strip debug info and names from SPIR-V\n");
+            Print("  --validate               Validate the final SPIR-V\n");
+            Print("  --cache-dir <dir>        Compile cache directory\n");
+            Print("  --cache-size <size>      Cache size limit (default 256M)\n");
+            Print("  --cache-stats            Print cache hit/miss statistics\n");
+            Print("  --max-rss <size>         Run compiles one at a time while more than\n");
+            Print("                           this is resident, e.g. 512M\n");
+            Print("  --timing                 Print how long compiling took\n");
+            Print("  --time-report <fmt>      Time and heap growth per phase, as text,\n");
+            Print("                           json or trace (Chrome trace_event)\n");
+            Print("  --time-report-file <file> Write the time report to a file\n");
+            Print("  --verify-determinism     Compile twice and fail if outputs differ\n");
+            Print("  --watch                  Recompile inputs when their sources or\n");
+            Print("                           includes change\n");
+            Print("  --server <socket>        Serve compile requests on a Unix socket\n");
+            Print("  --client <socket>        Send this command line to a server\n");
+            Print("  -h, --help               Show this help message\n");
+            Print("Response files list one input per line, followed by its own\n");
+            Print("-o, -s, -n, -p, -g, -MD, -MF, --permutations and --vertex-format\n");
+            Print("options. Several files on one line are linked into one program.\n");
+
+            throw ArgsExit { 0 };
+        } else if (arg.size() > 1 && arg[0] == '@') {
+            responseFiles.push_back(std::string(arg.substr(1)));
+        } else {
+            inputFiles.push_back(std::string(arg));
+        }
+    }
+
+    size_t commandLineInputs = link ? std::min<size_t>(inputFiles.size(), 1)
+                                    : inputFiles.size();
+    if (defaults.outputFile && commandLineInputs + responseFiles.size() > 1) {
+        Print("An output file can only be specified for a single input\n");
+        throw ArgsExit { 1 };
+    }
+
+    if (defaults.depFile && commandLineInputs + responseFiles.size() > 1) {
+        Print("A dependency file can only be specified for a single input\n");
+        throw ArgsExit { 1 };
+    }
+
+    if (defaults.name && commandLineInputs + responseFiles.size() > 1) {
+        Print("A shader name can only be specified for a single input\n");
+        throw ArgsExit { 1 };
+    }
+
+    if (link && !inputFiles.empty()) {
+        addInput(inputFiles, {}, defaults);
+    } else {
+        for (const std::string& inputFile : inputFiles) {
+            addInput({ inputFile }, {}, defaults);
+        }
+    }
+
+    // The command line output and dependency files and name only apply to command line
+    // inputs.
+    defaults.outputFile.reset();
+    defaults.depFile.reset();
+    defaults.name.reset();
+    for (const std::string& responseFile : responseFiles) {
+        readResponseFile(responseFile, defaults);
+    }
+
+    if (inputs.empty()) {
+        Print("No input file specified\n");
+        throw ArgsExit { 1 };
+    }
+
+    if (optimizerOptions.enabled() && !OptimizerAvailable()) {
+        Print("Optimization and validation need glslop built with SPIRV-Tools\n");
+        throw ArgsExit { 1 };
+    }
+
+    if (packHeaderFile && !packFile) {
+        Print("--pack-header needs --pack\n");
+        throw ArgsExit { 1 };
+    }
+
+    if (costBaselineFile && !costReportFile) {
+        Print("--cost-baseline needs --cost-report\n");
+        throw ArgsExit { 1 };
+    }
+
+    if (packFile) {
+        spirvFormat = SpirvFormat::Pack;
+        if (!packHeaderFile) {
+            std::filesystem::path packPath(*packFile);
+            packHeaderFile = packPath.replace_extension(".h").string();
+        }
+    }
+
+    if (timeReportFile && !timeReport) {
+        timeReport = TimeReportFormat::Text;
+    }
+
+    if (jobs) {
+        this->jobs = *jobs;
+    } else {
+        this->jobs = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+}
+
+HeaderOptions Args::headerOptions() const {
+    HeaderOptions options;
+    options.customTypeMap = customTypeMap;
+    options.extraPrelude = extraPrelude;
+    options.halfType = halfType;
+    options.spirvFormat = spirvFormat;
+    options.optimized = optimizerOptions.changesSpirv();
+    options.reorderBlocks = reorderBlocks;
+    options.dirtyTracking = dirtyTracking;
+    options.soaPackers = soaPackers;
+    return options;
+}
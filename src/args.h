@@ -0,0 +1,131 @@
+#pragma once
+
+#include "cost.h"
+#include "header.h"
+#include "optimizer.h"
+#include "profile.h"
+#include "vertex.h"
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+
+// Thrown by Args once it has printed why parsing stopped, with the exit code to use.
+struct ArgsExit {
+    int code;
+};
+
+struct Args {
+    std::vector<ShaderInput> inputs;
+
+    // Relative paths given in the arguments are relative to this directory. Empty means the
+    // process working directory.
+    std::filesystem::path workingDirectory;
+
+    std::string extraPrelude;
+    std::unordered_map<std::string, std::string> customTypeMap;
+    // C type of float16_t members.
+    std::string halfType = "uint16_t";
+    unsigned int jobs;
+    SpirvFormat spirvFormat = SpirvFormat::Decimal;
+    OptimizerOptions optimizerOptions;
+
+    std::optional<std::string> cacheDir;
+    uint64_t cacheSize;
+    bool cacheStats = false;
+
+    // Where to write the pack and its accessor header with SpirvFormat::Pack.
+    std::optional<std::string> packFile;
+    std::optional<std::string> packHeaderFile;
+
+    // Where to write the padding report of every block.
+    std::optional<std::string> layoutReportFile;
+    // Write reordered C structs and GLSL member lists for blocks that can be made smaller.
+    bool reorderBlocks = false;
+    // Write dirty-range tracking setters and flush functions for every block.
+    bool dirtyTracking = false;
+    // Write functions that fill trailing struct arrays from structure of arrays data.
+    bool soaPackers = false;
+
+    // Where to write the static cost of every entry point, and the earlier report to diff it
+    // against.
+    std::optional<std::string> costReportFile;
+    std::optional<std::string> costBaselineFile;
+    // Upper bounds on cost metrics. Inputs with an entry point over any of them fail.
+    std::vector<CostLimit> costLimits;
+
+    // Run compiles one at a time while the process has more resident memory than this. 0 for
+    // no limit.
+    uint64_t maxResidentBytes = 0;
+
+    bool timing = false;
+    std::optional<TimeReportFormat> timeReport;
+    // Where to write the time report. Printed with the other output if unset.
+    std::optional<std::string> timeReportFile;
+
+    // Link all command line inputs into a single program instead of compiling each alone.
+    bool link = false;
+
+    // Compile everything a second time and fail if any output differs.
+    bool verifyDeterminism = false;
+
+    // Keep running after compiling, recompiling inputs whenever a file they use changes.
+    bool watch = false;
+
+    // Options that can be given per input, either on the command line or on a response file
+    // line. Anything left unset falls back to the command line value, then to the defaults.
+    struct InputOptions {
+        std::optional<std::string> outputFile;
+        std::optional<std::string> name;
+        std::optional<std::string> structPrefix;
+        std::optional<std::string> globalPrefix;
+        std::optional<EShLanguage> stage;
+        bool writeDepFile = false;
+        std::optional<std::string> depFile;
+        std::optional<std::string> permutationFile;
+        // Formats of vertex inputs by name. A response file line adds to those given on the
+        // command line, replacing the formats of the same inputs.
+        std::unordered_map<std::string, VertexFormat> vertexFormats;
+    };
+
+    // Parses a size such as "512K", "256M" or "2G" into bytes. Returns 0 if invalid.
+    static uint64_t parseSize(const std::string& size);
+
+    static EShLanguage guessStageFromFileName(const std::string& fileName);
+
+    static std::string defaultOutputFile(const std::string& inputFile);
+
+    // Splits a response file line into arguments. Arguments are separated by whitespace and
+    // may be wrapped in double quotes to include spaces.
+    static std::vector<std::string> splitResponseLine(const std::string& line);
+
+    // Tries to parse a per-input option at args[i], advancing i past its value.
+    // Returns false if args[i] is not a per-input option.
+    static bool parseInputOption(
+        const std::vector<std::string>& args,
+        size_t& i,
+        InputOptions& options
+    );
+
+    // Adds one input, linking all of inputFiles into a single program if there are several.
+    void addInput(
+        const std::vector<std::string>& inputFiles,
+        const InputOptions& options,
+        const InputOptions& defaults
+    );
+
+    // Reads a response file, where every non-empty line not starting with '#' describes one
+    // input: the input file followed by its own per-input options. Several input files on
+    // one line are linked into a single program.
+    void readResponseFile(const std::string& responseFile, const InputOptions& defaults);
+
+    std::filesystem::path resolvePath(const std::filesystem::path& path) const;
+
+    Args(int argc, char* argv[], const std::filesystem::path& workingDirectory = {});
+
+    HeaderOptions headerOptions() const;
+};
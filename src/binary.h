@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <string_view>
+
+// Little helpers for the length-prefixed binary formats used by the cache and the server.
+struct BinaryWriter {
+    std::string data;
+
+    void u32(uint32_t value) {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void i32(int32_t value) {
+        u32(static_cast<uint32_t>(value));
+    }
+
+    void u64(uint64_t value) {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void str(std::string_view value) {
+        u32(static_cast<uint32_t>(value.size()));
+        data.append(value);
+    }
+};
+
+// Reads values written by BinaryWriter. Reading past the end sets failed and returns zeroes,
+// so callers only need to check failed once at the end.
+struct BinaryReader {
+    std::string_view data;
+    size_t position = 0;
+    bool failed = false;
+
+    uint32_t u32() {
+        uint32_t value = 0;
+        if (data.size() - position < sizeof(value)) {
+            failed = true;
+            return 0;
+        }
+        memcpy(&value, data.data() + position, sizeof(value));
+        position += sizeof(value);
+        return value;
+    }
+
+    int32_t i32() {
+        return static_cast<int32_t>(u32());
+    }
+
+    uint64_t u64() {
+        uint64_t value = 0;
+        if (data.size() - position < sizeof(value)) {
+            failed = true;
+            return 0;
+        }
+        memcpy(&value, data.data() + position, sizeof(value));
+        position += sizeof(value);
+        return value;
+    }
+
+    // Reads an element count, rejecting counts that can't possibly fit in the remaining data.
+    uint32_t count() {
+        uint32_t value = u32();
+        if (value > data.size() - position) {
+            failed = true;
+            return 0;
+        }
+        return value;
+    }
+
+    std::string str() {
+        uint32_t size = count();
+        if (failed) {
+            return "";
+        }
+        std::string value(data.substr(position, size));
+        position += size;
+        return value;
+    }
+};
@@ -0,0 +1,187 @@
+#include "cache.h"
+#include "hash.h"
+#include "log.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Every entry starts with this magic and its own key, so a truncated or misplaced file is
+// treated as a miss rather than replayed.
+static const char s_cacheEntryMagic[8] = { 'G', 'L', 'S', 'L', 'O', 'P', 'C', '1' };
+
+CompileCache::CompileCache(const std::filesystem::path& directory, uint64_t maxSize)
+    : directory(directory), maxSize(maxSize) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        Print(
+            "Failed to create cache directory %s: %s\n",
+            directory.string().c_str(),
+            error.message().c_str()
+        );
+    }
+}
+
+std::filesystem::path CompileCache::pathForKey(uint64_t key) const {
+    std::string name = HashToString(key);
+    return directory / name.substr(0, 2) / (name + ".bin");
+}
+
+std::optional<ShaderReflection> CompileCache::load(uint64_t key) {
+    std::filesystem::path path = pathForKey(key);
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        misses++;
+        return std::nullopt;
+    }
+
+    std::string data(std::istreambuf_iterator<char>(file), {});
+    file.close();
+
+    uint64_t storedKey = 0;
+    size_t headerSize = sizeof(s_cacheEntryMagic) + sizeof(storedKey);
+    if (data.size() >= headerSize) {
+        memcpy(&storedKey, data.data() + sizeof(s_cacheEntryMagic), sizeof(storedKey));
+    }
+
+    std::optional<ShaderReflection> reflection;
+    if (data.size() >= headerSize &&
+        memcmp(data.data(), s_cacheEntryMagic, sizeof(s_cacheEntryMagic)) == 0 &&
+        storedKey == key) {
+        reflection = DeserializeReflection(std::string_view(data).substr(headerSize));
+    }
+
+    if (!reflection) {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        misses++;
+        return std::nullopt;
+    }
+
+    // Mark the entry as recently used for LRU eviction.
+    std::error_code error;
+    std::filesystem::last_write_time(
+        path,
+        std::filesystem::file_time_type::clock::now(),
+        error
+    );
+
+    hits++;
+    return reflection;
+}
+
+void CompileCache::store(uint64_t key, const ShaderReflection& reflection) {
+    std::filesystem::path path = pathForKey(key);
+
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    if (error) {
+        return;
+    }
+
+    // Unique per process and thread, so concurrent writers never share a temporary file.
+    std::stringstream tempName;
+    tempName << path.filename().string() << ".tmp." << getpid() << "."
+             << std::hash<std::thread::id>()(std::this_thread::get_id());
+    std::filesystem::path tempPath = path.parent_path() / tempName.str();
+
+    std::ofstream file(tempPath, std::ios::binary);
+    if (!file.is_open()) {
+        return;
+    }
+
+    file.write(s_cacheEntryMagic, sizeof(s_cacheEntryMagic));
+    file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+
+    std::string data = SerializeReflection(reflection);
+    file.write(data.data(), data.size());
+    file.close();
+
+    if (file.fail()) {
+        std::filesystem::remove(tempPath, error);
+        return;
+    }
+
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return;
+    }
+
+    stores++;
+}
+
+void CompileCache::evict() {
+    struct Entry {
+        std::filesystem::path path;
+        std::filesystem::file_time_type lastUse;
+        uint64_t size;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t totalSize = 0;
+
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(directory, error);
+         !error && it != std::filesystem::recursive_directory_iterator();
+         it.increment(error)) {
+        if (!it->is_regular_file(error) || it->path().extension() != ".bin") {
+            continue;
+        }
+
+        Entry entry;
+        entry.path = it->path();
+        entry.lastUse = it->last_write_time(error);
+        entry.size = it->file_size(error);
+        if (error) {
+            // Another process may have evicted it under us.
+            error.clear();
+            continue;
+        }
+
+        totalSize += entry.size;
+        entries.push_back(entry);
+    }
+
+    if (totalSize > maxSize) {
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.lastUse < b.lastUse;
+        });
+
+        for (const Entry& entry : entries) {
+            if (totalSize <= maxSize) {
+                break;
+            }
+
+            if (std::filesystem::remove(entry.path, error)) {
+                evictions++;
+            }
+            totalSize -= entry.size;
+        }
+    }
+
+    sizeAfterEviction = totalSize;
+}
+
+void CompileCache::printStats() const {
+    size_t lookups = hits + misses;
+    Print(
+        "cache: %zu hits, %zu misses (%.1f%% hit rate), %zu stored, %zu evicted, "
+        "%.1f/%.1f MiB used\n",
+        hits.load(),
+        misses.load(),
+        lookups > 0 ? 100.0 * hits / lookups : 0.0,
+        stores.load(),
+        evictions,
+        sizeAfterEviction / (1024.0 * 1024.0),
+        maxSize / (1024.0 * 1024.0)
+    );
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "reflection.h"
+
+#include <atomic>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include <stdint.h>
+
+// On-disk, content-addressed store of compiled shaders.
+//
+// Entries are keyed by a hash of everything that affects compilation and hold the SPIR-V and
+// reflection data, so a hit skips parsing, linking and SPIR-V generation entirely. Entries are
+// written through a temporary file and renamed into place, so several processes (or CI agents
+// sharing a directory) can use the same cache concurrently. Reads refresh an entry's
+// modification time, which evict() uses to drop the least recently used entries first.
+class CompileCache {
+  public:
+    CompileCache(const std::filesystem::path& directory, uint64_t maxSize);
+
+    std::optional<ShaderReflection> load(uint64_t key);
+    void store(uint64_t key, const ShaderReflection& reflection);
+
+    // Removes least recently used entries until the cache fits in maxSize bytes.
+    void evict();
+
+    void printStats() const;
+
+  private:
+    std::filesystem::path pathForKey(uint64_t key) const;
+
+    std::filesystem::path directory;
+    uint64_t maxSize;
+
+    std::atomic<size_t> hits = 0;
+    std::atomic<size_t> misses = 0;
+    std::atomic<size_t> stores = 0;
+    size_t evictions = 0;
+    uint64_t sizeAfterEviction = 0;
+};
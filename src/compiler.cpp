@@ -0,0 +1,431 @@
+#include "compiler.h"
+#include "log.h"
+#include "profile.h"
+
+#include <glslang/Include/PoolAlloc.h>
+#include <glslang/Public/ResourceLimits.h>
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+static const char* s_defaultShaderPreamble =
+    "#extension GL_GOOGLE_include_directive : enable\n";
+
+static const int s_glslVersion = 100;
+static const glslang::EShTargetClientVersion s_clientVersion = glslang::EShTargetVulkan_1_2;
+static const glslang::EShTargetLanguageVersion s_spirvVersion = glslang::EShTargetSpv_1_5;
+
+ShaderIncluder::ShaderIncluder(std::string fileName, IncludeResolver resolver)
+    : fileName(std::move(fileName)),
+      resolver(std::move(resolver)) {}
+
+glslang::TShader::Includer::IncludeResult*
+ShaderIncluder::includeLocal(const char* headerName, const char* includerName, size_t) {
+    std::string includer =
+        includerName && includerName[0] != '\0' ? std::string(includerName) : fileName;
+
+    if (!resolver) {
+        Print(
+            "%s: can't include %s without an include resolver\n",
+            includer.c_str(),
+            headerName
+        );
+        return nullptr;
+    }
+
+    PhaseTimer timer("include", fileName);
+
+    std::optional<ResolvedInclude> include = resolver(headerName, includer);
+    if (!include) {
+        return nullptr;
+    }
+    if (!include->contents) {
+        if (std::find(missing.begin(), missing.end(), include->name) == missing.end()) {
+            missing.push_back(include->name);
+        }
+        return nullptr;
+    }
+
+    if (std::find(included.begin(), included.end(), include->name) == included.end()) {
+        included.push_back(include->name);
+    }
+
+    // glslang passes this name back as includerName for nested includes, so it has to be the
+    // resolved name for those to be looked up relative to this file. The contents are kept
+    // alive by a reference held in userData until glslang releases the include.
+    return new IncludeResult(
+        include->name,
+        include->contents->data(),
+        include->contents->size(),
+        new std::shared_ptr<const std::string>(include->contents)
+    );
+}
+
+void ShaderIncluder::releaseInclude(IncludeResult* result) {
+    delete static_cast<std::shared_ptr<const std::string>*>(result->userData);
+    delete result;
+}
+
+std::string ShaderPreamble(const std::string& defines) {
+    return s_defaultShaderPreamble + defines;
+}
+
+uint64_t TargetVersionKey() {
+    return static_cast<uint64_t>(s_glslVersion) << 48 ^
+           static_cast<uint64_t>(s_clientVersion) << 24 ^ static_cast<uint64_t>(s_spirvVersion);
+}
+
+// Gives glslang a pool allocator on this thread for the lifetime of a compile. Anything
+// glslang allocates from the thread's pool in that time, such as the containers of the
+// shaders and programs it constructs, is freed when the compile ends, instead of piling up in
+// the thread's default pool for as long as the thread lives. The pool is kept per thread and
+// only emptied, so later compiles on the thread reuse its pages.
+class ScopedCompilePool {
+  public:
+    ScopedCompilePool() : previous(&glslang::GetThreadPoolAllocator()) {
+        static thread_local glslang::TPoolAllocator t_pool;
+        pool = &t_pool;
+        pool->push();
+        glslang::SetThreadPoolAllocator(pool);
+    }
+
+    ~ScopedCompilePool() {
+        glslang::SetThreadPoolAllocator(previous);
+        pool->pop();
+    }
+
+    ScopedCompilePool(const ScopedCompilePool&) = delete;
+    ScopedCompilePool& operator=(const ScopedCompilePool&) = delete;
+
+  private:
+    glslang::TPoolAllocator* pool;
+    glslang::TPoolAllocator* previous;
+};
+
+static void SetupShader(
+    glslang::TShader& shader,
+    const char* const* shaderSource,
+    EShLanguage stage,
+    const std::string& preamble
+) {
+    shader.setStrings(shaderSource, 1);
+    shader.setPreamble(preamble.c_str());
+    shader.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, s_glslVersion);
+    shader.setEnvClient(glslang::EShClientVulkan, s_clientVersion);
+    shader.setEnvTarget(glslang::EshTargetSpv, s_spirvVersion);
+}
+
+std::optional<std::string> PreprocessStage(
+    const StageSource& stage,
+    const std::string& preamble,
+    ShaderIncluder& includer
+) {
+    const char* fileName = stage.fileName.c_str();
+    PhaseTimer timer("preprocess", fileName);
+
+    ScopedCompilePool pool;
+    glslang::TShader shader(stage.stage);
+    const char* shaderSource = stage.source.c_str();
+    SetupShader(shader, &shaderSource, stage.stage, preamble);
+
+    std::string preprocessed;
+    if (!shader.preprocess(
+            GetDefaultResources(),
+            s_glslVersion,
+            ENoProfile,
+            false,
+            false,
+            EShMsgDefault,
+            &preprocessed,
+            includer
+        )) {
+        Print("%s: failed to preprocess shader!\n%s", fileName, shader.getInfoLog());
+        return std::nullopt;
+    }
+
+    return preprocessed;
+}
+
+// One stage of a program, parsed but not yet linked.
+struct ParsedStage {
+    // glslang binds some of a TShader's containers to the pool allocator of the thread that
+    // constructs it. Stages parsed on their own thread get a pool that outlives the thread.
+    std::unique_ptr<glslang::TPoolAllocator> pool;
+    std::unique_ptr<glslang::TShader> shader;
+};
+
+static std::unique_ptr<glslang::TShader>
+ParseShader(const StageSource& stage, const std::string& preamble, ShaderIncluder& includer) {
+    const char* fileName = stage.fileName.c_str();
+    PhaseTimer timer("parse", fileName);
+
+    std::unique_ptr<glslang::TShader> shader = std::make_unique<glslang::TShader>(stage.stage);
+    const char* shaderSource = stage.source.c_str();
+    SetupShader(*shader, &shaderSource, stage.stage, preamble);
+
+    const TBuiltInResource* resources = GetDefaultResources();
+
+    if (!shader->parse(resources, s_glslVersion, false, EShMsgDefault, includer)) {
+        Print("%s: failed to parse shader!\n%s", fileName, shader->getInfoLog());
+        return nullptr;
+    }
+
+    return shader;
+}
+
+// Links parsed stages into a program, checking the interfaces between them.
+static std::unique_ptr<glslang::TProgram>
+LinkProgram(const std::vector<ParsedStage>& stages, const char* fileName) {
+    std::unique_ptr<glslang::TProgram> program = std::make_unique<glslang::TProgram>();
+    for (const ParsedStage& stage : stages) {
+        program->addShader(stage.shader.get());
+    }
+
+    {
+        PhaseTimer timer("link", fileName);
+        if (!program->link(EShMsgDefault)) {
+            Print("%s: failed to link shader!\n%s", fileName, program->getInfoLog());
+            return nullptr;
+        }
+    }
+
+    {
+        PhaseTimer timer("reflection", fileName);
+        if (!program->buildReflection()) {
+            Print("%s: failed to build reflection\n", fileName);
+            return nullptr;
+        }
+    }
+
+    return program;
+}
+
+std::optional<ShaderReflection> CompileStages(
+    const std::vector<StageSource>& stages,
+    const std::string& preamble,
+    const std::vector<std::unique_ptr<ShaderIncluder>>& includers,
+    const OptimizerOptions& optimizerOptions
+) {
+    size_t stageCount = stages.size();
+    const char* fileName = stages[0].fileName.c_str();
+
+    // Outlives every shader and program of the compile, which are destroyed before it.
+    ScopedCompilePool pool;
+
+    std::vector<ParsedStage> parsedStages(stageCount);
+
+    // Stages parsed on other threads print and report to wherever this thread does.
+    OutputCapture* capture = CurrentOutputCapture();
+    TimeReport* timeReport = CurrentTimeReport();
+
+    auto parseStage = [&](size_t i) {
+        ScopedOutputCapture scopedCapture(capture);
+        ScopedTimeReport scopedReport(timeReport);
+
+        parsedStages[i].shader = ParseShader(stages[i], preamble, *includers[i]);
+    };
+
+    // The first stage is parsed on this thread, the rest each on their own.
+    std::vector<std::thread> parseThreads;
+    for (size_t i = 1; i < stageCount; i++) {
+        parsedStages[i].pool = std::make_unique<glslang::TPoolAllocator>();
+        parseThreads.emplace_back([&, i]() {
+            glslang::SetThreadPoolAllocator(parsedStages[i].pool.get());
+            parseStage(i);
+        });
+    }
+
+    parseStage(0);
+
+    for (std::thread& thread : parseThreads) {
+        thread.join();
+    }
+
+    for (const ParsedStage& stage : parsedStages) {
+        if (!stage.shader) {
+            return std::nullopt;
+        }
+    }
+
+    std::unique_ptr<glslang::TProgram> program = LinkProgram(parsedStages, fileName);
+    if (!program) {
+        return std::nullopt;
+    }
+
+    std::vector<EShLanguage> programStages;
+    for (const StageSource& stage : stages) {
+        programStages.push_back(stage.stage);
+    }
+
+    std::optional<ShaderReflection> reflection;
+    {
+        PhaseTimer timer("spirv", fileName);
+        reflection = ReflectProgram(program.get(), programStages);
+    }
+
+    program.reset();
+
+    if (!reflection) {
+        return std::nullopt;
+    }
+
+    if (optimizerOptions.enabled()) {
+        PhaseTimer timer("optimize", fileName);
+
+        for (size_t i = 0; i < stageCount; i++) {
+            if (!OptimizeSpirv(
+                    reflection->stages[i].spirv,
+                    optimizerOptions,
+                    stages[i].fileName.c_str()
+                )) {
+                return std::nullopt;
+            }
+        }
+
+        // Working back from the last stage, drop outputs the next stage doesn't read.
+        // Compute shaders have no stage interface to trim.
+        if (optimizerOptions.level != OptimizationLevel::None) {
+            for (size_t i = stageCount - 1; i > 0; i--) {
+                if (stages[i].stage == EShLangCompute) {
+                    continue;
+                }
+
+                if (!EliminateDeadStageOutputs(
+                        reflection->stages[i - 1].spirv,
+                        reflection->stages[i].spirv,
+                        optimizerOptions,
+                        stages[i - 1].fileName.c_str()
+                    )) {
+                    return std::nullopt;
+                }
+            }
+        }
+
+        // Validated last, so the modules checked are the ones that ship.
+        if (optimizerOptions.validate) {
+            for (size_t i = 0; i < stageCount; i++) {
+                if (!ValidateSpirv(reflection->stages[i].spirv, stages[i].fileName.c_str())) {
+                    return std::nullopt;
+                }
+            }
+        }
+    }
+
+    return reflection;
+}
+
+Compiler::Compiler() {
+    // glslang counts initializations, so this only sets up its tables for the first Compiler.
+    glslang::InitializeProcess();
+}
+
+Compiler::~Compiler() {
+    glslang::FinalizeProcess();
+}
+
+// Compiles the stages of a request, or loads them from its cache.
+static std::optional<ShaderReflection> CompileOrLoadStages(
+    const CompileRequest& request,
+    const std::string& preamble,
+    const std::vector<std::unique_ptr<ShaderIncluder>>& includers
+) {
+    std::vector<std::string> preprocessedSources;
+    if (request.cache) {
+        for (size_t i = 0; i < request.stages.size(); i++) {
+            std::optional<std::string> preprocessed =
+                PreprocessStage(request.stages[i], preamble, *includers[i]);
+            if (!preprocessed) {
+                return std::nullopt;
+            }
+            preprocessedSources.push_back(std::move(*preprocessed));
+        }
+
+        std::optional<ShaderReflection> cached = request.cache->load(preprocessedSources);
+        if (cached) {
+            return cached;
+        }
+    }
+
+    std::optional<ShaderReflection> reflection =
+        CompileStages(request.stages, preamble, includers, request.optimizerOptions);
+    if (reflection && request.cache) {
+        request.cache->store(preprocessedSources, *reflection);
+    }
+    return reflection;
+}
+
+// Compiles a request into result, printing diagnostics.
+static void CompileRequestInto(const CompileRequest& request, CompileResult& result) {
+    if (request.stages.empty()) {
+        Print("Nothing to compile\n");
+        return;
+    }
+
+    if (request.header && request.header->spirvFormat == SpirvFormat::Pack) {
+        Print("%s: packs can't be built in memory\n", request.stages[0].fileName.c_str());
+        return;
+    }
+
+    std::string preamble = ShaderPreamble(request.defines);
+
+    std::vector<std::unique_ptr<ShaderIncluder>> includers;
+    for (const StageSource& stage : request.stages) {
+        includers.push_back(
+            std::make_unique<ShaderIncluder>(stage.fileName, request.includeResolver)
+        );
+    }
+
+    result.reflection = CompileOrLoadStages(request, preamble, includers);
+
+    std::vector<std::string>& includedFiles = result.includedFiles;
+    for (const std::unique_ptr<ShaderIncluder>& includer : includers) {
+        for (const std::string& includedFile : includer->includedFiles()) {
+            if (std::find(includedFiles.begin(), includedFiles.end(), includedFile) ==
+                includedFiles.end()) {
+                includedFiles.push_back(includedFile);
+            }
+        }
+        std::vector<std::string>& missingFiles = result.missingFiles;
+        for (const std::string& missingFile : includer->missingFiles()) {
+            if (std::find(missingFiles.begin(), missingFiles.end(), missingFile) ==
+                missingFiles.end()) {
+                missingFiles.push_back(missingFile);
+            }
+        }
+    }
+
+    if (!result.reflection || !request.header) {
+        return;
+    }
+
+    ShaderInput input;
+    for (const StageSource& stage : request.stages) {
+        input.stages.push_back({ stage.fileName, stage.stage });
+    }
+    input.name = request.name;
+    input.structPrefix = request.structPrefix;
+    input.globalPrefix = request.globalPrefix;
+
+    HeaderOptions headerOptions = *request.header;
+    headerOptions.optimized = request.optimizerOptions.changesSpirv();
+
+    HeaderExtras extras;
+    std::stringstream header;
+    if (GenerateHeader(*result.reflection, headerOptions, input, nullptr, extras, header)) {
+        result.header = header.str();
+    }
+}
+
+CompileResult Compiler::compile(const CompileRequest& request) const {
+    CompileResult result;
+    OutputCapture capture;
+
+    {
+        ScopedOutputCapture scopedCapture(&capture);
+        CompileRequestInto(request, result);
+    }
+
+    result.log = std::move(capture.text);
+    return result;
+}
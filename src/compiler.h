@@ -0,0 +1,168 @@
+#pragma once
+
+#include "header.h"
+#include "optimizer.h"
+#include "reflection.h"
+
+#include <glslang/Public/ShaderLang.h>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+// The in-memory compiler behind the command line, for linking glslop into other programs.
+// Nothing here touches the file system or global state: sources come from memory, includes
+// from a callback, and diagnostics are returned with the result.
+
+// An include found by an IncludeResolver.
+struct ResolvedInclude {
+    // Name the include is known by. Includes nested in it are resolved relative to this name,
+    // and it is listed in CompileResult::includedFiles.
+    std::string name;
+    // Null if there is no such include yet, when name is where it would be.
+    std::shared_ptr<const std::string> contents;
+};
+
+// Resolves #include "headerName" in the file includerName, which is the stage's file name for
+// includes in the top level source. Prints why and returns std::nullopt, or an include without
+// contents, if there is no such include. Called on the compiling threads, so it must be safe
+// to call concurrently.
+using IncludeResolver = std::function<std::optional<ResolvedInclude>(
+    const std::string& headerName,
+    const std::string& includerName
+)>;
+
+// Feeds includes from an IncludeResolver to glslang, and records what was included.
+class ShaderIncluder : public glslang::TShader::Includer {
+  public:
+    ShaderIncluder(std::string fileName, IncludeResolver resolver);
+
+    IncludeResult*
+    includeLocal(const char* headerName, const char* includerName, size_t depth) override;
+    void releaseInclude(IncludeResult* result) override;
+
+    // Every include resolved so far, in the order first included.
+    const std::vector<std::string>& includedFiles() const {
+        return included;
+    }
+
+    // Includes that weren't found, by the names the resolver gave where they would be, so
+    // that a watch can wait for them to appear.
+    const std::vector<std::string>& missingFiles() const {
+        return missing;
+    }
+
+  private:
+    std::string fileName;
+    IncludeResolver resolver;
+    std::vector<std::string> included;
+    std::vector<std::string> missing;
+};
+
+// One stage of a program, with its source in memory.
+struct StageSource {
+    EShLanguage stage = EShLangVertex;
+    // Name used in diagnostics, and to resolve includes in the top level source against.
+    std::string fileName;
+    std::string source;
+};
+
+// The preamble every stage is compiled with: the include extension, then defines, which is
+// extra source such as #define lines.
+std::string ShaderPreamble(const std::string& defines);
+
+// The GLSL, Vulkan and SPIR-V versions shaders are compiled for, as one value for cache keys.
+uint64_t TargetVersionKey();
+
+// Runs only the preprocessor, resolving includes, so the result can be used as a cache key.
+std::optional<std::string> PreprocessStage(
+    const StageSource& stage,
+    const std::string& preamble,
+    ShaderIncluder& includer
+);
+
+// Parses the stages, every one after the first on its own thread, links them into a program
+// and generates and optimizes its SPIR-V. includers has one includer per stage. Prints why and
+// returns std::nullopt if any step fails.
+std::optional<ShaderReflection> CompileStages(
+    const std::vector<StageSource>& stages,
+    const std::string& preamble,
+    const std::vector<std::unique_ptr<ShaderIncluder>>& includers,
+    const OptimizerOptions& optimizerOptions
+);
+
+// Programs compiled earlier, keyed by the preprocessed source of every stage, which includes
+// everything the stages include. The key doesn't cover the request's other settings, such as
+// its optimizer options, so a cache is either used with one set of them or mixes them into
+// its keys. Called on the compiling threads, so it must be safe to call concurrently.
+class ProgramCache {
+  public:
+    virtual ~ProgramCache() = default;
+
+    // The program compiled from these sources, or std::nullopt if there is none.
+    virtual std::optional<ShaderReflection>
+    load(const std::vector<std::string>& preprocessedSources) = 0;
+
+    // Keeps a program compiled from these sources.
+    virtual void store(
+        const std::vector<std::string>& preprocessedSources,
+        const ShaderReflection& reflection
+    ) = 0;
+};
+
+struct CompileRequest {
+    // Stages linked into one program, in pipeline order. Usually just one.
+    std::vector<StageSource> stages;
+    // Resolves includes. Without one every #include fails.
+    IncludeResolver includeResolver;
+    // Extra source compiled ahead of every stage, such as #define lines.
+    std::string defines;
+    OptimizerOptions optimizerOptions;
+    // Looks the program up before compiling it, and keeps it after, when set.
+    ProgramCache* cache = nullptr;
+
+    // Renders the header of the program too, when set. SpirvFormat::Pack is not supported, and
+    // with SpirvFormat::Embed the caller writes the SPIR-V files the header refers to. Its
+    // optimized flag follows optimizerOptions.
+    std::optional<HeaderOptions> header;
+    // Header symbol names and prefixes, as given with -n, -p and -g on the command line.
+    std::optional<std::string> name;
+    std::optional<std::string> structPrefix;
+    std::optional<std::string> globalPrefix;
+};
+
+struct CompileResult {
+    // SPIR-V and reflection of the program, unset if it failed to compile.
+    std::optional<ShaderReflection> reflection;
+    // Every include resolved by any stage, in the order first included. Collected whether or
+    // not the program compiled.
+    std::vector<std::string> includedFiles;
+    // Includes that weren't found, by the names the resolver gave where they would be.
+    std::vector<std::string> missingFiles;
+    // The header, if one was requested and the program compiled.
+    std::string header;
+    // Errors and warnings.
+    std::string log;
+
+    bool success() const {
+        return reflection.has_value();
+    }
+};
+
+// Keeps glslang's process-wide state initialized for as long as it exists. Compiling is
+// reentrant: any number of threads can compile with one Compiler at the same time, and several
+// Compilers can coexist.
+class Compiler {
+  public:
+    Compiler();
+    ~Compiler();
+
+    Compiler(const Compiler&) = delete;
+    Compiler& operator=(const Compiler&) = delete;
+
+    CompileResult compile(const CompileRequest& request) const;
+};
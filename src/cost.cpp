@@ -0,0 +1,631 @@
+#include "cost.h"
+#include "header.h"
+#include "json.h"
+#include "log.h"
+
+#include <algorithm>
+#include <charconv>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <string.h>
+
+// The SPIR-V opcodes the analysis needs, with their values from the SPIR-V specification.
+enum : uint32_t {
+    OpNop = 0,
+    OpUndef = 1,
+    OpLine = 8,
+    OpExtInstImport = 11,
+    OpExtInst = 12,
+    OpEntryPoint = 15,
+    OpTypeVoid = 19,
+    OpFunction = 54,
+    OpFunctionParameter = 55,
+    OpFunctionEnd = 56,
+    OpFunctionCall = 57,
+    OpVariable = 59,
+    OpStore = 62,
+    OpCopyMemory = 63,
+    OpCopyMemorySized = 64,
+    OpVectorShuffle = 79,
+    OpCompositeExtract = 81,
+    OpCompositeInsert = 82,
+    OpImageWrite = 99,
+    OpEmitVertex = 218,
+    OpEndStreamPrimitive = 221,
+    OpControlBarrier = 224,
+    OpMemoryBarrier = 225,
+    OpAtomicStore = 228,
+    OpPhi = 245,
+    OpLoopMerge = 246,
+    OpSelectionMerge = 247,
+    OpLabel = 248,
+    OpBranch = 249,
+    OpUnreachable = 255,
+    OpLifetimeStart = 256,
+    OpLifetimeStop = 257,
+    OpNoLine = 317,
+    OpAtomicFlagClear = 319,
+    OpTerminateInvocation = 4416,
+    OpDemoteToHelperInvocation = 5380,
+};
+
+enum class CostClass {
+    // Doesn't become code.
+    None,
+    Alu,
+    Texture,
+    Memory,
+    ControlFlow,
+    Other,
+};
+
+static CostClass ClassifyOpcode(uint32_t opcode) {
+    switch (opcode) {
+        case OpNop:
+        case OpUndef:
+        case OpLine:
+        case OpNoLine:
+        case OpFunction:
+        case OpFunctionParameter:
+        case OpFunctionEnd:
+        case OpVariable:
+        case OpLoopMerge:
+        case OpSelectionMerge:
+        case OpLabel:
+        case OpLifetimeStart:
+        case OpLifetimeStop:
+            return CostClass::None;
+        case OpFunctionCall:
+        case OpTerminateInvocation:
+        case OpDemoteToHelperInvocation:
+            return CostClass::ControlFlow;
+        case OpExtInst:
+        case 68: // OpArrayLength
+            return CostClass::Alu;
+        case OpPhi:
+            return CostClass::Other;
+        // OpAtomicFMinEXT, OpAtomicFMaxEXT and OpAtomicFAddEXT.
+        case 5614:
+        case 5615:
+        case 6035:
+            return CostClass::Memory;
+    }
+
+    // OpImageTexelPointer through OpInBoundsAccessChain, and OpInBoundsPtrAccessChain.
+    if ((opcode >= 60 && opcode <= 67) || opcode == 70) {
+        return CostClass::Memory;
+    }
+    // OpVectorExtractDynamic through OpTranspose.
+    if (opcode >= 77 && opcode <= 84) {
+        return CostClass::Alu;
+    }
+    // OpSampledImage through OpImageQuerySamples, and the sparse variants.
+    if ((opcode >= 86 && opcode <= 107) || (opcode >= 305 && opcode <= 316) || opcode == 320) {
+        return CostClass::Texture;
+    }
+    // Conversions, arithmetic, relational and logical operations, bit operations and
+    // derivatives, from OpConvertFToU to OpFwidthCoarse.
+    if (opcode >= 109 && opcode <= 215) {
+        return CostClass::Alu;
+    }
+    // Barriers, atomics and the atomic flags.
+    if ((opcode >= OpControlBarrier && opcode <= 242) || opcode == 318 ||
+        opcode == OpAtomicFlagClear) {
+        return CostClass::Memory;
+    }
+    // OpBranch through OpUnreachable.
+    if (opcode >= OpBranch && opcode <= OpUnreachable) {
+        return CostClass::ControlFlow;
+    }
+    // OpGroupNonUniformElect through OpGroupNonUniformQuadSwap.
+    if (opcode >= 333 && opcode <= 366) {
+        return CostClass::Alu;
+    }
+
+    return CostClass::Other;
+}
+
+// Whether an instruction inside a function has a result ID. Those that do have it as the
+// second operand, after the result type, except OpLabel.
+static bool HasResult(uint32_t opcode) {
+    switch (opcode) {
+        case OpNop:
+        case OpLine:
+        case OpNoLine:
+        case OpFunctionEnd:
+        case OpStore:
+        case OpCopyMemory:
+        case OpCopyMemorySized:
+        case OpImageWrite:
+        case OpControlBarrier:
+        case OpMemoryBarrier:
+        case OpAtomicStore:
+        case OpLoopMerge:
+        case OpSelectionMerge:
+        case OpLifetimeStart:
+        case OpLifetimeStop:
+        case OpAtomicFlagClear:
+        case OpTerminateInvocation:
+        case OpDemoteToHelperInvocation:
+            return false;
+    }
+
+    // Geometry shader emits, and the terminators from OpBranch on.
+    return !(opcode >= OpEmitVertex && opcode <= OpEndStreamPrimitive) &&
+           !(opcode >= OpBranch && opcode <= OpUnreachable);
+}
+
+// Index of the first operand that can be an ID use, skipping the result type and ID, and for
+// OpExtInst the instruction set, which isn't a value, and the literal instruction number.
+static size_t FirstUseOperand(uint32_t opcode) {
+    if (opcode == OpLabel) {
+        return 2;
+    }
+    if (opcode == OpExtInst) {
+        return 5;
+    }
+    return HasResult(opcode) ? 3 : 1;
+}
+
+// How many operands after the first use are IDs, for instructions ending in literals, or
+// SIZE_MAX to treat every operand as a possible ID.
+static size_t UseOperandCount(uint32_t opcode) {
+    switch (opcode) {
+        case OpVectorShuffle:
+            return 2;
+        case OpCompositeExtract:
+            return 1;
+        case OpCompositeInsert:
+            return 2;
+        case OpLoopMerge:
+        case OpSelectionMerge:
+            return 0;
+        default:
+            return SIZE_MAX;
+    }
+}
+
+static std::string ReadString(const uint32_t* words, size_t wordCount) {
+    const char* begin = reinterpret_cast<const char*>(words);
+    return std::string(begin, strnlen(begin, wordCount * sizeof(uint32_t)));
+}
+
+// What the analysis needs from one function.
+struct FunctionCost {
+    ShaderCost counts;
+    // Deepest loop nesting in the function itself.
+    uint32_t loopDepth = 0;
+    // Functions called, with the loop depth of each call.
+    std::vector<std::pair<uint32_t, uint32_t>> calls;
+};
+
+// Counts the instructions and loops of a function and estimates its register pressure.
+// words points at its OpFunction, and end past its OpFunctionEnd.
+static FunctionCost AnalyzeFunction(
+    const uint32_t* words,
+    const uint32_t* end,
+    const std::unordered_set<uint32_t>& voidTypes,
+    const std::unordered_set<uint32_t>& debugSets
+) {
+    FunctionCost result;
+
+    struct Loop {
+        size_t header;
+        uint32_t merge;
+        size_t mergePosition;
+    };
+
+    // Where each value is defined, and every use of one, by instruction position.
+    std::unordered_map<uint32_t, size_t> definitions;
+    std::vector<std::pair<uint32_t, size_t>> uses;
+    std::vector<Loop> loops;
+    // Loops whose merge block hasn't been reached, as indices into loops.
+    std::vector<size_t> openLoops;
+
+    size_t position = 0;
+    size_t blockStart = 0;
+    for (const uint32_t* word = words; word < end; word += *word >> 16, position++) {
+        uint32_t opcode = *word & 0xffff;
+        uint32_t wordCount = *word >> 16;
+
+        bool debugInfo = opcode == OpExtInst && wordCount > 3 && debugSets.count(word[3]) != 0;
+        CostClass costClass = debugInfo ? CostClass::None : ClassifyOpcode(opcode);
+
+        switch (costClass) {
+            case CostClass::None:
+                break;
+            case CostClass::Alu:
+                result.counts.alu++;
+                break;
+            case CostClass::Texture:
+                result.counts.texture++;
+                break;
+            case CostClass::Memory:
+                result.counts.memory++;
+                break;
+            case CostClass::ControlFlow:
+                result.counts.controlFlow++;
+                break;
+            case CostClass::Other:
+                break;
+        }
+        if (costClass != CostClass::None) {
+            result.counts.instructions++;
+        }
+
+        if (opcode == OpLabel && wordCount > 1) {
+            blockStart = position;
+
+            // Reaching a merge block closes its loop, and any loop left open inside it.
+            for (size_t i = 0; i < openLoops.size(); i++) {
+                Loop& loop = loops[openLoops[i]];
+                if (loop.merge == word[1]) {
+                    for (size_t j = i; j < openLoops.size(); j++) {
+                        loops[openLoops[j]].mergePosition = position;
+                    }
+                    openLoops.resize(i);
+                    break;
+                }
+            }
+        } else if (opcode == OpLoopMerge && wordCount > 1) {
+            loops.push_back({ blockStart, word[1], SIZE_MAX });
+            openLoops.push_back(loops.size() - 1);
+            result.loopDepth =
+                std::max(result.loopDepth, static_cast<uint32_t>(openLoops.size()));
+        } else if (opcode == OpFunctionCall && wordCount > 3) {
+            result.calls.push_back({ word[3], static_cast<uint32_t>(openLoops.size()) });
+        }
+
+        // Values, as opposed to blocks, pointers to function variables, debug info and the
+        // results of calls to void functions.
+        bool definesValue = HasResult(opcode) && opcode != OpLabel && opcode != OpVariable &&
+                            opcode != OpFunction && !debugInfo && wordCount > 2 &&
+                            voidTypes.count(word[1]) == 0;
+        if (definesValue) {
+            definitions[word[2]] = position;
+        }
+
+        // Debug info refers to values without keeping them alive.
+        size_t first = debugInfo ? wordCount : FirstUseOperand(opcode);
+        size_t last = wordCount;
+        if (UseOperandCount(opcode) != SIZE_MAX) {
+            last = std::min(last, first + UseOperandCount(opcode));
+        }
+        for (size_t i = first; i < last; i++) {
+            uses.push_back({ word[i], position });
+        }
+    }
+
+    // Every value lives from its definition to its last use, and values defined before a loop
+    // and used inside it live until the loop ends, as they are needed on every iteration.
+    std::unordered_map<uint32_t, size_t> lastUses;
+    for (const auto& [id, usePosition] : uses) {
+        auto definition = definitions.find(id);
+        if (definition == definitions.end()) {
+            continue;
+        }
+
+        size_t lastUse = std::max(usePosition, definition->second);
+        for (const Loop& loop : loops) {
+            if (definition->second < loop.header && usePosition >= loop.header &&
+                usePosition < loop.mergePosition && loop.mergePosition != SIZE_MAX) {
+                lastUse = std::max(lastUse, loop.mergePosition);
+            }
+        }
+
+        size_t& current = lastUses[id];
+        current = std::max(current, lastUse);
+    }
+
+    std::vector<std::pair<size_t, int>> events;
+    for (const auto& [id, definition] : definitions) {
+        auto lastUse = lastUses.find(id);
+        events.push_back({ definition, 1 });
+        size_t end = lastUse != lastUses.end() ? lastUse->second : definition;
+        events.push_back({ end + 1, -1 });
+    }
+    // Ends sort before starts at the same position.
+    std::sort(events.begin(), events.end());
+
+    int live = 0;
+    for (const auto& [eventPosition, change] : events) {
+        live += change;
+        result.counts.maxLiveIds =
+            std::max(result.counts.maxLiveIds, static_cast<uint32_t>(std::max(live, 0)));
+    }
+
+    return result;
+}
+
+const std::vector<CostMetric>& CostMetrics() {
+    static const std::vector<CostMetric> s_metrics = {
+        { "instructions", &ShaderCost::instructions },
+        { "alu", &ShaderCost::alu },
+        { "texture", &ShaderCost::texture },
+        { "memory", &ShaderCost::memory },
+        { "controlFlow", &ShaderCost::controlFlow },
+        { "loopDepth", &ShaderCost::loopDepth },
+        { "maxLiveIds", &ShaderCost::maxLiveIds },
+        { "descriptors", &ShaderCost::descriptors },
+        { "pushConstantBytes", &ShaderCost::pushConstantBytes },
+    };
+    return s_metrics;
+}
+
+std::vector<ShaderCost> AnalyzeCost(
+    const std::vector<uint32_t>& spirv,
+    EShLanguage stage,
+    const ShaderReflection& reflection
+) {
+    // Past the header: magic, version, generator, bound and schema.
+    if (spirv.size() < 5) {
+        return {};
+    }
+
+    std::unordered_set<uint32_t> voidTypes;
+    std::unordered_set<uint32_t> debugSets;
+    std::vector<std::pair<uint32_t, std::string>> entryPoints;
+    std::unordered_map<uint32_t, FunctionCost> functions;
+
+    const uint32_t* end = spirv.data() + spirv.size();
+    const uint32_t* function = nullptr;
+    for (const uint32_t* word = spirv.data() + 5; word < end; word += *word >> 16) {
+        uint32_t opcode = *word & 0xffff;
+        uint32_t wordCount = *word >> 16;
+        if (wordCount == 0 || word + wordCount > end) {
+            return {};
+        }
+
+        if (opcode == OpExtInstImport && wordCount > 2) {
+            if (ReadString(word + 2, wordCount - 2).rfind("NonSemantic.", 0) == 0) {
+                debugSets.insert(word[1]);
+            }
+        } else if (opcode == OpEntryPoint && wordCount > 3) {
+            entryPoints.push_back({ word[2], ReadString(word + 3, wordCount - 3) });
+        } else if (opcode == OpTypeVoid && wordCount > 1) {
+            voidTypes.insert(word[1]);
+        } else if (opcode == OpFunction) {
+            function = word;
+        } else if (opcode == OpFunctionEnd && function && function[0] >> 16 > 2) {
+            functions[function[2]] =
+                AnalyzeFunction(function, word + wordCount, voidTypes, debugSets);
+            function = nullptr;
+        }
+    }
+
+    uint32_t descriptors = 0;
+    for (const ReflectedObject* descriptor : DescriptorBindings(reflection)) {
+        if (descriptor->stageFlags & VulkanStageFlag(stage)) {
+            descriptors++;
+        }
+    }
+
+    uint32_t pushConstantBytes = 0;
+    for (const ReflectedObject* block : PushConstantBlocks(reflection)) {
+        if (block->stageFlags & VulkanStageFlag(stage)) {
+            pushConstantBytes += PushConstantBlockRange(*block).size;
+        }
+    }
+
+    std::vector<ShaderCost> costs;
+    for (const auto& [entryFunction, name] : entryPoints) {
+        ShaderCost cost;
+        cost.stage = stage;
+        cost.entryPoint = name;
+        cost.descriptors = descriptors;
+        cost.pushConstantBytes = pushConstantBytes;
+
+        // Every function reachable from the entry point counts once. GLSL has no recursion,
+        // so the call graph is acyclic, but a malformed module could still loop.
+        std::unordered_map<uint32_t, uint32_t> loopDepths;
+        std::unordered_set<uint32_t> visiting;
+        auto visit = [&](uint32_t id, auto& self) -> uint32_t {
+            auto known = loopDepths.find(id);
+            if (known != loopDepths.end()) {
+                return known->second;
+            }
+            auto found = functions.find(id);
+            if (found == functions.end() || !visiting.insert(id).second) {
+                return 0;
+            }
+
+            const FunctionCost& function = found->second;
+            cost.instructions += function.counts.instructions;
+            cost.alu += function.counts.alu;
+            cost.texture += function.counts.texture;
+            cost.memory += function.counts.memory;
+            cost.controlFlow += function.counts.controlFlow;
+            cost.maxLiveIds = std::max(cost.maxLiveIds, function.counts.maxLiveIds);
+
+            uint32_t depth = function.loopDepth;
+            for (const auto& [callee, callDepth] : function.calls) {
+                depth = std::max(depth, callDepth + self(callee, self));
+            }
+
+            loopDepths[id] = depth;
+            return depth;
+        };
+        cost.loopDepth = visit(entryFunction, visit);
+
+        costs.push_back(std::move(cost));
+    }
+
+    return costs;
+}
+
+std::optional<CostLimit> ParseCostLimit(std::string_view limit) {
+    size_t equals = limit.find('=');
+    if (equals == std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    std::string_view name = limit.substr(0, equals);
+    std::string_view value = limit.substr(equals + 1);
+
+    CostLimit result;
+    for (const CostMetric& metric : CostMetrics()) {
+        if (name == metric.name) {
+            result.metric = &metric;
+        }
+    }
+
+    std::from_chars_result parsed =
+        std::from_chars(value.data(), value.data() + value.size(), result.limit);
+    bool parsedAll = parsed.ec == std::errc() && parsed.ptr == value.data() + value.size();
+    if (!result.metric || !parsedAll) {
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+// How an entry point is named in messages, e.g. "shader [VARIANT] frag main".
+static std::string DescribeEntryPoint(const ShaderCost& cost) {
+    std::string description = cost.shader;
+    if (!cost.variant.empty()) {
+        description += " [" + cost.variant + "]";
+    }
+    return description + " " + StageName(cost.stage) + " " + cost.entryPoint;
+}
+
+bool CheckCostLimits(
+    const std::vector<ShaderCost>& costs,
+    const std::vector<CostLimit>& limits
+) {
+    bool withinLimits = true;
+    for (const ShaderCost& cost : costs) {
+        for (const CostLimit& limit : limits) {
+            uint32_t value = cost.*limit.metric->value;
+            if (value > limit.limit) {
+                Print(
+                    "%s: %s is %u, over the limit of %u\n",
+                    DescribeEntryPoint(cost).c_str(),
+                    limit.metric->name,
+                    value,
+                    limit.limit
+                );
+                withinLimits = false;
+            }
+        }
+    }
+    return withinLimits;
+}
+
+static bool SameEntryPoint(const ShaderCost& a, const ShaderCost& b) {
+    return a.shader == b.shader && a.variant == b.variant && a.stage == b.stage &&
+           a.entryPoint == b.entryPoint;
+}
+
+std::string FormatCostReport(
+    const std::vector<ShaderCost>& costs,
+    const std::vector<ShaderCost>* baseline
+) {
+    std::stringstream json;
+    json << "{\n";
+    json << "  \"shaders\": [";
+
+    for (size_t i = 0; i < costs.size(); i++) {
+        const ShaderCost& cost = costs[i];
+
+        json << (i == 0 ? "\n" : ",\n") << "    { \"shader\": " << JsonString(cost.shader);
+        if (!cost.variant.empty()) {
+            json << ", \"variant\": " << JsonString(cost.variant);
+        }
+        json << ", \"stage\": " << JsonString(StageName(cost.stage))
+             << ", \"entryPoint\": " << JsonString(cost.entryPoint);
+
+        for (const CostMetric& metric : CostMetrics()) {
+            json << ", \"" << metric.name << "\": " << cost.*metric.value;
+        }
+
+        if (baseline) {
+            auto previous =
+                std::find_if(baseline->begin(), baseline->end(), [&](const ShaderCost& entry) {
+                    return SameEntryPoint(entry, cost);
+                });
+
+            json << ", \"diff\": ";
+            if (previous == baseline->end()) {
+                json << "null";
+            } else {
+                json << "{ ";
+                for (size_t j = 0; j < CostMetrics().size(); j++) {
+                    const CostMetric& metric = CostMetrics()[j];
+                    int64_t change = static_cast<int64_t>(cost.*metric.value) -
+                                     static_cast<int64_t>(*previous.*metric.value);
+                    json << (j == 0 ? "" : ", ") << "\"" << metric.name << "\": " << change;
+                }
+                json << " }";
+            }
+        }
+
+        json << " }";
+    }
+
+    json << "\n  ]\n";
+    json << "}\n";
+    return json.str();
+}
+
+std::optional<std::vector<ShaderCost>>
+ParseCostReport(std::string_view report, const std::string& fileName) {
+    std::optional<JsonValue> json = ParseJson(report);
+    const JsonValue* shaders = json ? json->find("shaders") : nullptr;
+    if (!shaders || shaders->type != JsonValue::Type::Array) {
+        Print("%s: not a cost report\n", fileName.c_str());
+        return std::nullopt;
+    }
+
+    std::vector<ShaderCost> costs;
+    for (const JsonValue& entry : shaders->array) {
+        auto string = [&](const char* key) -> std::optional<std::string> {
+            const JsonValue* value = entry.find(key);
+            if (value && value->type == JsonValue::Type::String) {
+                return value->string;
+            }
+            return std::nullopt;
+        };
+
+        std::optional<std::string> shader = string("shader");
+        std::optional<std::string> stage = string("stage");
+        std::optional<std::string> entryPoint = string("entryPoint");
+        if (!shader || !stage || !entryPoint) {
+            Print(
+                "%s: cost report entry without a shader, stage or entry point\n",
+                fileName.c_str()
+            );
+            return std::nullopt;
+        }
+
+        ShaderCost cost;
+        cost.shader = *shader;
+        cost.variant = string("variant").value_or("");
+        cost.entryPoint = *entryPoint;
+
+        bool knownStage = false;
+        for (int i = EShLangVertex; i <= EShLangCompute; i++) {
+            if (*stage == StageName(static_cast<EShLanguage>(i))) {
+                cost.stage = static_cast<EShLanguage>(i);
+                knownStage = true;
+            }
+        }
+        if (!knownStage) {
+            Print("%s: unknown stage %s\n", fileName.c_str(), stage->c_str());
+            return std::nullopt;
+        }
+
+        // Metrics missing from older reports stay 0.
+        for (const CostMetric& metric : CostMetrics()) {
+            const JsonValue* value = entry.find(metric.name);
+            if (value && value->type == JsonValue::Type::Number && value->number >= 0) {
+                cost.*metric.value = static_cast<uint32_t>(value->number);
+            }
+        }
+
+        costs.push_back(std::move(cost));
+    }
+
+    return costs;
+}
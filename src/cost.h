@@ -0,0 +1,90 @@
+#pragma once
+
+#include "reflection.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <stdint.h>
+
+// Static metrics of one entry point of a SPIR-V module, as a rough guide to what it costs
+// on the GPU. Functions called from the entry point are counted once each, however often
+// they are called.
+struct ShaderCost {
+    // Name of the shader, and the variant for permuted inputs, filled in by the caller.
+    std::string shader;
+    std::string variant;
+    EShLanguage stage = EShLangVertex;
+    std::string entryPoint;
+
+    // Instructions that end up as code, by class. Debug info, labels, merge annotations and
+    // variable declarations aren't counted.
+    uint32_t instructions = 0;
+    // Arithmetic, logic, conversions, composite access, extended instructions such as
+    // GLSL.std.450, derivatives and subgroup operations.
+    uint32_t alu = 0;
+    // Sampling, fetches, gathers, image reads, writes and queries.
+    uint32_t texture = 0;
+    // Loads, stores, access chains, atomics and barriers.
+    uint32_t memory = 0;
+    // Branches, switches, calls, returns and kills.
+    uint32_t controlFlow = 0;
+    // Deepest nesting of loops, following calls.
+    uint32_t loopDepth = 0;
+    // Most SSA values live at the same point of any one function, as a proxy for register
+    // pressure. Values used inside a loop stay live until the loop ends.
+    uint32_t maxLiveIds = 0;
+    // Descriptor bindings and push constant bytes the stage of the entry point uses.
+    uint32_t descriptors = 0;
+    uint32_t pushConstantBytes = 0;
+};
+
+// A metric of ShaderCost, by the name it has in reports and limits.
+struct CostMetric {
+    const char* name;
+    uint32_t ShaderCost::*value;
+};
+
+// Every metric, in report order.
+const std::vector<CostMetric>& CostMetrics();
+
+// Analyzes every entry point of the module of a stage. The descriptors and push constants
+// come from the reflection of the program the module belongs to. Returns an empty list if
+// the module is malformed.
+std::vector<ShaderCost> AnalyzeCost(
+    const std::vector<uint32_t>& spirv,
+    EShLanguage stage,
+    const ShaderReflection& reflection
+);
+
+// An upper bound on a metric, given as <metric>=<value>.
+struct CostLimit {
+    const CostMetric* metric = nullptr;
+    uint32_t limit = 0;
+};
+
+std::optional<CostLimit> ParseCostLimit(std::string_view limit);
+
+// Prints every metric over its limit. Returns false if there were any.
+bool CheckCostLimits(
+    const std::vector<ShaderCost>& costs,
+    const std::vector<CostLimit>& limits
+);
+
+// Formats the metrics of every entry point as a JSON report:
+//
+//   { "shaders": [ { "shader", "variant", "stage", "entryPoint", <metrics>...,
+//                    "diff": { <metrics>... } }, ... ] }
+//
+// variant is only there for permuted inputs. With a baseline, such as the report of the
+// previous commit, diff has the change in each metric of the entry point with the same
+// shader, variant, stage and name, or is null if the baseline doesn't have it.
+std::string
+FormatCostReport(const std::vector<ShaderCost>& costs, const std::vector<ShaderCost>* baseline);
+
+// Reads a report written by FormatCostReport back. Prints why and returns std::nullopt if it
+// isn't one.
+std::optional<std::vector<ShaderCost>>
+ParseCostReport(std::string_view report, const std::string& fileName);
@@ -0,0 +1,296 @@
+#include "glslop.h"
+#include "compiler.h"
+#include "layout.h"
+#include "log.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <new>
+
+#include <string.h>
+
+struct glslop_compiler {
+    Compiler compiler;
+};
+
+struct glslop_result {
+    CompileResult result;
+    std::vector<glslop_descriptor> descriptors;
+    std::vector<glslop_push_constant_block> pushConstantBlocks;
+    std::vector<glslop_object> objects[GLSLOP_OBJECT_PIPE_OUTPUT + 1];
+    // What the objects point to. Deques, so that adding to them never moves an element.
+    std::deque<std::vector<glslop_member>> members;
+    std::deque<std::string> typeNames;
+};
+
+// Adapts the C include callbacks. The contents are copied, so the caller's memory is only
+// borrowed for the duration of the callback.
+static IncludeResolver CallbackIncludeResolver(const glslop_compile_info& info) {
+    if (!info.include_callback) {
+        return nullptr;
+    }
+
+    glslop_include_callback callback = info.include_callback;
+    glslop_include_release_callback release = info.include_release_callback;
+    void* userData = info.include_user_data;
+
+    return [callback, release, userData](
+               const std::string& headerName,
+               const std::string& includerName
+           ) -> std::optional<ResolvedInclude> {
+        glslop_include include = {};
+        if (!callback(userData, headerName.c_str(), includerName.c_str(), &include)) {
+            Print("Failed to open include file %s\n", headerName.c_str());
+            return std::nullopt;
+        }
+
+        ResolvedInclude result;
+        result.name = include.name ? include.name : headerName;
+        result.contents = std::make_shared<const std::string>(
+            include.contents ? include.contents : "",
+            include.contents ? include.contents_size : 0
+        );
+
+        if (release) {
+            release(userData, &include);
+        }
+
+        return result;
+    };
+}
+
+static CompileRequest MakeRequest(const glslop_compile_info& info) {
+    CompileRequest request;
+
+    for (size_t i = 0; i < info.stage_count; i++) {
+        const glslop_stage_source& stage = info.stages[i];
+        request.stages.push_back({
+            static_cast<EShLanguage>(stage.stage),
+            stage.file_name ? stage.file_name : "",
+            std::string(stage.source ? stage.source : "", stage.source ? stage.source_size : 0),
+        });
+    }
+
+    request.includeResolver = CallbackIncludeResolver(info);
+    request.defines = info.defines ? info.defines : "";
+
+    switch (info.optimization) {
+        case GLSLOP_OPTIMIZATION_PERFORMANCE:
+            request.optimizerOptions.level = OptimizationLevel::Performance;
+            break;
+        case GLSLOP_OPTIMIZATION_SIZE:
+            request.optimizerOptions.level = OptimizationLevel::Size;
+            break;
+        default:
+            request.optimizerOptions.level = OptimizationLevel::None;
+            break;
+    }
+    request.optimizerOptions.stripDebugInfo = info.strip_debug_info != 0;
+    request.optimizerOptions.validate = info.validate != 0;
+
+    if (info.generate_header) {
+        request.header = HeaderOptions();
+
+        if (info.name) {
+            request.name = info.name;
+        }
+        if (info.struct_prefix) {
+            request.structPrefix = info.struct_prefix;
+        }
+        if (info.global_prefix) {
+            request.globalPrefix = info.global_prefix;
+        }
+    }
+
+    return request;
+}
+
+// Fills the tables the accessors return, which point into the reflection of the result.
+static void FillTables(glslop_result& result) {
+    if (!result.result.reflection) {
+        return;
+    }
+    const ShaderReflection& reflection = *result.result.reflection;
+
+    for (const ReflectedObject* descriptor : DescriptorBindings(reflection)) {
+        result.descriptors.push_back({
+            static_cast<uint32_t>(descriptor->set),
+            static_cast<uint32_t>(descriptor->binding),
+            static_cast<int32_t>(descriptor->descriptorType),
+            DescriptorCount(*descriptor),
+            descriptor->stageFlags,
+            descriptor->name.c_str(),
+        });
+    }
+
+    for (const ReflectedObject* block : PushConstantBlocks(reflection)) {
+        PushConstantRange range = PushConstantBlockRange(*block);
+        result.pushConstantBlocks.push_back({
+            block->stageFlags,
+            range.offset,
+            range.size,
+            block->name.c_str(),
+        });
+    }
+
+    const std::vector<ReflectedObject>* lists[] = {
+        &reflection.uniformBlocks,
+        &reflection.bufferBlocks,
+        &reflection.uniforms,
+        &reflection.pipeInputs,
+        &reflection.pipeOutputs,
+    };
+    const std::vector<ShaderMember> noMembers;
+    for (int kind = GLSLOP_OBJECT_UNIFORM_BLOCK; kind <= GLSLOP_OBJECT_PIPE_OUTPUT; kind++) {
+        for (const ReflectedObject& object : *lists[kind]) {
+            bool isBlock = object.type.basicType == glslang::EbtBlock;
+
+            std::vector<glslop_member>& members = result.members.emplace_back();
+            for (const ShaderMember& member : isBlock ? object.type.members : noMembers) {
+                uint32_t arraySize = 1;
+                for (int size : member.type.arraySizes) {
+                    arraySize *= size;
+                }
+
+                members.push_back({
+                    member.name.c_str(),
+                    result.typeNames.emplace_back(GlslTypeName(member.type)).c_str(),
+                    static_cast<uint32_t>(member.type.offset),
+                    static_cast<uint32_t>(member.type.size),
+                    arraySize,
+                    static_cast<uint32_t>(member.type.arrayStride),
+                    static_cast<uint32_t>(member.type.matrixStride),
+                    member.type.rowMajor,
+                });
+            }
+
+            int size = object.type.isArray() ? object.type.elementSize : object.type.size;
+            result.objects[kind].push_back({
+                object.name.c_str(),
+                object.set,
+                object.descriptorType != DescriptorType::None ? object.binding : -1,
+                object.location,
+                static_cast<int32_t>(object.descriptorType),
+                object.pushConstant,
+                object.stageFlags,
+                DescriptorCount(object),
+                isBlock ? static_cast<uint32_t>(size) : 0,
+                members.data(),
+                members.size(),
+            });
+        }
+    }
+}
+
+static bool IsObjectKind(glslop_object_kind kind) {
+    return static_cast<unsigned>(kind) <= GLSLOP_OBJECT_PIPE_OUTPUT;
+}
+
+extern "C" {
+
+// No exception may leave these functions, as C callers can't catch it.
+
+glslop_compiler* glslop_compiler_create(void) {
+    try {
+        return new glslop_compiler;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void glslop_compiler_destroy(glslop_compiler* compiler) {
+    delete compiler;
+}
+
+glslop_result*
+glslop_compile(const glslop_compiler* compiler, const glslop_compile_info* info) {
+    try {
+        std::unique_ptr<glslop_result> result = std::make_unique<glslop_result>();
+        std::string error;
+        try {
+            result->result = compiler->compiler.compile(MakeRequest(*info));
+            FillTables(*result);
+        } catch (const std::bad_alloc&) {
+            throw;
+        } catch (const std::exception& exception) {
+            error = exception.what();
+        } catch (...) {
+            error = "unknown exception";
+        }
+
+        // Anything but running out of memory fails the compile, with the error in the log.
+        if (!error.empty()) {
+            result = std::make_unique<glslop_result>();
+            result->result.log = "Internal error: " + error + "\n";
+        }
+        return result.release();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void glslop_result_free(glslop_result* result) {
+    delete result;
+}
+
+int glslop_result_success(const glslop_result* result) {
+    return result->result.success();
+}
+
+const char* glslop_result_log(const glslop_result* result) {
+    return result->result.log.c_str();
+}
+
+size_t glslop_result_stage_count(const glslop_result* result) {
+    return result->result.reflection ? result->result.reflection->stages.size() : 0;
+}
+
+const uint32_t*
+glslop_result_spirv(const glslop_result* result, size_t stage, size_t* word_count) {
+    if (stage >= glslop_result_stage_count(result)) {
+        *word_count = 0;
+        return nullptr;
+    }
+
+    const std::vector<uint32_t>& spirv = result->result.reflection->stages[stage].spirv;
+    *word_count = spirv.size();
+    return spirv.data();
+}
+
+size_t glslop_result_descriptor_count(const glslop_result* result) {
+    return result->descriptors.size();
+}
+
+const glslop_descriptor* glslop_result_descriptors(const glslop_result* result) {
+    return result->descriptors.data();
+}
+
+size_t glslop_result_push_constant_block_count(const glslop_result* result) {
+    return result->pushConstantBlocks.size();
+}
+
+const glslop_push_constant_block*
+glslop_result_push_constant_blocks(const glslop_result* result) {
+    return result->pushConstantBlocks.data();
+}
+
+size_t glslop_result_object_count(const glslop_result* result, glslop_object_kind kind) {
+    return IsObjectKind(kind) ? result->objects[kind].size() : 0;
+}
+
+const glslop_object*
+glslop_result_objects(const glslop_result* result, glslop_object_kind kind) {
+    return IsObjectKind(kind) ? result->objects[kind].data() : nullptr;
+}
+
+size_t glslop_result_header(const glslop_result* result, char* buffer, size_t size) {
+    const std::string& header = result->result.header;
+    if (buffer && size > 0) {
+        size_t copied = std::min(header.size(), size - 1);
+        memcpy(buffer, header.data(), copied);
+        buffer[copied] = '\0';
+    }
+    return header.size();
+}
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+// C interface of the glslop library, for compiling shaders held in memory from other programs
+// and languages. The C++ interface is in compiler.h.
+//
+// A glslop_compiler can be shared by any number of threads compiling at the same time. Each
+// compile returns a glslop_result owning everything it produced, which stays valid until it is
+// freed. The library keeps no other state, and nothing is read from or written to disk.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct glslop_compiler glslop_compiler;
+typedef struct glslop_result glslop_result;
+
+// The values of glslang's EShLanguage.
+typedef enum glslop_stage {
+    GLSLOP_STAGE_VERTEX = 0,
+    GLSLOP_STAGE_TESS_CONTROL = 1,
+    GLSLOP_STAGE_TESS_EVALUATION = 2,
+    GLSLOP_STAGE_GEOMETRY = 3,
+    GLSLOP_STAGE_FRAGMENT = 4,
+    GLSLOP_STAGE_COMPUTE = 5,
+} glslop_stage;
+
+typedef enum glslop_optimization {
+    GLSLOP_OPTIMIZATION_NONE = 0,
+    GLSLOP_OPTIMIZATION_PERFORMANCE = 1,
+    GLSLOP_OPTIMIZATION_SIZE = 2,
+} glslop_optimization;
+
+typedef struct glslop_stage_source {
+    glslop_stage stage;
+    // Name used in diagnostics, and passed to the include callback for includes in the top
+    // level source.
+    const char* file_name;
+    // The GLSL source, which doesn't need to be null terminated.
+    const char* source;
+    size_t source_size;
+} glslop_stage_source;
+
+// An include found by a glslop_include_callback. name is what nested includes see as their
+// includer_name. Both are copied as soon as the callback returns, after which the release
+// callback, if any, is called with the same include.
+typedef struct glslop_include {
+    const char* name;
+    const char* contents;
+    size_t contents_size;
+} glslop_include;
+
+// Resolves #include "header_name" in the file includer_name. Returns 0 if there is no such
+// include, which fails the compile. Can be called from several threads at once.
+typedef int (*glslop_include_callback)(
+    void* user_data,
+    const char* header_name,
+    const char* includer_name,
+    glslop_include* include
+);
+typedef void (*glslop_include_release_callback)(void* user_data, const glslop_include* include);
+
+typedef struct glslop_compile_info {
+    // Stages linked into one program, in pipeline order.
+    const glslop_stage_source* stages;
+    size_t stage_count;
+
+    // Extra source compiled ahead of every stage, such as #define lines, or NULL.
+    const char* defines;
+
+    // Resolves includes, or NULL to fail every #include.
+    glslop_include_callback include_callback;
+    glslop_include_release_callback include_release_callback;
+    void* include_user_data;
+
+    glslop_optimization optimization;
+    int strip_debug_info;
+    int validate;
+
+    // Renders the header of the program into the result when non-zero, named and prefixed as
+    // with -n, -p and -g on the command line. Any of the names can be NULL.
+    int generate_header;
+    const char* name;
+    const char* struct_prefix;
+    const char* global_prefix;
+} glslop_compile_info;
+
+// The values match VkDescriptorSetLayoutBinding and VkPushConstantRange.
+typedef struct glslop_descriptor {
+    uint32_t set;
+    uint32_t binding;
+    // A VkDescriptorType.
+    int32_t descriptor_type;
+    // 0 for variable sized arrays.
+    uint32_t count;
+    uint32_t stage_flags;
+    const char* name;
+} glslop_descriptor;
+
+// Not named glslop_push_constant_range, which generated headers define without a name, so
+// this header and those can be included together.
+typedef struct glslop_push_constant_block {
+    uint32_t stage_flags;
+    uint32_t offset;
+    uint32_t size;
+    const char* name;
+} glslop_push_constant_block;
+
+// The lists of reflected objects of a program.
+typedef enum glslop_object_kind {
+    GLSLOP_OBJECT_UNIFORM_BLOCK = 0,
+    GLSLOP_OBJECT_BUFFER_BLOCK = 1,
+    // Uniforms outside blocks: samplers, images and other opaque types.
+    GLSLOP_OBJECT_UNIFORM = 2,
+    // Inputs of the first stage, the vertex attributes of a vertex shader.
+    GLSLOP_OBJECT_PIPE_INPUT = 3,
+    // Outputs of the last stage.
+    GLSLOP_OBJECT_PIPE_OUTPUT = 4,
+} glslop_object_kind;
+
+// A member of a block, with its layout in bytes. Nested structs aren't expanded.
+typedef struct glslop_member {
+    const char* name;
+    // GLSL type without array dimensions, e.g. vec3, or the name of a struct.
+    const char* type_name;
+    uint32_t offset;
+    uint32_t size;
+    // Elements of an array, flattened: 1 if the member isn't an array, 0 if it's unsized.
+    uint32_t array_size;
+    uint32_t array_stride;
+    uint32_t matrix_stride;
+    int row_major;
+} glslop_member;
+
+// A block, uniform, input or output of a program.
+typedef struct glslop_object {
+    const char* name;
+    // -1 where the object has none.
+    int32_t set;
+    int32_t binding;
+    int32_t location;
+    // A VkDescriptorType, or -1 if the object isn't a descriptor.
+    int32_t descriptor_type;
+    int push_constant;
+    uint32_t stage_flags;
+    // Elements of an array, including arrays of blocks, flattened: 1 if the object isn't an
+    // array, 0 if it's unsized.
+    uint32_t array_size;
+    // Bytes of a block, or of one element of an array of blocks. 0 for other objects.
+    uint32_t size;
+    // Members of a block, in declaration order.
+    const glslop_member* members;
+    size_t member_count;
+} glslop_object;
+
+// Returns NULL if out of memory.
+glslop_compiler* glslop_compiler_create(void);
+void glslop_compiler_destroy(glslop_compiler* compiler);
+
+// Compiles a program. Only returns NULL if out of memory: a program that fails to compile
+// still has a result, with the errors in its log.
+glslop_result* glslop_compile(const glslop_compiler* compiler, const glslop_compile_info* info);
+void glslop_result_free(glslop_result* result);
+
+int glslop_result_success(const glslop_result* result);
+// Errors and warnings, null terminated. Empty if there were none.
+const char* glslop_result_log(const glslop_result* result);
+
+// The SPIR-V of each linked stage, in the order the stages were given.
+size_t glslop_result_stage_count(const glslop_result* result);
+const uint32_t*
+glslop_result_spirv(const glslop_result* result, size_t stage, size_t* word_count);
+
+// Descriptors sorted by set and binding.
+size_t glslop_result_descriptor_count(const glslop_result* result);
+const glslop_descriptor* glslop_result_descriptors(const glslop_result* result);
+
+size_t glslop_result_push_constant_block_count(const glslop_result* result);
+const glslop_push_constant_block*
+glslop_result_push_constant_blocks(const glslop_result* result);
+
+// Objects of one kind, as glslang reflects them. Push constant blocks are uniform blocks.
+size_t glslop_result_object_count(const glslop_result* result, glslop_object_kind kind);
+const glslop_object*
+glslop_result_objects(const glslop_result* result, glslop_object_kind kind);
+
+// Copies the header, null terminated and truncated to fit, into buffer like snprintf, and
+// returns its length. Call with a NULL buffer and size 0 to get the size to allocate. The
+// header is empty unless it was requested and the program compiled.
+size_t glslop_result_header(const glslop_result* result, char* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <string_view>
+
+// 64-bit FNV-1a, used to key cache entries and identify shader contents.
+struct Hasher {
+    uint64_t state = 14695981039346656037ull;
+
+    void update(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            state ^= bytes[i];
+            state *= 1099511628211ull;
+        }
+    }
+
+    void update(uint64_t value) {
+        update(&value, sizeof(value));
+    }
+
+    // Strings are length prefixed so that ("ab", "c") and ("a", "bc") hash differently.
+    void update(std::string_view value) {
+        update(static_cast<uint64_t>(value.size()));
+        update(value.data(), value.size());
+    }
+
+    uint64_t digest() const {
+        return state;
+    }
+};
+
+static inline std::string HashToString(uint64_t hash) {
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
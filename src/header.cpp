@@ -0,0 +1,1973 @@
+#include "header.h"
+#include "hash.h"
+#include "log.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <sstream>
+#include <unordered_set>
+
+#include <ctype.h>
+#include <stdio.h>
+
+// Short name of a stage, as used in file extensions and generated symbol names.
+const char* StageName(EShLanguage stage) {
+    switch (stage) {
+        case EShLangVertex:
+            return "vert";
+        case EShLangTessControl:
+            return "tesc";
+        case EShLangTessEvaluation:
+            return "tese";
+        case EShLangGeometry:
+            return "geom";
+        case EShLangFragment:
+            return "frag";
+        case EShLangCompute:
+            return "comp";
+        default:
+            return "unknown";
+    }
+}
+
+std::string ShaderName(const ShaderInput& input) {
+    if (input.name) {
+        return *input.name;
+    }
+
+    const std::string& inputFile = input.stages[0].inputFile;
+    size_t lastSlash = inputFile.find_last_of("/\\");
+    std::string name = inputFile.substr(lastSlash + 1, inputFile.size() - lastSlash - 1);
+
+    if (input.isLinked()) {
+        // The stages of a linked program share a name, so drop the stage extension.
+        name = name.substr(0, name.find('.'));
+    }
+
+    // The name starts every symbol of the header, so anything that can't be part of a C
+    // identifier becomes an underscore, e.g. "blur-h.frag" is blur_h_frag.
+    for (char& c : name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '_') {
+            c = '_';
+        }
+    }
+    if (name.empty() || isdigit(static_cast<unsigned char>(name[0]))) {
+        name = "_" + name;
+    }
+    return name;
+}
+
+
+std::string SpirvSidecarPath(
+    const ShaderInput& input,
+    EShLanguage stage,
+    std::optional<size_t> module
+) {
+    std::string extension = ".spv";
+    if (module) {
+        extension = "." + std::to_string(*module) + extension;
+    }
+    if (input.isLinked()) {
+        extension = std::string(".") + StageName(stage) + extension;
+    }
+    return std::filesystem::path(input.outputFile).replace_extension(extension).string();
+}
+
+std::string LayoutIncludePath(const ShaderInput& input) {
+    return std::filesystem::path(input.outputFile).replace_extension(".layout.glsl").string();
+}
+
+static const char* s_shaderHeaderPrelude = R"(#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+)";
+
+static const char* s_shaderHeaderPostlude = R"(#ifdef __cplusplus
+}
+#endif
+)";
+
+static const char* s_staticAssertDefinition = R"(#ifndef GLSLOP_STATIC_ASSERT
+#ifdef __cplusplus
+#define GLSLOP_STATIC_ASSERT(condition, message) static_assert(condition, message)
+#else
+#define GLSLOP_STATIC_ASSERT(condition, message) _Static_assert(condition, message)
+#endif
+#endif
+)";
+
+static const char* s_spirvVariantDefinition = R"(#ifndef GLSLOP_SPIRV_VARIANT_DEFINED
+#define GLSLOP_SPIRV_VARIANT_DEFINED
+typedef struct glslop_spirv_variant {
+    const uint32_t* spirv;
+    size_t size;
+} glslop_spirv_variant;
+#endif
+)";
+
+static const char* s_descriptorTableDefinition = R"(#ifndef GLSLOP_DESCRIPTOR_TABLE_DEFINED
+#define GLSLOP_DESCRIPTOR_TABLE_DEFINED
+/// A descriptor, with what VkDescriptorSetLayoutBinding needs.
+typedef struct glslop_descriptor_binding {
+    uint32_t set;
+    uint32_t binding;
+    /// VkDescriptorType
+    uint32_t descriptor_type;
+    /// 0 for a runtime sized array, which needs a variable descriptor count.
+    uint32_t descriptor_count;
+    /// VkShaderStageFlags
+    uint32_t stage_flags;
+    const char* name;
+} glslop_descriptor_binding;
+
+/// The fields of VkPushConstantRange.
+typedef struct glslop_push_constant_range {
+    uint32_t stage_flags;
+    uint32_t offset;
+    uint32_t size;
+} glslop_push_constant_range;
+#endif
+)";
+
+static const char* s_vertexAttributeDefinition = R"(#ifndef GLSLOP_VERTEX_ATTRIBUTE_DEFINED
+#define GLSLOP_VERTEX_ATTRIBUTE_DEFINED
+/// A vertex input, with what VkVertexInputAttributeDescription needs besides the binding.
+typedef struct glslop_vertex_attribute {
+    uint32_t location;
+    /// VkFormat
+    uint32_t format;
+    uint32_t offset;
+    const char* name;
+} glslop_vertex_attribute;
+#endif
+)";
+
+static const char* s_specializationConstantDefinition =
+    R"(#ifndef GLSLOP_SPECIALIZATION_CONSTANT_DEFINED
+#define GLSLOP_SPECIALIZATION_CONSTANT_DEFINED
+/// Laid out like VkSpecializationMapEntry, so an array of them can be passed as pMapEntries.
+typedef struct glslop_specialization_map_entry {
+    uint32_t constant_id;
+    uint32_t offset;
+    size_t size;
+} glslop_specialization_map_entry;
+
+/// A specialization constant, for tools and debugging. Not a VkSpecializationMapEntry: use
+/// the map entries for that.
+typedef struct glslop_specialization_constant {
+    uint32_t constant_id;
+    uint32_t offset;
+    size_t size;
+    const char* name;
+    /// C type of its member in the specialization struct, e.g. "uint32_t" for a bool.
+    const char* type;
+} glslop_specialization_constant;
+#endif
+)";
+
+static const char* s_embedDirDefinition = R"(#ifndef GLSLOP_EMBED_DIR
+/// Directory .incbin reads the .spv files from, as a string literal with a trailing slash.
+/// .incbin resolves it against the directory the compiler runs in, not this header's, so
+/// define it when compiling from elsewhere. #embed finds the files next to the header.
+#define GLSLOP_EMBED_DIR ""
+#endif
+)";
+
+static const char* s_alignasDefinition = R"(#ifndef GLSLOP_ALIGNAS
+#ifdef __cplusplus
+#define GLSLOP_ALIGNAS(alignment) alignas(alignment)
+#else
+#define GLSLOP_ALIGNAS(alignment) _Alignas(alignment)
+#endif
+#endif
+)";
+
+static const char* s_dispatchDefinition = R"(#ifndef GLSLOP_DISPATCH_SIZE_DEFINED
+#define GLSLOP_DISPATCH_SIZE_DEFINED
+/// Workgroup counts, as passed to vkCmdDispatch.
+typedef struct glslop_dispatch_size {
+    uint32_t x;
+    uint32_t y;
+    uint32_t z;
+} glslop_dispatch_size;
+#endif
+)";
+
+static const char* s_dirtyTrackingDefinition = R"(#ifndef GLSLOP_DIRTY_TRACKING_DEFINED
+#define GLSLOP_DIRTY_TRACKING_DEFINED
+#include <string.h>
+#define GLSLOP_DIRTY_RANGE_COUNT 4
+/// The bytes of a block written since its last flush, as up to GLSLOP_DIRTY_RANGE_COUNT
+/// ranges. A write that would need another range widens the nearest one. Zero initialize.
+typedef struct glslop_dirty_ranges {
+    uint32_t count;
+    struct {
+        size_t begin;
+        size_t end;
+    } ranges[GLSLOP_DIRTY_RANGE_COUNT];
+} glslop_dirty_ranges;
+/// Words of the bit array that tracks count elements of an unsized array, one bit each.
+#define GLSLOP_DIRTY_ELEMENT_WORDS(count) (((count) + 31) / 32)
+static inline void glslop_dirty_mark(glslop_dirty_ranges* dirty, size_t offset, size_t size) {
+    size_t end = offset + size;
+    uint32_t nearest = 0;
+    size_t nearest_gap = (size_t)-1;
+    uint32_t i;
+    for (i = 0; i < dirty->count; i++) {
+        size_t gap = 0;
+        if (offset > dirty->ranges[i].end) {
+            gap = offset - dirty->ranges[i].end;
+        } else if (dirty->ranges[i].begin > end) {
+            gap = dirty->ranges[i].begin - end;
+        }
+        if (gap < nearest_gap) {
+            nearest = i;
+            nearest_gap = gap;
+        }
+    }
+    if (nearest_gap != 0 && dirty->count < GLSLOP_DIRTY_RANGE_COUNT) {
+        dirty->ranges[dirty->count].begin = offset;
+        dirty->ranges[dirty->count].end = end;
+        dirty->count++;
+        return;
+    }
+    if (offset < dirty->ranges[nearest].begin) {
+        dirty->ranges[nearest].begin = offset;
+    }
+    if (end > dirty->ranges[nearest].end) {
+        dirty->ranges[nearest].end = end;
+    }
+}
+/// Copies the dirty ranges of data to the same offsets of mapped, and clears them.
+static inline void glslop_dirty_flush(
+    glslop_dirty_ranges* dirty,
+    void* mapped,
+    const void* data
+) {
+    uint32_t i;
+    for (i = 0; i < dirty->count; i++) {
+        size_t begin = dirty->ranges[i].begin;
+        memcpy((char*)mapped + begin, (const char*)data + begin, dirty->ranges[i].end - begin);
+    }
+    dirty->count = 0;
+}
+static inline void glslop_dirty_mark_element(uint32_t* dirty_elements, size_t index) {
+    dirty_elements[index / 32] |= 1u << (index % 32);
+}
+/// Copies the dirty elements of the array at offset in data to mapped, each run of
+/// consecutive elements with one copy, and clears them.
+static inline void glslop_dirty_flush_elements(
+    uint32_t* dirty_elements,
+    size_t count,
+    size_t offset,
+    size_t stride,
+    void* mapped,
+    const void* data
+) {
+    size_t i = 0;
+    while (i < count) {
+        if (dirty_elements[i / 32] == 0) {
+            i = (i / 32 + 1) * 32;
+        } else if ((dirty_elements[i / 32] >> (i % 32) & 1) == 0) {
+            i++;
+        } else {
+            size_t first = i;
+            while (i < count && (dirty_elements[i / 32] >> (i % 32) & 1) != 0) {
+                i++;
+            }
+            memcpy(
+                (char*)mapped + offset + first * stride,
+                (const char*)data + offset + first * stride,
+                (i - first) * stride
+            );
+        }
+    }
+    memset(dirty_elements, 0, GLSLOP_DIRTY_ELEMENT_WORDS(count) * sizeof(uint32_t));
+}
+#endif
+)";
+
+static const char* s_soaPackDefinition = R"(#ifndef GLSLOP_SOA_PACK_DEFINED
+#define GLSLOP_SOA_PACK_DEFINED
+#include <string.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define GLSLOP_SOA_PACK_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define GLSLOP_SOA_PACK_NEON 1
+#endif
+/// Writes a packed element of size bytes to dst. Elements that are a whole number of SIMD
+/// registers go out as aligned non-temporal stores where the target has them, which don't
+/// pollute the cache and suit write-combined mapped memory. Anything else is a memcpy. size
+/// is a constant in every caller, so only one path survives inlining.
+static inline void glslop_soa_store(void* dst, const void* src, size_t size) {
+    size_t offset;
+#if defined(__AVX__)
+    if (size % 32 == 0 && (uintptr_t)dst % 32 == 0) {
+        for (offset = 0; offset < size; offset += 32) {
+            __m256i value = _mm256_loadu_si256((const __m256i*)((const char*)src + offset));
+            _mm256_stream_si256((__m256i*)((char*)dst + offset), value);
+        }
+        return;
+    }
+#endif
+#if defined(GLSLOP_SOA_PACK_SSE2)
+    if (size % 16 == 0 && (uintptr_t)dst % 16 == 0) {
+        for (offset = 0; offset < size; offset += 16) {
+            __m128i value = _mm_loadu_si128((const __m128i*)((const char*)src + offset));
+            _mm_stream_si128((__m128i*)((char*)dst + offset), value);
+        }
+        return;
+    }
+#elif defined(GLSLOP_SOA_PACK_NEON)
+    if (size % 16 == 0) {
+        for (offset = 0; offset < size; offset += 16) {
+            vst1q_u8((uint8_t*)dst + offset, vld1q_u8((const uint8_t*)src + offset));
+        }
+        return;
+    }
+#endif
+    (void)offset;
+    memcpy(dst, src, size);
+}
+/// Orders the non-temporal stores of glslop_soa_store before anything written after it.
+static inline void glslop_soa_fence(void) {
+#if defined(GLSLOP_SOA_PACK_SSE2)
+    _mm_sfence();
+#endif
+}
+#endif
+)";
+
+// The C type a specialization constant is passed as and its size in bytes. Booleans are
+// VkBool32. Returns nullptr for 16-bit floats, which C has no type for.
+static const char* SpecializationConstantType(glslang::TBasicType type, int& size) {
+    switch (type) {
+        case glslang::EbtBool:
+            size = 4;
+            return "uint32_t";
+        case glslang::EbtInt8:
+            size = 1;
+            return "int8_t";
+        case glslang::EbtUint8:
+            size = 1;
+            return "uint8_t";
+        case glslang::EbtInt16:
+            size = 2;
+            return "int16_t";
+        case glslang::EbtUint16:
+            size = 2;
+            return "uint16_t";
+        case glslang::EbtInt:
+            size = 4;
+            return "int32_t";
+        case glslang::EbtUint:
+            size = 4;
+            return "uint32_t";
+        case glslang::EbtFloat:
+            size = 4;
+            return "float";
+        case glslang::EbtInt64:
+            size = 8;
+            return "int64_t";
+        case glslang::EbtUint64:
+            size = 8;
+            return "uint64_t";
+        case glslang::EbtDouble:
+            size = 8;
+            return "double";
+        default:
+            return nullptr;
+    }
+}
+
+// The default value of a specialization constant as a C literal.
+static std::string SpecializationConstantValue(const SpecializationConstant& constant) {
+    char buffer[48];
+
+    switch (constant.basicType) {
+        case glslang::EbtFloat:
+        case glslang::EbtDouble: {
+            // printf spells these inf and nan, which aren't C tokens. INFINITY and NAN come
+            // from <math.h>, which the header includes when it needs them.
+            if (std::isnan(constant.floatValue)) {
+                return "NAN";
+            }
+            if (std::isinf(constant.floatValue)) {
+                return constant.floatValue < 0 ? "-INFINITY" : "INFINITY";
+            }
+
+            bool isFloat = constant.basicType == glslang::EbtFloat;
+            snprintf(buffer, sizeof(buffer), isFloat ? "%.9g" : "%.17g", constant.floatValue);
+            std::string result = buffer;
+            if (result.find_first_of(".en") == std::string::npos) {
+                result += ".0";
+            }
+            return isFloat ? result + "f" : result;
+        }
+        case glslang::EbtUint:
+            snprintf(buffer, sizeof(buffer), "%uu", static_cast<uint32_t>(constant.intValue));
+            return buffer;
+        case glslang::EbtInt64:
+            snprintf(
+                buffer,
+                sizeof(buffer),
+                "%lldll",
+                static_cast<long long>(constant.intValue)
+            );
+            return buffer;
+        case glslang::EbtUint64:
+            snprintf(
+                buffer,
+                sizeof(buffer),
+                "%lluull",
+                static_cast<unsigned long long>(constant.intValue)
+            );
+            return buffer;
+        default:
+            return std::to_string(constant.intValue);
+    }
+}
+
+static const char* DescriptorTypeName(DescriptorType type) {
+    switch (type) {
+        case DescriptorType::Sampler:
+            return "VK_DESCRIPTOR_TYPE_SAMPLER";
+        case DescriptorType::CombinedImageSampler:
+            return "VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER";
+        case DescriptorType::SampledImage:
+            return "VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE";
+        case DescriptorType::StorageImage:
+            return "VK_DESCRIPTOR_TYPE_STORAGE_IMAGE";
+        case DescriptorType::UniformTexelBuffer:
+            return "VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER";
+        case DescriptorType::StorageTexelBuffer:
+            return "VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER";
+        case DescriptorType::UniformBuffer:
+            return "VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER";
+        case DescriptorType::StorageBuffer:
+            return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER";
+        case DescriptorType::InputAttachment:
+            return "VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT";
+        case DescriptorType::AccelerationStructure:
+            return "VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR";
+        default:
+            return "none";
+    }
+}
+
+static std::string HexFlags(uint32_t flags) {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "0x%x", flags);
+    return buffer;
+}
+
+// The struct and block types a header defines, in an order C accepts: every struct after
+// the structs its members use, so nested structs are complete where they are used. Types are
+// listed in the order first reached from the reflection, which doesn't depend on how the
+// generator or the standard library happen to store them, so headers come out byte for byte
+// the same for the same input.
+//
+// A struct used in blocks with different layouts, such as a std140 and a std430 block, is
+// listed once per layout. The first keeps its own name, the others are named after their
+// packing, as in Name_std430, so that each C struct matches the block it's used in.
+struct StructList {
+    std::vector<std::pair<std::string, const ShaderType*>> structs;
+    // Indices into structs of the types added under each name, one per layout.
+    std::unordered_map<std::string, std::vector<size_t>> layouts;
+    std::unordered_set<std::string> names;
+
+    // Adds a type under name, after the struct types of its members, recursively, unless a
+    // type with the same layout was added under the name already.
+    void add(const std::string& name, const ShaderType& type) {
+        if (find(name, type) != nullptr) {
+            return;
+        }
+
+        for (const ShaderMember& member : type.members) {
+            if (member.type.isStruct()) {
+                add(member.type.typeName, member.type);
+            }
+        }
+
+        std::string uniqueName = name;
+        if (!names.insert(uniqueName).second) {
+            uniqueName = name + "_" + PackingName(type.packing);
+            for (int i = 2; !names.insert(uniqueName).second; i++) {
+                uniqueName = name + "_" + PackingName(type.packing) + std::to_string(i);
+            }
+        }
+
+        layouts[name].push_back(structs.size());
+        structs.push_back({ uniqueName, &type });
+    }
+
+    // The name a struct type used as a member was added under.
+    const std::string& nameOf(const ShaderType& type) const {
+        const std::string* name = find(type.typeName, type);
+        return name ? *name : type.typeName;
+    }
+
+  private:
+    // The name of the type added under name with the same layout as type, if any.
+    const std::string* find(const std::string& name, const ShaderType& type) const {
+        auto added = layouts.find(name);
+        if (added == layouts.end()) {
+            return nullptr;
+        }
+
+        ShaderType definition = StructDefinition(type);
+        for (size_t index : added->second) {
+            if (StructDefinition(*structs[index].second) == definition) {
+                return &structs[index].first;
+            }
+        }
+        return nullptr;
+    }
+
+    // What a struct type's C definition depends on, without where and how often it's used.
+    static ShaderType StructDefinition(const ShaderType& type) {
+        // Array types, and the element types copied from them, are laid out per element.
+        ShaderType definition = type;
+        if (definition.elementSize > 0) {
+            definition.size = definition.elementSize;
+        }
+        definition.arraySizes.clear();
+        definition.offset = 0;
+        definition.arrayStride = 0;
+        definition.elementSize = 0;
+        ClearRules(definition);
+        return definition;
+    }
+
+    // Clears what a layout was derived from, leaving the offsets, sizes and strides it came
+    // to, so that packings that agree on a struct share its definition.
+    static void ClearRules(ShaderType& type) {
+        type.packing = glslang::ElpNone;
+        type.alignment = 0;
+        if (!type.isMatrix()) {
+            type.rowMajor = false;
+        }
+        for (ShaderMember& member : type.members) {
+            ClearRules(member.type);
+        }
+    }
+
+    static const char* PackingName(glslang::TLayoutPacking packing) {
+        switch (packing) {
+            case glslang::ElpStd140:
+                return "std140";
+            case glslang::ElpStd430:
+                return "std430";
+            case glslang::ElpScalar:
+                return "scalar";
+            default:
+                return "layout";
+        }
+    }
+};
+
+struct HeaderGenerator {
+    const ShaderReflection& reflection;
+    const ShaderInput& input;
+    // The modules of every variant when the input is permuted, otherwise nullptr and the
+    // modules are in reflection.
+    const VariantTable* variants;
+    // Where modules go with SpirvFormat::Pack.
+    std::vector<PackModule>* packModules = nullptr;
+    // Reflection stored with each module in the pack, serialized on first use.
+    std::string packReflection;
+    // Where the padding analysis of each block goes, if it is wanted.
+    std::vector<LayoutAdvice>* layoutAdvice = nullptr;
+    // With reorderBlocks, the GLSL include of reordered member lists, empty if none is smaller.
+    std::string layoutInclude;
+    // The struct and block types the header defines, gathered by generate.
+    StructList structsEncountered;
+
+    std::string structPrefix;
+    std::string globalPrefix;
+    std::string shaderName;
+    std::unordered_map<std::string, std::string> customTypeMap;
+    std::string extraPrelude;
+    std::string halfType;
+    SpirvFormat spirvFormat;
+    bool optimized;
+    bool reorderBlocks;
+    bool dirtyTracking;
+    bool soaPackers;
+
+    HeaderGenerator(
+        const ShaderReflection& reflection,
+        const HeaderOptions& options,
+        const ShaderInput& input,
+        const VariantTable* variants
+    )
+        : reflection(reflection),
+          input(input),
+          variants(variants) {
+        if (input.structPrefix) {
+            structPrefix = *input.structPrefix;
+        } else {
+            structPrefix = "";
+        }
+
+        if (input.globalPrefix) {
+            globalPrefix = *input.globalPrefix;
+        } else {
+            globalPrefix = "";
+        }
+
+        shaderName = ShaderName(input);
+
+        customTypeMap = options.customTypeMap;
+        extraPrelude = options.extraPrelude;
+        halfType = options.halfType;
+
+        spirvFormat = options.spirvFormat;
+        reorderBlocks = options.reorderBlocks;
+        dirtyTracking = options.dirtyTracking;
+        soaPackers = options.soaPackers;
+        optimized = options.optimized;
+    }
+
+    // Hash of everything the header is generated from: the SPIR-V of every module, and the
+    // options and names that shape the rest. Build caches can key on it instead of on the
+    // whole header.
+    uint64_t contentHash() const {
+        Hasher hasher;
+
+        if (variants) {
+            for (const VariantTable::Stage& stage : variants->stages) {
+                hasher.update(static_cast<uint64_t>(stage.stage));
+                for (const ShaderStageBinary& module : stage.modules) {
+                    hasher.update(module.spirv.data(), module.spirv.size() * sizeof(uint32_t));
+                }
+                for (int module : stage.variantModules) {
+                    hasher.update(static_cast<uint64_t>(module));
+                }
+            }
+        } else {
+            for (const ShaderStageBinary& binary : reflection.stages) {
+                hasher.update(static_cast<uint64_t>(binary.stage));
+                hasher.update(binary.spirv.data(), binary.spirv.size() * sizeof(uint32_t));
+            }
+        }
+
+        hasher.update(structPrefix);
+        hasher.update(globalPrefix);
+        hasher.update(shaderName);
+        hasher.update(extraPrelude);
+        hasher.update(halfType);
+        hasher.update(static_cast<uint64_t>(spirvFormat));
+        hasher.update(static_cast<uint64_t>(optimized));
+        hasher.update(static_cast<uint64_t>(reorderBlocks));
+        hasher.update(static_cast<uint64_t>(dirtyTracking));
+        hasher.update(static_cast<uint64_t>(soaPackers));
+
+        // Sorted, so that the hash doesn't depend on hash map iteration order.
+        std::vector<std::pair<std::string, std::string>> typeMap(
+            customTypeMap.begin(),
+            customTypeMap.end()
+        );
+        std::sort(typeMap.begin(), typeMap.end());
+        for (const auto& [key, value] : typeMap) {
+            hasher.update(key);
+            hasher.update(value);
+        }
+
+        std::vector<std::pair<std::string, std::string>> formats;
+        for (const auto& [name, format] : input.vertexFormats) {
+            formats.push_back({ name, format.name() });
+        }
+        std::sort(formats.begin(), formats.end());
+        for (const auto& [name, format] : formats) {
+            hasher.update(name);
+            hasher.update(format);
+        }
+
+        return hasher.digest();
+    }
+
+    // Writes the header. Prints why and returns false if it can't be generated.
+    bool generate(std::ostream& outFile) {
+        outFile << s_shaderHeaderPrelude;
+
+        if (!extraPrelude.empty()) {
+            outFile << extraPrelude;
+        }
+
+        if (variants) {
+            generateVariants(outFile);
+        } else {
+            for (const ShaderStageBinary& binary : reflection.stages) {
+                generateModule(
+                    outFile,
+                    binary,
+                    spirvSymbol(binary.stage),
+                    SpirvSidecarPath(input, binary.stage)
+                );
+            }
+        }
+
+        outFile << "static const char* " << globalPrefix << shaderName << "_name = \""
+                << shaderName << "\";\n";
+
+        outFile << "#define CONTENT_HASH_" << shaderName << " UINT64_C(0x"
+                << HashToString(contentHash()) << ")\n";
+
+        std::unordered_set<std::string> handledUniforms;
+
+        // Gather uniform block info
+        for (const ReflectedObject& uniformBlock : reflection.uniformBlocks) {
+            std::string uniformBlockName = uniformBlock.name;
+
+            const ShaderType& blockType = uniformBlock.type;
+
+            if (blockType.basicType == glslang::EbtBlock) {
+                structsEncountered.add(uniformBlockName, blockType);
+                const std::vector<ShaderMember>& members = blockType.members;
+
+                for (size_t j = 0; j < members.size(); j++) {
+                    handledUniforms.insert(members[j].name);
+                }
+            }
+
+            outFile << "#define SLOT_" << shaderName << "_" << uniformBlockName << " "
+                    << uniformBlock.binding << "\n";
+        }
+
+        // Gather buffer block info
+        for (const ReflectedObject& bufferBlock : reflection.bufferBlocks) {
+            std::string bufferBlockName = bufferBlock.name;
+
+            const ShaderType& blockType = bufferBlock.type;
+
+            if (blockType.basicType == glslang::EbtBlock) {
+                structsEncountered.add(bufferBlockName, blockType);
+                const std::vector<ShaderMember>& members = blockType.members;
+
+                for (size_t j = 0; j < members.size(); j++) {
+                    std::string memberName = members[j].name;
+                    if (bufferBlock.name.empty()) {
+                        handledUniforms.insert(memberName);
+                    } else {
+                        handledUniforms.insert(bufferBlockName + "." + memberName);
+                    }
+                }
+            }
+            outFile << "#define SLOT_" << shaderName << "_" << bufferBlockName << " "
+                    << bufferBlock.binding << "\n";
+        }
+
+        // Buffer reference blocks have no slot, only the alignment their addresses need.
+        for (const BufferReferenceType& reference : reflection.bufferReferences) {
+            structsEncountered.add(reference.type.typeName, reference.type);
+            outFile << "#define BUFFER_REFERENCE_ALIGN_" << shaderName << "_"
+                    << reference.type.typeName << " " << reference.align << "\n";
+        }
+
+        // Generate location and binding defines
+        for (const ReflectedObject& input : reflection.pipeInputs) {
+            outFile << "#define ATTR_" << shaderName << "_" << input.name << " "
+                    << input.location << "\n";
+        }
+
+        for (const ReflectedObject& output : reflection.pipeOutputs) {
+            outFile << "#define ATTR_" << shaderName << "_" << output.name << " "
+                    << output.location << "\n";
+        }
+
+        for (const ReflectedObject& uniform : reflection.uniforms) {
+            if (handledUniforms.find(uniform.name) != handledUniforms.end()) {
+                continue;
+            }
+
+            outFile << "#define SLOT_" << shaderName << "_" << uniform.name << " "
+                    << uniform.binding << "\n";
+
+            const ShaderType& type = uniform.type;
+
+            if (type.basicType == glslang::EbtStruct) {
+                structsEncountered.add(uniform.name, type);
+            }
+        }
+
+        generateDescriptorTables(outFile);
+
+        if (!generateVertexInput(outFile)) {
+            return false;
+        }
+
+        generateDispatch(outFile);
+        generateSpecializationConstants(outFile);
+
+        for (auto& [uniformBlockName, uniformBlock] : structsEncountered.structs) {
+            outFile << "typedef struct " << structPrefix << shaderName << "_"
+                    << uniformBlockName << " " << structPrefix << uniformBlockName << ";\n";
+        }
+
+        if (!structsEncountered.structs.empty()) {
+            outFile << s_staticAssertDefinition;
+        }
+
+        for (auto& [uniformBlockName, uniformBlock] : structsEncountered.structs) {
+            generateStruct(uniformBlockName, *uniformBlock, outFile);
+        }
+
+        generateLayoutAdvice(outFile);
+
+        outFile << s_shaderHeaderPostlude;
+        return true;
+    }
+
+    // Writes tables of the descriptors and push constant ranges of the program, so pipeline
+    // layouts can be created from static data instead of reflecting the SPIR-V at runtime.
+    // Descriptors are sorted by set and binding.
+    void generateDescriptorTables(std::ostream& outFile) {
+        std::vector<const ReflectedObject*> descriptors = DescriptorBindings(reflection);
+        std::vector<const ReflectedObject*> pushConstants = PushConstantBlocks(reflection);
+
+        std::string prefix = globalPrefix + shaderName;
+        int setCount = descriptors.empty() ? 0 : descriptors.back()->set + 1;
+
+        outFile << s_descriptorTableDefinition;
+
+        if (descriptors.empty()) {
+            outFile << "static const glslop_descriptor_binding* const " << prefix
+                    << "_descriptor_bindings = NULL;\n";
+        } else {
+            outFile << "static const glslop_descriptor_binding " << prefix
+                    << "_descriptor_bindings[] = {\n";
+            for (const ReflectedObject* descriptor : descriptors) {
+                outFile << "    { " << descriptor->set << ", " << descriptor->binding << ", "
+                        << static_cast<int32_t>(descriptor->descriptorType) << ", "
+                        << DescriptorCount(*descriptor) << ", "
+                        << HexFlags(descriptor->stageFlags) << ", \"" << descriptor->name
+                        << "\" }, // "
+                        << DescriptorTypeName(descriptor->descriptorType) << "\n";
+            }
+            outFile << "};\n";
+        }
+        outFile << "static const size_t " << prefix
+                << "_descriptor_binding_count = " << descriptors.size() << ";\n";
+        outFile << "static const uint32_t " << prefix << "_descriptor_set_count = " << setCount
+                << ";\n";
+
+        if (pushConstants.empty()) {
+            outFile << "static const glslop_push_constant_range* const " << prefix
+                    << "_push_constant_ranges = NULL;\n";
+        } else {
+            outFile << "static const glslop_push_constant_range " << prefix
+                    << "_push_constant_ranges[] = {\n";
+            for (const ReflectedObject* pushConstant : pushConstants) {
+                PushConstantRange range = PushConstantBlockRange(*pushConstant);
+                outFile << "    { " << HexFlags(pushConstant->stageFlags) << ", "
+                        << range.offset << ", " << range.size << " }, // " << pushConstant->name
+                        << "\n";
+            }
+            outFile << "};\n";
+        }
+        outFile << "static const size_t " << prefix
+                << "_push_constant_range_count = " << pushConstants.size() << ";\n";
+    }
+
+    // Writes an interleaved struct of the inputs of a vertex shader, in location order, and the
+    // attribute descriptions to read it with. Inputs are read from 32-bit components unless
+    // the vertexFormats of the input give another format. Every attribute is aligned to its
+    // component size, so the struct has no packing pragmas. Returns false if an input can't be
+    // read from its format.
+    bool generateVertexInput(std::ostream& outFile) {
+        if (input.stages[0].stage != EShLangVertex) {
+            return true;
+        }
+
+        std::vector<const ReflectedObject*> inputs;
+        for (const ReflectedObject& object : reflection.pipeInputs) {
+            if (object.location >= 0 && object.name.compare(0, 3, "gl_") != 0) {
+                inputs.push_back(&object);
+            }
+        }
+        if (inputs.empty()) {
+            return true;
+        }
+
+        std::stable_sort(
+            inputs.begin(),
+            inputs.end(),
+            [](const ReflectedObject* a, const ReflectedObject* b) {
+                return a->location < b->location;
+            }
+        );
+
+        struct Attribute {
+            int location;
+            VertexFormat format;
+            int offset;
+            std::string name;
+        };
+
+        std::vector<Attribute> attributes;
+        std::vector<std::pair<std::string, int>> fields;
+        std::stringstream members;
+        int offset = 0;
+        int alignment = 1;
+
+        for (const ReflectedObject* object : inputs) {
+            std::string name = object->name.substr(0, object->name.find('['));
+
+            // Matrices take a location per column and arrays one per element, each read as a
+            // vector of the column type.
+            ShaderType columnType;
+            columnType.basicType = object->type.basicType;
+            columnType.vectorSize = object->type.isMatrix() ? object->type.matrixRows
+                                                            : object->type.vectorSize;
+
+            std::string dimensions;
+            int slots = 1;
+            for (int size : object->type.arraySizes) {
+                slots *= size;
+                dimensions += "[" + std::to_string(size) + "]";
+            }
+            if (object->type.isMatrix()) {
+                slots *= object->type.matrixCols;
+                dimensions += "[" + std::to_string(object->type.matrixCols) + "]";
+            }
+
+            std::optional<VertexFormat> format = DefaultVertexFormat(columnType);
+            if (!format) {
+                Print(
+                    "%s: vertex input %s has no vertex format\n",
+                    input.stages[0].inputFile.c_str(),
+                    name.c_str()
+                );
+                return false;
+            }
+
+            auto override = input.vertexFormats.find(name);
+            if (override != input.vertexFormats.end()) {
+                VertexFormat requested = override->second;
+                if (requested.components == 0) {
+                    requested.components = columnType.vectorSize;
+                }
+                if (!IsCompatibleVertexFormat(requested, columnType)) {
+                    Print(
+                        "%s: vertex input %s is a %s and can't be read from %s\n",
+                        input.stages[0].inputFile.c_str(),
+                        name.c_str(),
+                        GlslTypeName(object->type).c_str(),
+                        requested.name().c_str()
+                    );
+                    return false;
+                }
+                format = requested;
+            }
+
+            int componentSize = format->bits / 8;
+            offset = (offset + componentSize - 1) / componentSize * componentSize;
+            alignment = std::max(alignment, componentSize);
+
+            for (int i = 0; i < slots; i++) {
+                attributes.push_back({ object->location + i,
+                                       *format,
+                                       offset + i * format->size(),
+                                       slots > 1 ? name + "[" + std::to_string(i) + "]"
+                                                 : name });
+            }
+
+            if (format->components > 1) {
+                dimensions += "[" + std::to_string(format->components) + "]";
+            }
+            bool half = format->kind == VertexFormat::Kind::Float && format->bits == 16;
+            members << "    " << (half ? halfType.c_str() : format->componentType()) << " "
+                    << name << dimensions << ";";
+            if (format->kind != VertexFormat::Kind::Float || format->bits != 32) {
+                members << " // " << format->name();
+            }
+            members << "\n";
+
+            fields.push_back({ name, offset });
+            offset += slots * format->size();
+        }
+
+        int stride = (offset + alignment - 1) / alignment * alignment;
+
+        std::string prefix = globalPrefix + shaderName;
+        std::string vertexType = structPrefix + shaderName + "_vertex";
+
+        outFile << s_vertexAttributeDefinition;
+        outFile << s_staticAssertDefinition;
+
+        outFile << "typedef struct " << vertexType << " {\n"
+                << members.str() << "} " << vertexType << ";\n";
+        for (const auto& [name, fieldOffset] : fields) {
+            outFile << "GLSLOP_STATIC_ASSERT(offsetof(" << vertexType << ", " << name
+                    << ") == " << fieldOffset << ", \"" << vertexType << "." << name
+                    << " offset mismatch\");\n";
+        }
+        outFile << "GLSLOP_STATIC_ASSERT(sizeof(" << vertexType << ") == " << stride << ", \""
+                << vertexType << " size mismatch\");\n";
+
+        outFile << "static const uint32_t " << prefix << "_vertex_stride = " << stride << ";\n";
+        outFile << "static const glslop_vertex_attribute " << prefix
+                << "_vertex_attributes[] = {\n";
+        for (const Attribute& attribute : attributes) {
+            outFile << "    { " << attribute.location << ", " << attribute.format.vkFormat()
+                    << ", " << attribute.offset << ", \"" << attribute.name << "\" }, // "
+                    << attribute.format.vkFormatName() << "\n";
+        }
+        outFile << "};\n";
+        outFile << "static const size_t " << prefix
+                << "_vertex_attribute_count = " << attributes.size() << ";\n";
+
+        return true;
+    }
+
+    // Analyzes the padding of every block and the structs in it. With reorderBlocks, each one
+    // that another member order makes smaller gets a C struct named <name>_reordered with that
+    // order, and its GLSL members a define in layoutInclude, to declare the block with.
+    void generateLayoutAdvice(std::ostream& outFile) {
+        if (!layoutAdvice && !reorderBlocks) {
+            return;
+        }
+
+        std::vector<LayoutAdvice> advice;
+        std::unordered_set<std::string> analyzed;
+
+        auto analyze = [&](const std::string& name, const ShaderType& type, auto& self) {
+            if (!type.hasLayout() || !analyzed.insert(name).second) {
+                return;
+            }
+
+            advice.push_back(AdviseLayout(name, type));
+            advice.back().shader = shaderName;
+
+            for (const ShaderMember& member : type.members) {
+                if (member.type.isStruct()) {
+                    self(member.type.typeName, member.type, self);
+                }
+            }
+        };
+
+        for (const std::vector<ReflectedObject>* blocks :
+             { &reflection.uniformBlocks, &reflection.bufferBlocks }) {
+            for (const ReflectedObject& block : *blocks) {
+                if (block.type.basicType == glslang::EbtBlock) {
+                    // Names end up in identifiers, so an element of an array of blocks left
+                    // as "Block[0]" by reflection is named after the block.
+                    analyze(block.name.substr(0, block.name.find('[')), block.type, analyze);
+                }
+            }
+        }
+
+        for (const BufferReferenceType& reference : reflection.bufferReferences) {
+            analyze(reference.type.typeName, reference.type, analyze);
+        }
+
+        if (reorderBlocks) {
+            std::stringstream include;
+            for (const LayoutAdvice& block : advice) {
+                if (!block.reordered) {
+                    continue;
+                }
+
+                outFile << s_staticAssertDefinition;
+                generateStruct(block.name + "_reordered", *block.reordered, outFile);
+
+                include << "\n// " << block.name << ": " << block.size << " bytes, "
+                        << block.reorderedSize() << " reordered\n";
+                include << "#define GLSLOP_LAYOUT_" << shaderName << "_" << block.name;
+
+                std::string declarations = GlslMemberDeclarations(*block.reordered);
+                for (size_t begin = 0; begin < declarations.size();) {
+                    size_t end = declarations.find('\n', begin);
+                    include << " \\\n    " << declarations.substr(begin, end - begin);
+                    begin = end + 1;
+                }
+                include << "\n";
+            }
+
+            if (!include.str().empty()) {
+                layoutInclude = "// Generated by glslop. Member lists that pad less than the "
+                                "declared ones, used as\n// uniform Block { GLSLOP_LAYOUT_"
+                                "<shader>_<Block> } block;\n" +
+                                include.str();
+            }
+        }
+
+        if (layoutAdvice) {
+            for (LayoutAdvice& block : advice) {
+                layoutAdvice->push_back(std::move(block));
+            }
+        }
+    }
+
+    // Writes the workgroup size and shared memory size of a compute shader as defines, and a
+    // helper rounding invocation counts up to whole workgroups.
+    void generateDispatch(std::ostream& outFile) {
+        if (input.stages[0].stage != EShLangCompute) {
+            return;
+        }
+
+        static const char* s_axes[3] = { "X", "Y", "Z" };
+        static const char* s_arguments[3] = { "x", "y", "z" };
+
+        std::string prefix = globalPrefix + shaderName;
+        bool specialized = false;
+
+        for (int i = 0; i < 3; i++) {
+            outFile << "#define LOCAL_SIZE_" << shaderName << "_" << s_axes[i] << " "
+                    << reflection.localSize[i] << "\n";
+            if (reflection.localSizeSpecIds[i] >= 0) {
+                outFile << "#define LOCAL_SIZE_ID_" << shaderName << "_" << s_axes[i] << " "
+                        << reflection.localSizeSpecIds[i] << "\n";
+                specialized = true;
+            }
+        }
+        outFile << "#define SHARED_SIZE_" << shaderName << " " << reflection.sharedMemorySize
+                << "\n";
+
+        outFile << s_dispatchDefinition;
+
+        outFile << "/// Workgroups covering x * y * z invocations";
+        if (specialized) {
+            outFile << ", with the default workgroup size";
+        }
+        outFile << ".\n";
+        outFile << "static inline glslop_dispatch_size " << prefix
+                << "_dispatch_groups(uint32_t x, uint32_t y, uint32_t z) {\n";
+        outFile << "    glslop_dispatch_size groups = { ";
+        for (int i = 0; i < 3; i++) {
+            // Dividing first, as x + size - 1 can overflow.
+            const char* argument = s_arguments[i];
+            uint32_t size = reflection.localSize[i];
+            if (size > 1) {
+                outFile << argument << " / " << size << "u + (" << argument << " % " << size
+                        << "u != 0)";
+            } else {
+                outFile << argument;
+            }
+            outFile << (i < 2 ? ", " : " };\n");
+        }
+        outFile << "    return groups;\n";
+        outFile << "}\n";
+    }
+
+    // Writes a struct of the specialization constants of the program, an instance holding
+    // their defaults, the map entries to pass it as VkSpecializationInfo data as is, and a
+    // table describing each constant.
+    void generateSpecializationConstants(std::ostream& outFile) {
+        struct Entry {
+            const SpecializationConstant* constant;
+            const char* type;
+            int offset;
+            int size;
+        };
+
+        std::vector<Entry> entries;
+        int offset = 0;
+
+        for (const SpecializationConstant& constant : reflection.specializationConstants) {
+            int size = 0;
+            const char* type = SpecializationConstantType(constant.basicType, size);
+            if (!type) {
+                Print(
+                    "%s: specialization constant %s has no C type and is left out\n",
+                    input.stages[0].inputFile.c_str(),
+                    constant.name.c_str()
+                );
+                continue;
+            }
+
+            offset = (offset + size - 1) / size * size;
+            entries.push_back({ &constant, type, offset, size });
+            offset += size;
+        }
+
+        std::string prefix = globalPrefix + shaderName;
+        std::string dataType = structPrefix + shaderName + "_specialization";
+
+        outFile << s_specializationConstantDefinition;
+
+        if (entries.empty()) {
+            outFile << "static const glslop_specialization_map_entry* const " << prefix
+                    << "_specialization_map_entries = NULL;\n";
+            outFile << "static const glslop_specialization_constant* const " << prefix
+                    << "_specialization_constants = NULL;\n";
+            outFile << "static const size_t " << prefix
+                    << "_specialization_constant_count = 0;\n";
+            return;
+        }
+
+        outFile << s_staticAssertDefinition;
+
+        bool nonFinite = std::any_of(entries.begin(), entries.end(), [](const Entry& entry) {
+            return !std::isfinite(entry.constant->floatValue);
+        });
+        if (nonFinite) {
+            outFile << "#include <math.h>\n";
+        }
+
+        outFile << "typedef struct " << dataType << " {\n";
+        for (const Entry& entry : entries) {
+            outFile << "    " << entry.type << " " << entry.constant->name << ";\n";
+        }
+        outFile << "} " << dataType << ";\n";
+        for (const Entry& entry : entries) {
+            outFile << "GLSLOP_STATIC_ASSERT(offsetof(" << dataType << ", "
+                    << entry.constant->name << ") == " << entry.offset << ", \"" << dataType
+                    << "." << entry.constant->name << " offset mismatch\");\n";
+        }
+
+        outFile << "static const " << dataType << " " << prefix
+                << "_specialization_defaults = {\n";
+        for (const Entry& entry : entries) {
+            outFile << "    " << SpecializationConstantValue(*entry.constant) << ",\n";
+        }
+        outFile << "};\n";
+
+        outFile << "static const glslop_specialization_map_entry " << prefix
+                << "_specialization_map_entries[] = {\n";
+        for (const Entry& entry : entries) {
+            outFile << "    { " << entry.constant->id << ", " << entry.offset << ", "
+                    << entry.size << " }, // " << entry.constant->name << "\n";
+        }
+        outFile << "};\n";
+
+        outFile << "static const glslop_specialization_constant " << prefix
+                << "_specialization_constants[] = {\n";
+        for (const Entry& entry : entries) {
+            outFile << "    { " << entry.constant->id << ", " << entry.offset << ", "
+                    << entry.size << ", \"" << entry.constant->name << "\", \"" << entry.type
+                    << "\" }, // = " << SpecializationConstantValue(*entry.constant) << "\n";
+        }
+        outFile << "};\n";
+        outFile << "static const size_t " << prefix
+                << "_specialization_constant_count = " << entries.size() << ";\n";
+    }
+
+    // Name of the SPIR-V array of a stage: <name>_spv, or <name>_<stage>_spv when linked.
+    std::string spirvSymbol(EShLanguage stage) {
+        if (input.isLinked()) {
+            return globalPrefix + shaderName + "_" + StageName(stage) + "_spv";
+        }
+        return globalPrefix + shaderName + "_spv";
+    }
+
+    // Writes a SPIR-V module and its size.
+    void generateModule(
+        std::ostream& outFile,
+        const ShaderStageBinary& binary,
+        const std::string& symbol,
+        const std::string& spirvSidecarPath
+    ) {
+        const std::vector<uint32_t>& spirv = binary.spirv;
+
+        if (spirvFormat == SpirvFormat::Pack) {
+            addToPack(binary, symbol);
+            outFile << "static const uint64_t " << symbol << "_pack_key = " << packKey(symbol)
+                    << ";\n";
+        } else {
+            generateSpirv(outFile, spirv, symbol, spirvSidecarPath);
+        }
+
+        outFile << "static const size_t " << symbol << "_size = " << spirv.size() << ";\n";
+
+        if (optimized) {
+            int64_t saved = static_cast<int64_t>(binary.unoptimizedSize) - spirv.size();
+            outFile << "/// Optimized from " << binary.unoptimizedSize << " to " << spirv.size()
+                    << " words\n";
+            outFile << "static const int32_t " << symbol << "_words_saved = " << saved << ";\n";
+        }
+    }
+
+    // Writes every distinct module of a permuted input once, then for each stage a table of
+    // the module of every variant, indexed by the VARIANT_ bits of the axes set in it.
+    void generateVariants(std::ostream& outFile) {
+        const PermutationSpec& spec = *input.permutations;
+
+        for (const VariantTable::Stage& stage : variants->stages) {
+            for (size_t i = 0; i < stage.modules.size(); i++) {
+                generateModule(
+                    outFile,
+                    stage.modules[i],
+                    spirvSymbol(stage.stage) + "_" + std::to_string(i),
+                    SpirvSidecarPath(input, stage.stage, i)
+                );
+            }
+        }
+
+        for (size_t i = 0; i < spec.axes.size(); i++) {
+            outFile << "#define VARIANT_" << shaderName << "_" << spec.axes[i] << " (1u << "
+                    << i << ")\n";
+        }
+
+        if (spirvFormat != SpirvFormat::Pack) {
+            outFile << s_spirvVariantDefinition;
+        }
+        outFile << "static const size_t " << globalPrefix << shaderName
+                << "_variant_count = " << spec.variantCount() << ";\n";
+
+        for (const VariantTable::Stage& stage : variants->stages) {
+            std::string symbol = spirvSymbol(stage.stage);
+
+            if (spirvFormat == SpirvFormat::Pack) {
+                outFile << "/// Pack keys of the variants, 0 where excluded\n";
+                outFile << "static const uint64_t " << symbol << "_variant_pack_keys["
+                        << spec.variantCount() << "] = {\n";
+
+                for (uint32_t variant = 0; variant < spec.variantCount(); variant++) {
+                    int module = stage.variantModules[variant];
+                    outFile << "    "
+                            << (module < 0 ? "0"
+                                           : packKey(symbol + "_" + std::to_string(module)))
+                            << ", // " << spec.describe(variant) << "\n";
+                }
+
+                outFile << "};\n";
+                continue;
+            }
+
+            outFile << "/// " << spec.variantCount() << " variants compiled to "
+                    << stage.modules.size() << " distinct modules, NULL where excluded\n";
+            outFile << "static const glslop_spirv_variant " << symbol << "_variants["
+                    << spec.variantCount() << "] = {\n";
+
+            for (uint32_t variant = 0; variant < spec.variantCount(); variant++) {
+                int module = stage.variantModules[variant];
+                if (module < 0) {
+                    outFile << "    { NULL, 0 },";
+                } else {
+                    outFile << "    { " << symbol << "_" << module << ", "
+                            << stage.modules[module].spirv.size() << " },";
+                }
+                outFile << " // " << spec.describe(variant) << "\n";
+            }
+
+            outFile << "};\n";
+        }
+    }
+
+    // Adds a module to the pack under its symbol, along with the program's reflection.
+    void addToPack(const ShaderStageBinary& binary, const std::string& symbol) {
+        if (packReflection.empty()) {
+            ShaderReflection withoutSpirv = reflection;
+            for (ShaderStageBinary& stage : withoutSpirv.stages) {
+                stage.spirv.clear();
+            }
+            packReflection = SerializeReflection(withoutSpirv);
+        }
+
+        packModules->push_back({ symbol, binary.stage, binary.spirv, packReflection });
+    }
+
+    std::string packKey(const std::string& symbol) {
+        return "UINT64_C(0x" + HashToString(PackNameHash(symbol)) + ")";
+    }
+
+    // Elements of the word array of a module in the string and embed formats. C has no empty
+    // arrays, so an empty module still gets one word.
+    static size_t wordArraySize(const std::vector<uint32_t>& spirv) {
+        return std::max<size_t>(spirv.size(), 1);
+    }
+
+    // Writes a SPIR-V array in the selected format. The words are formatted into a single
+    // buffer that is written out in one go, as large shaders produce a lot of text.
+    void generateSpirv(
+        std::ostream& outFile,
+        const std::vector<uint32_t>& spirv,
+        const std::string& symbol,
+        const std::string& spirvSidecarPath
+    ) {
+        std::string buffer;
+        char number[16];
+
+        switch (spirvFormat) {
+            case SpirvFormat::Decimal:
+            case SpirvFormat::Hex: {
+                bool hex = spirvFormat == SpirvFormat::Hex;
+                size_t wordsPerLine = 8;
+
+                buffer.reserve(spirv.size() * (hex ? 11 : 10) + 64);
+                buffer += "static const uint32_t " + symbol + "[] = {\n";
+
+                for (size_t j = 0; j < spirv.size(); j++) {
+                    if (j % wordsPerLine == 0) {
+                        buffer += "    ";
+                    }
+
+                    if (hex) {
+                        buffer += "0x";
+                    }
+                    std::to_chars_result result =
+                        std::to_chars(number, number + sizeof(number), spirv[j], hex ? 16 : 10);
+                    buffer.append(number, result.ptr);
+
+                    if (j != spirv.size() - 1) {
+                        buffer += ",";
+                    }
+
+                    if (j % wordsPerLine == wordsPerLine - 1) {
+                        buffer += "\n";
+                    }
+                }
+
+                buffer += "};\n";
+                break;
+            }
+            case SpirvFormat::String: {
+                const uint8_t* bytes = reinterpret_cast<const uint8_t*>(spirv.data());
+                size_t byteCount = spirv.size() * sizeof(uint32_t);
+
+                // The string initializes word aligned bytes, which <name>_spv points at as
+                // words. A union of bytes and words would read its inactive member, which is
+                // undefined in C++. The bytes have room for the string's terminating zero.
+                buffer.reserve(byteCount * 4 + 256);
+                buffer += s_alignasDefinition;
+                buffer += "GLSLOP_ALIGNAS(4) static const unsigned char " + symbol + "_bytes[" +
+                          std::to_string(byteCount + 1) + "] =\n";
+
+                // Octal escapes are at most three digits long, so unlike \x escapes they can't
+                // swallow a digit that follows them.
+                size_t lineLength = 0;
+                for (size_t j = 0; j < byteCount; j++) {
+                    if (lineLength == 0) {
+                        buffer += "    \"";
+                    }
+
+                    uint8_t byte = bytes[j];
+                    if (byte >= 0x20 && byte < 0x7f && byte != '"' && byte != '\\' &&
+                        byte != '?') {
+                        buffer += static_cast<char>(byte);
+                        lineLength += 1;
+                    } else {
+                        buffer += '\\';
+                        buffer += static_cast<char>('0' + ((byte >> 6) & 7));
+                        buffer += static_cast<char>('0' + ((byte >> 3) & 7));
+                        buffer += static_cast<char>('0' + (byte & 7));
+                        lineLength += 4;
+                    }
+
+                    if (lineLength >= 80 || j == byteCount - 1) {
+                        buffer += "\"\n";
+                        lineLength = 0;
+                    }
+                }
+
+                if (byteCount == 0) {
+                    buffer += "    \"\"\n";
+                }
+
+                buffer += ";\n";
+                buffer += "#define " + symbol + " ((const uint32_t*)" + symbol + "_bytes)\n";
+                break;
+            }
+            case SpirvFormat::Embed: {
+                std::string fileName =
+                    std::filesystem::path(spirvSidecarPath).filename().string();
+                // .incbin resolves relative paths against the assembler's working directory
+                // rather than the header. The directory comes from GLSLOP_EMBED_DIR instead of
+                // being baked in, so the header is the same wherever it's generated.
+                buffer += s_embedDirDefinition;
+
+                // Either way <name>_spv points at the module's words, as in the other formats.
+                // #embed fills word aligned bytes, as the string format does, while .incbin
+                // defines the words directly, under the array's own name.
+                std::string words = std::to_string(wordArraySize(spirv));
+                std::string bytes = std::to_string(wordArraySize(spirv) * 4);
+
+                buffer += "#if defined(__has_embed)\n";
+                buffer += s_alignasDefinition;
+                buffer += "GLSLOP_ALIGNAS(4) static const unsigned char " + symbol + "_bytes[" +
+                          bytes + "] = {\n";
+                buffer += "#embed \"" + fileName + "\"\n";
+                buffer += "};\n";
+                buffer += "#define " + symbol + " ((const uint32_t*)" + symbol + "_bytes)\n";
+                buffer += "#elif defined(__APPLE__)\n";
+                buffer += "__asm__(\n";
+                buffer += "    \".pushsection __DATA,__const\\n\"\n";
+                buffer += "    \".p2align 2\\n\"\n";
+                buffer += "    \".weak_definition _" + symbol + "\\n\"\n";
+                buffer += "    \"_" + symbol + ":\\n\"\n";
+                buffer += "    \".incbin \\\"\" GLSLOP_EMBED_DIR \"" + fileName + "\\\"\\n\"\n";
+                buffer += "    \".popsection\\n\"\n";
+                buffer += ");\n";
+                buffer += "extern const uint32_t " + symbol + "[" + words + "];\n";
+                buffer += "#elif defined(__GNUC__)\n";
+                buffer += "__asm__(\n";
+                buffer += "    \".pushsection .rodata\\n\"\n";
+                buffer += "    \".balign 4\\n\"\n";
+                buffer += "    \".weak " + symbol + "\\n\"\n";
+                buffer += "    \"" + symbol + ":\\n\"\n";
+                buffer += "    \".incbin \\\"\" GLSLOP_EMBED_DIR \"" + fileName + "\\\"\\n\"\n";
+                buffer += "    \".popsection\\n\"\n";
+                buffer += ");\n";
+                buffer += "extern const uint32_t " + symbol + "[" + words + "];\n";
+                buffer += "#else\n";
+                buffer += "#error \"" + fileName + " needs #embed or .incbin support\"\n";
+                buffer += "#endif\n";
+                break;
+            }
+            case SpirvFormat::Pack:
+                // Modules are added to the pack by generateModule instead.
+                break;
+        }
+
+        outFile << buffer;
+    }
+
+    // Writes a struct with the members at the offsets glslang gives them, padding the gaps
+    // explicitly, followed by assertions that the C compiler agrees on the layout.
+    void generateStruct(
+        const std::string& structName,
+        const ShaderType& structType,
+        std::ostream& outFile
+    ) {
+        const std::vector<ShaderMember>& members = structType.members;
+        std::string fullName = structPrefix + shaderName + "_" + structName;
+
+        std::stringstream structString;
+        structString << "{\n";
+
+        int sizeSoFar = 0;
+        int paddingCounter = 0;
+
+        for (const ShaderMember& member : members) {
+            const ShaderType& memberType = member.type;
+
+            if (memberType.offset > sizeSoFar) {
+                structString << "    uint8_t _padding" << paddingCounter++ << "["
+                             << memberType.offset - sizeSoFar << "];\n";
+                sizeSoFar = memberType.offset;
+            }
+
+            // Padded array element structs go to outFile, ahead of this struct.
+            structString << "    " << getFieldString(fullName, member, outFile) << ";\n";
+
+            sizeSoFar += memberType.size;
+        }
+
+        bool lastElementIsUnboundedArray =
+            members.size() > 0 && members[members.size() - 1].type.isArray() &&
+            !members[members.size() - 1].type.isSizedArray();
+
+        // Arrays of blocks are described by the layout of a single element.
+        int structSize = structType.isArray() ? structType.elementSize : structType.size;
+
+        if (structSize > sizeSoFar && !lastElementIsUnboundedArray) {
+            structString << "    uint8_t _padding" << paddingCounter++ << "["
+                         << structSize - sizeSoFar << "];\n";
+            sizeSoFar = structSize;
+        }
+
+        structString << "}";
+
+        outFile << "/// Struct for " << structName << "\n";
+        outFile << "typedef struct " << fullName << " " << structString.str() << " " << fullName
+                << ";\n";
+
+        // The packer only needs the layout of the array elements, which a block holding
+        // nothing but the array has even when the block itself has no size.
+        if (soaPackers && structType.basicType == glslang::EbtBlock &&
+            lastElementIsUnboundedArray) {
+            generateSoaPacker(fullName, members.back(), outFile);
+        }
+
+        if (!structType.hasLayout()) {
+            return;
+        }
+
+        for (const ShaderMember& member : members) {
+            outFile << "GLSLOP_STATIC_ASSERT(offsetof(" << fullName << ", " << member.name
+                    << ") == " << member.type.offset << ", \"" << fullName << "." << member.name
+                    << " offset\");\n";
+        }
+
+        // A trailing unsized array is a flexible array member, which sizeof doesn't count.
+        if (!lastElementIsUnboundedArray) {
+            outFile << "GLSLOP_STATIC_ASSERT(sizeof(" << fullName << ") == " << structSize
+                    << ", \"" << fullName << " size\");\n";
+        }
+
+        if (dirtyTracking && structType.basicType == glslang::EbtBlock) {
+            generateDirtyTracking(fullName, structType, outFile);
+        }
+    }
+
+    // Writes <block>_pack_<array>(dst, columns..., count) for a block ending in an unsized
+    // array of structs. It packs count elements from one array per struct member into the
+    // layout the shader reads, starting at dst, which points at the first element to write.
+    // Columns hold their values tightly packed: vectors component by component, matrices
+    // vector by vector in the order of the block, and arrays element by element. Each element
+    // is assembled with its padding zeroed, then written whole with glslop_soa_store.
+    void generateSoaPacker(
+        const std::string& fullName,
+        const ShaderMember& tail,
+        std::ostream& outFile
+    ) {
+        const ShaderType& arrayType = tail.type;
+        if (arrayType.basicType != glslang::EbtStruct || arrayType.arraySizes.size() != 1 ||
+            arrayType.arrayStride <= 0) {
+            return;
+        }
+
+        struct Column {
+            const ShaderMember* member;
+            std::string type;
+            std::string name;
+        };
+
+        std::vector<Column> columns;
+        bool hasArrays = false;
+        for (const ShaderMember& member : arrayType.members) {
+            std::string type;
+            if (member.type.isStruct()) {
+                type = structPrefix + structsEncountered.nameOf(member.type);
+            } else if (member.type.basicType == glslang::EbtReference) {
+                type = "uint64_t";
+            } else {
+                type = getComponentType(member.type.basicType);
+            }
+            if (type.empty()) {
+                return;
+            }
+
+            // Columns are named after their members, unless that clashes with the other names
+            // in the function.
+            std::string name = member.name;
+            for (const char* reserved : { "dst", "count", "out", "element", "i", "k" }) {
+                if (name == reserved) {
+                    name += "_column";
+                }
+            }
+
+            columns.push_back({ &member, type, name });
+            hasArrays = hasArrays || member.type.isArray();
+        }
+
+        std::string stride = std::to_string(arrayType.arrayStride);
+
+        outFile << s_soaPackDefinition;
+        outFile << "/// Packs count elements of " << tail.name
+                << " to dst from one array per member.\n";
+        outFile << "static inline void " << fullName << "_pack_" << tail.name << "(\n";
+        outFile << "    void* dst,\n";
+        for (const Column& column : columns) {
+            outFile << "    const " << column.type << "* " << column.name << ",\n";
+        }
+        outFile << "    size_t count\n";
+        outFile << ") {\n";
+        outFile << "    union {\n";
+        outFile << "        unsigned char bytes[" << stride << "];\n";
+        outFile << "        uint64_t align;\n";
+        outFile << "    } element;\n";
+        outFile << "    unsigned char* out = (unsigned char*)dst;\n";
+        outFile << "    size_t i;\n";
+        if (hasArrays) {
+            outFile << "    size_t k;\n";
+        }
+        outFile << "    memset(&element, 0, sizeof(element));\n";
+        outFile << "    for (i = 0; i < count; i++) {\n";
+
+        for (const Column& column : columns) {
+            const ShaderType& type = column.member->type;
+
+            int items = 1;
+            for (int size : type.arraySizes) {
+                items *= size;
+            }
+
+            // Values of the column per item, and the bytes each vector of an item takes.
+            int vectors = 1;
+            int components = 1;
+            if (type.isMatrix()) {
+                vectors = type.rowMajor ? type.matrixRows : type.matrixCols;
+                components = type.rowMajor ? type.matrixCols : type.matrixRows;
+            } else if (!type.isStruct()) {
+                components = type.vectorSize;
+            }
+            std::string vectorSize = type.isStruct()
+                                         ? "sizeof(*" + column.name + ")"
+                                         : std::to_string(
+                                               components * ComponentSize(type.basicType)
+                                           );
+
+            std::string indent = "        ";
+            std::string arrayOffset;
+            std::string source = "i";
+            if (type.isArray()) {
+                outFile << indent << "for (k = 0; k < " << items << "; k++) {\n";
+                indent += "    ";
+                arrayOffset = " + k * " + std::to_string(type.arrayStride);
+                source = "(i * " + std::to_string(items) + " + k)";
+            }
+            if (vectors * components > 1) {
+                source += " * " + std::to_string(vectors * components);
+            }
+
+            for (int v = 0; v < vectors; v++) {
+                std::string vectorOffset =
+                    std::to_string(type.offset + v * type.matrixStride) + arrayOffset;
+                std::string vectorSource = source;
+                if (v > 0) {
+                    vectorSource += " + " + std::to_string(v * components);
+                }
+                outFile << indent << "memcpy(element.bytes + " << vectorOffset << ", "
+                        << column.name << " + " << vectorSource << ", " << vectorSize
+                        << ");\n";
+            }
+
+            if (type.isArray()) {
+                outFile << "        }\n";
+            }
+        }
+
+        outFile << "        glslop_soa_store(out + i * " << stride << ", element.bytes, "
+                << stride << ");\n";
+        outFile << "    }\n";
+        outFile << "    glslop_soa_fence();\n";
+        outFile << "}\n";
+    }
+
+    // Writes a setter for each member of a block that records the bytes it changes, and a
+    // flush function that copies only those bytes into the block in mapped memory. One
+    // dimensional arrays also get a setter per element. Elements of a trailing unsized array
+    // are tracked one by one, in a bit array the caller sizes for the elements it uses.
+    void generateDirtyTracking(
+        const std::string& fullName,
+        const ShaderType& blockType,
+        std::ostream& outFile
+    ) {
+        outFile << s_dirtyTrackingDefinition;
+
+        std::string parameters = fullName + "* block, glslop_dirty_ranges* dirty";
+        const ShaderMember* tail = nullptr;
+
+        // Writes the body of a setter that stores value into target.
+        auto store = [&](const std::string& target, const std::string& value) {
+            if (value.back() == ']') {
+                outFile << "    memcpy(&" << target << ", value, sizeof(" << target << "));\n";
+            } else {
+                outFile << "    " << target << " = value;\n";
+            }
+        };
+
+        for (const ShaderMember& member : blockType.members) {
+            const ShaderType& type = member.type;
+            std::string setter = fullName + "_set_" + member.name;
+            std::string field = "block->" + member.name;
+
+            ShaderType elementType = type;
+            elementType.arraySizes.clear();
+            std::string element = getElementString(elementType, "value");
+            bool paddedElements = type.isArray() && type.arrayStride > type.elementSize;
+            std::string elementField = field + "[index]" + (paddedElements ? ".value" : "");
+
+            if (type.isArray() && !type.isSizedArray()) {
+                if (type.arraySizes.size() == 1) {
+                    tail = &member;
+                    outFile << "static inline void " << setter << "(" << fullName
+                            << "* block, uint32_t* dirty_elements, size_t index, const "
+                            << element << ") {\n";
+                    store(elementField, element);
+                    outFile << "    glslop_dirty_mark_element(dirty_elements, index);\n";
+                    outFile << "}\n";
+                }
+                continue;
+            }
+
+            std::string value = getMemberDeclaration(fullName, member, "value");
+            outFile << "static inline void " << setter << "(" << parameters << ", const "
+                    << value << ") {\n";
+            store(field, value);
+            outFile << "    glslop_dirty_mark(dirty, offsetof(" << fullName << ", "
+                    << member.name << "), sizeof(" << field << "));\n";
+            outFile << "}\n";
+
+            if (type.arraySizes.size() == 1) {
+                outFile << "static inline void " << setter << "_at(" << parameters
+                        << ", size_t index, const " << element << ") {\n";
+                store(elementField, element);
+                outFile << "    glslop_dirty_mark(\n";
+                outFile << "        dirty,\n";
+                outFile << "        offsetof(" << fullName << ", " << member.name
+                        << ") + index * sizeof(" << field << "[0]),\n";
+                outFile << "        sizeof(" << field << "[0])\n";
+                outFile << "    );\n";
+                outFile << "}\n";
+            }
+        }
+
+        outFile << "static inline void " << fullName << "_flush(" << parameters;
+        if (tail) {
+            outFile << ", uint32_t* " << tail->name << "_dirty_elements, size_t " << tail->name
+                    << "_count";
+        }
+        outFile << ", void* mapped) {\n";
+        outFile << "    glslop_dirty_flush(dirty, mapped, block);\n";
+        if (tail) {
+            std::string field = "block->" + tail->name;
+            outFile << "    glslop_dirty_flush_elements(\n";
+            outFile << "        " << tail->name << "_dirty_elements,\n";
+            outFile << "        " << tail->name << "_count,\n";
+            outFile << "        offsetof(" << fullName << ", " << tail->name << "),\n";
+            outFile << "        sizeof(" << field << "[0]),\n";
+            outFile << "        mapped,\n";
+            outFile << "        block\n";
+            outFile << "    );\n";
+        }
+        outFile << "}\n";
+    }
+
+    // Returns the declaration of a struct member. Array elements that are smaller than the
+    // array stride, such as floats in std140, are wrapped in a struct padded to the stride
+    // whose definition is written to outFile.
+    std::string getFieldString(
+        const std::string& structName,
+        const ShaderMember& member,
+        std::ostream& outFile
+    ) {
+        const ShaderType& type = member.type;
+
+        ShaderType elementType = type;
+        elementType.arraySizes.clear();
+
+        if (type.isArray() && type.arrayStride > type.elementSize) {
+            std::string wrapperName = structName + "_" + member.name + "_element";
+            outFile << "typedef struct " << wrapperName << " {\n";
+            outFile << "    " << getElementString(elementType, "value") << ";\n";
+            outFile << "    uint8_t _padding[" << type.arrayStride - type.elementSize << "];\n";
+            outFile << "} " << wrapperName << ";\n";
+        }
+
+        return getMemberDeclaration(structName, member, member.name);
+    }
+
+    // Returns the declaration of a member of a struct under the given name, with the padded
+    // element struct getFieldString defines for it if it needs one.
+    std::string getMemberDeclaration(
+        const std::string& structName,
+        const ShaderMember& member,
+        const std::string& name
+    ) {
+        const ShaderType& type = member.type;
+
+        ShaderType elementType = type;
+        elementType.arraySizes.clear();
+
+        std::string dimensions;
+        for (int size : type.arraySizes) {
+            dimensions += "[" + (size != 0 ? std::to_string(size) : "") + "]";
+        }
+
+        if (type.isArray() && type.arrayStride > type.elementSize) {
+            return structName + "_" + member.name + "_element " + name + dimensions;
+        }
+
+        return getElementString(elementType, name + dimensions);
+    }
+
+    // Returns the C type of a scalar or of the components of a vector or matrix, or an empty
+    // string for anything else.
+    std::string getComponentType(glslang::TBasicType type) {
+        switch (type) {
+            case glslang::EbtFloat:
+                return "float";
+            case glslang::EbtDouble:
+                return "double";
+            case glslang::EbtFloat16:
+                return halfType;
+            case glslang::EbtInt8:
+                return "int8_t";
+            case glslang::EbtUint8:
+                return "uint8_t";
+            case glslang::EbtInt16:
+                return "int16_t";
+            case glslang::EbtUint16:
+                return "uint16_t";
+            case glslang::EbtInt:
+                return "int";
+            case glslang::EbtUint:
+                return "uint32_t";
+            case glslang::EbtInt64:
+                return "int64_t";
+            case glslang::EbtUint64:
+                return "uint64_t";
+            case glslang::EbtBool:
+                // Booleans are 32 bits wide in buffers, unlike C's bool.
+                return "uint32_t";
+            default:
+                return "";
+        }
+    }
+
+    // Returns the declaration of a non-array type. Vectors become arrays of their components
+    // and matrices arrays of columns (or rows), each padded to the matrix stride.
+    std::string getElementString(const ShaderType& type, const std::string& name) {
+        auto customType = customTypeMap.find(GlslTypeName(type));
+        if (customType != customTypeMap.end()) {
+            return customType->second + " " + name;
+        }
+        std::string fieldString;
+        switch (type.basicType) {
+            case glslang::EbtStruct:
+                fieldString = structPrefix + structsEncountered.nameOf(type);
+                break;
+            case glslang::EbtReference:
+                // The device address of the block, e.g. from vkGetBufferDeviceAddress plus
+                // an offset that is a multiple of its BUFFER_REFERENCE_ALIGN.
+                return "uint64_t " + name + " /* " + structPrefix + type.typeName + "* */";
+            default:
+                fieldString = getComponentType(type.basicType);
+                if (fieldString.empty()) {
+                    return "unknown";
+                }
+                break;
+        }
+
+        if (type.isVector()) {
+            fieldString += " " + name + "[" + std::to_string(type.vectorSize) + "]";
+        } else if (type.isMatrix()) {
+            int vectors = type.rowMajor ? type.matrixRows : type.matrixCols;
+            int components = type.rowMajor ? type.matrixCols : type.matrixRows;
+            if (type.matrixStride > 0) {
+                components = type.matrixStride / ComponentSize(type.basicType);
+            }
+            fieldString += " " + name + "[" + std::to_string(vectors) + "][" +
+                           std::to_string(components) + "]";
+        } else {
+            fieldString += " " + name;
+        }
+
+        return fieldString;
+    }
+};
+
+bool GenerateHeader(
+    const ShaderReflection& reflection,
+    const HeaderOptions& options,
+    const ShaderInput& input,
+    const VariantTable* variants,
+    HeaderExtras& extras,
+    std::ostream& outFile
+) {
+    HeaderGenerator generator(reflection, options, input, variants);
+    generator.packModules = extras.packModules;
+    generator.layoutAdvice = extras.layoutAdvice;
+
+    if (!generator.generate(outFile)) {
+        return false;
+    }
+
+    extras.layoutInclude = std::move(generator.layoutInclude);
+    return true;
+}
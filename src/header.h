@@ -0,0 +1,131 @@
+#pragma once
+
+#include "layout.h"
+#include "pack.h"
+#include "permutation.h"
+#include "reflection.h"
+#include "vertex.h"
+
+#include <glslang/Public/ShaderLang.h>
+
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stddef.h>
+
+// How the SPIR-V words are written into the header.
+enum class SpirvFormat {
+    // Comma separated decimal uint32_t literals.
+    Decimal,
+    // Comma separated hexadecimal uint32_t literals without leading zeros.
+    Hex,
+    // A single string literal, which compilers parse much faster than an initializer list.
+    String,
+    // A raw .spv file next to the header, pulled in with #embed or .incbin.
+    Embed,
+    // Not in the header at all: every module of the run goes into one pack file, see pack.h.
+    // The header only has the key to look the module up by.
+    Pack,
+};
+
+struct ShaderStageInput {
+    std::string inputFile;
+    EShLanguage stage;
+};
+
+struct ShaderInput {
+    // The stages linked into one program, in pipeline order. Usually just one.
+    std::vector<ShaderStageInput> stages;
+    std::string outputFile;
+    std::optional<std::string> name;
+    std::optional<std::string> structPrefix;
+    std::optional<std::string> globalPrefix;
+    std::optional<std::string> depFile;
+    // Define matrix the input is compiled under, and the file it was read from.
+    std::optional<PermutationSpec> permutations;
+    std::optional<std::string> permutationFile;
+    // Formats of vertex inputs by name, for those not read from 32-bit components.
+    std::unordered_map<std::string, VertexFormat> vertexFormats;
+
+    bool isLinked() const {
+        return stages.size() > 1;
+    }
+};
+
+// Short name of a stage, as used in file extensions and generated symbol names.
+const char* StageName(EShLanguage stage);
+
+// Name of the shader used in generated symbols: the given name, or one derived from the file
+// name of the first stage.
+std::string ShaderName(const ShaderInput& input);
+
+// The SPIR-V of every variant of a permuted input, with identical modules collapsed.
+struct VariantTable {
+    struct Stage {
+        EShLanguage stage;
+        std::vector<ShaderStageBinary> modules;
+        // For each variant the index of its module, or -1 if the variant is excluded.
+        std::vector<int> variantModules;
+    };
+
+    // One entry per linked stage, in pipeline order.
+    std::vector<Stage> stages;
+};
+
+// Options of the generated header that apply to every input.
+struct HeaderOptions {
+    // C types to use for GLSL types, by GLSL type name.
+    std::unordered_map<std::string, std::string> customTypeMap;
+    // Written into the header after its own includes.
+    std::string extraPrelude;
+    // C type of 16-bit floats in structs and vertex inputs. It must be 2 bytes, e.g. uint16_t
+    // to handle the raw bits, or _Float16 where the compiler has it.
+    std::string halfType = "uint16_t";
+    SpirvFormat spirvFormat = SpirvFormat::Decimal;
+    // Whether the SPIR-V was optimized or stripped, which adds a size comment to each module.
+    bool optimized = false;
+    // Add a <name>_reordered struct for each block that a different member order makes smaller.
+    bool reorderBlocks = false;
+    // Add setters to each block that record which bytes changed, and a function that copies
+    // only those into mapped memory.
+    bool dirtyTracking = false;
+    // Add a function to each block ending in an unsized array of structs that fills the array
+    // from one array per struct member.
+    bool soaPackers = false;
+};
+
+// What generating a header produces besides the header.
+struct HeaderExtras {
+    // Where modules go with SpirvFormat::Pack, which needs it set.
+    std::vector<PackModule>* packModules = nullptr;
+    // Where the padding analysis of each block goes, if it is wanted.
+    std::vector<LayoutAdvice>* layoutAdvice = nullptr;
+    // With reorderBlocks, the GLSL include of reordered member lists, empty if none is smaller.
+    std::string layoutInclude;
+};
+
+// Writes the header of a compiled input. variants has the modules of every variant when the
+// input is permuted, otherwise it is nullptr and the modules are in reflection. Prints why and
+// returns false if the header can't be generated.
+bool GenerateHeader(
+    const ShaderReflection& reflection,
+    const HeaderOptions& options,
+    const ShaderInput& input,
+    const VariantTable* variants,
+    HeaderExtras& extras,
+    std::ostream& outFile
+);
+
+// Path of the raw SPIR-V file written next to the header in SpirvFormat::Embed. Linked
+// programs get one file per stage, and permuted inputs one per distinct module.
+std::string SpirvSidecarPath(
+    const ShaderInput& input,
+    EShLanguage stage,
+    std::optional<size_t> module = std::nullopt
+);
+
+// Path of the GLSL include of reordered block members written next to the header.
+std::string LayoutIncludePath(const ShaderInput& input);
@@ -0,0 +1,221 @@
+#include "json.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+const JsonValue* JsonValue::find(std::string_view key) const {
+    for (const auto& [name, value] : object) {
+        if (name == key) {
+            return &value;
+        }
+    }
+    return nullptr;
+}
+
+// A recursive descent parser over the whole document.
+struct JsonParser {
+    std::string_view text;
+    size_t position = 0;
+
+    void skipWhitespace() {
+        while (position < text.size() && (text[position] == ' ' || text[position] == '\n' ||
+                                          text[position] == '\r' || text[position] == '\t')) {
+            position++;
+        }
+    }
+
+    bool consume(char c) {
+        skipWhitespace();
+        if (position < text.size() && text[position] == c) {
+            position++;
+            return true;
+        }
+        return false;
+    }
+
+    bool consumeWord(std::string_view word) {
+        if (text.substr(position, word.size()) == word) {
+            position += word.size();
+            return true;
+        }
+        return false;
+    }
+
+    static void appendUtf8(std::string& result, uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            result += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            result += static_cast<char>(0xc0 | codePoint >> 6);
+            result += static_cast<char>(0x80 | (codePoint & 0x3f));
+        } else {
+            result += static_cast<char>(0xe0 | codePoint >> 12);
+            result += static_cast<char>(0x80 | (codePoint >> 6 & 0x3f));
+            result += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+    }
+
+    std::optional<std::string> parseString() {
+        if (!consume('"')) {
+            return std::nullopt;
+        }
+
+        std::string result;
+        while (position < text.size()) {
+            char c = text[position++];
+            if (c == '"') {
+                return result;
+            }
+            if (c != '\\') {
+                result += c;
+                continue;
+            }
+
+            if (position >= text.size()) {
+                return std::nullopt;
+            }
+            char escape = text[position++];
+            switch (escape) {
+                case '"':
+                case '\\':
+                case '/':
+                    result += escape;
+                    break;
+                case 'b':
+                    result += '\b';
+                    break;
+                case 'f':
+                    result += '\f';
+                    break;
+                case 'n':
+                    result += '\n';
+                    break;
+                case 'r':
+                    result += '\r';
+                    break;
+                case 't':
+                    result += '\t';
+                    break;
+                case 'u': {
+                    if (position + 4 > text.size()) {
+                        return std::nullopt;
+                    }
+                    std::string digits(text.substr(position, 4));
+                    char* end = nullptr;
+                    uint32_t codePoint = strtoul(digits.c_str(), &end, 16);
+                    if (end != digits.c_str() + 4) {
+                        return std::nullopt;
+                    }
+                    position += 4;
+                    appendUtf8(result, codePoint);
+                    break;
+                }
+                default:
+                    return std::nullopt;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    std::optional<JsonValue> parseValue(int depth) {
+        // Deep enough for any report, shallow enough not to overflow the stack.
+        if (depth > 64) {
+            return std::nullopt;
+        }
+
+        skipWhitespace();
+        if (position >= text.size()) {
+            return std::nullopt;
+        }
+
+        JsonValue value;
+        char c = text[position];
+
+        if (c == '{') {
+            position++;
+            value.type = JsonValue::Type::Object;
+            if (consume('}')) {
+                return value;
+            }
+            do {
+                std::optional<std::string> key = parseString();
+                if (!key || !consume(':')) {
+                    return std::nullopt;
+                }
+                std::optional<JsonValue> member = parseValue(depth + 1);
+                if (!member) {
+                    return std::nullopt;
+                }
+                value.object.push_back({ std::move(*key), std::move(*member) });
+            } while (consume(','));
+            return consume('}') ? std::optional(std::move(value)) : std::nullopt;
+        }
+
+        if (c == '[') {
+            position++;
+            value.type = JsonValue::Type::Array;
+            if (consume(']')) {
+                return value;
+            }
+            do {
+                std::optional<JsonValue> element = parseValue(depth + 1);
+                if (!element) {
+                    return std::nullopt;
+                }
+                value.array.push_back(std::move(*element));
+            } while (consume(','));
+            return consume(']') ? std::optional(std::move(value)) : std::nullopt;
+        }
+
+        if (c == '"') {
+            std::optional<std::string> string = parseString();
+            if (!string) {
+                return std::nullopt;
+            }
+            value.type = JsonValue::Type::String;
+            value.string = std::move(*string);
+            return value;
+        }
+
+        if (consumeWord("true")) {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+            return value;
+        }
+
+        if (consumeWord("false")) {
+            value.type = JsonValue::Type::Bool;
+            return value;
+        }
+
+        if (consumeWord("null")) {
+            return value;
+        }
+
+        // strtod needs a terminated string, and accepts more than JSON does, such as hex and
+        // "inf". Only the characters JSON numbers can have are passed to it.
+        size_t start = position;
+        while (position < text.size() &&
+               std::string_view("+-.0123456789eE").find(text[position]) != std::string::npos) {
+            position++;
+        }
+        std::string number(text.substr(start, position - start));
+        char* end = nullptr;
+        value.number = strtod(number.c_str(), &end);
+        if (number.empty() || end != number.c_str() + number.size()) {
+            return std::nullopt;
+        }
+        value.type = JsonValue::Type::Number;
+        return value;
+    }
+};
+
+std::optional<JsonValue> ParseJson(std::string_view text) {
+    JsonParser parser { text };
+    std::optional<JsonValue> value = parser.parseValue(0);
+    parser.skipWhitespace();
+    if (!value || parser.position != text.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
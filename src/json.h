@@ -0,0 +1,69 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <stdio.h>
+
+// Returns value as a quoted JSON string.
+inline std::string JsonString(std::string_view value) {
+    std::string result = "\"";
+    for (char c : value) {
+        switch (c) {
+            case '"':
+                result += "\\\"";
+                break;
+            case '\\':
+                result += "\\\\";
+                break;
+            case '\n':
+                result += "\\n";
+                break;
+            case '\r':
+                result += "\\r";
+                break;
+            case '\t':
+                result += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escape[8];
+                    snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    result += escape;
+                } else {
+                    result += c;
+                }
+        }
+    }
+    result += "\"";
+    return result;
+}
+
+// A parsed JSON document, for reading back reports glslop wrote.
+struct JsonValue {
+    enum class Type {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    // Members in document order.
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    // The member named key of an object, or nullptr if there is none.
+    const JsonValue* find(std::string_view key) const;
+};
+
+// Parses a JSON document. Returns std::nullopt if it is malformed.
+std::optional<JsonValue> ParseJson(std::string_view text);
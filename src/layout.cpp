@@ -0,0 +1,341 @@
+#include "layout.h"
+#include "json.h"
+
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+
+#include <stdio.h>
+
+static int RoundUp(int value, int alignment) {
+    return alignment > 0 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+int ComponentSize(glslang::TBasicType type) {
+    switch (type) {
+        case glslang::EbtInt8:
+        case glslang::EbtUint8:
+            return 1;
+        case glslang::EbtFloat16:
+        case glslang::EbtInt16:
+        case glslang::EbtUint16:
+            return 2;
+        case glslang::EbtDouble:
+        case glslang::EbtInt64:
+        case glslang::EbtUint64:
+        case glslang::EbtReference:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+// Bytes of data in the members of a struct, without any padding. Unsized arrays count as
+// empty, like they do in the size of the struct.
+static int MemberPayload(const ShaderType& type);
+
+static int Payload(const ShaderType& type) {
+    int count = 1;
+    for (int size : type.arraySizes) {
+        count *= size;
+    }
+
+    if (type.isStruct()) {
+        return count * MemberPayload(type);
+    }
+
+    int components = type.isMatrix() ? type.matrixCols * type.matrixRows : type.vectorSize;
+    return count * components * ComponentSize(type.basicType);
+}
+
+static int MemberPayload(const ShaderType& type) {
+    int payload = 0;
+    for (const ShaderMember& member : type.members) {
+        payload += Payload(member.type);
+    }
+    return payload;
+}
+
+// Size of a struct, or of one element of an array of blocks.
+static int StructSize(const ShaderType& type) {
+    return type.isArray() ? type.elementSize : type.size;
+}
+
+// Lays out the members of type in the given order, each at the next offset matching its
+// alignment, as std140, std430 and scalar all do for members without explicit offsets.
+static ShaderType LayOut(const ShaderType& type, const std::vector<size_t>& order) {
+    ShaderType result = type;
+    result.members.clear();
+
+    int offset = 0;
+    for (size_t index : order) {
+        ShaderMember member = type.members[index];
+        offset = RoundUp(offset, member.type.alignment);
+        member.type.offset = offset;
+        offset += member.type.size;
+        result.members.push_back(std::move(member));
+    }
+
+    int size = RoundUp(offset, type.alignment);
+    if (type.isArray()) {
+        int count = 1;
+        for (int arraySize : type.arraySizes) {
+            count *= arraySize;
+        }
+        result.elementSize = size;
+        result.arrayStride = size;
+        result.size = size * count;
+    } else {
+        result.size = size;
+    }
+
+    return result;
+}
+
+// StructSize of LayOut(type, order), without copying the type.
+static int LaidOutSize(const ShaderType& type, const std::vector<size_t>& order) {
+    int offset = 0;
+    for (size_t index : order) {
+        offset = RoundUp(offset, type.members[index].type.alignment);
+        offset += type.members[index].type.size;
+    }
+    return RoundUp(offset, type.alignment);
+}
+
+int LayoutAdvice::reorderedPadding() const {
+    return reorderedSize() - (size - padding);
+}
+
+LayoutAdvice AdviseLayout(const std::string& name, const ShaderType& type) {
+    LayoutAdvice advice;
+    advice.name = name;
+    advice.size = StructSize(type);
+    advice.padding = advice.size - MemberPayload(type);
+
+    size_t memberCount = type.members.size();
+    std::vector<size_t> order(memberCount);
+    std::iota(order.begin(), order.end(), 0);
+
+    // Members that don't land where the packing rules put them have explicit offsets.
+    ShaderType original = LayOut(type, order);
+    if (StructSize(original) != advice.size) {
+        return advice;
+    }
+    for (size_t i = 0; i < memberCount; i++) {
+        if (original.members[i].type.offset != type.members[i].type.offset) {
+            return advice;
+        }
+    }
+
+    // A runtime array has to stay the last member.
+    size_t movable = memberCount;
+    if (memberCount > 0 && type.members.back().type.isArray() &&
+        !type.members.back().type.isSizedArray()) {
+        movable--;
+    }
+
+    int bestSize = advice.size;
+    std::optional<std::vector<size_t>> best;
+    auto consider = [&](const std::vector<size_t>& candidate) {
+        int size = LaidOutSize(type, candidate);
+        if (size < bestSize) {
+            bestSize = size;
+            best = candidate;
+        }
+    };
+
+    if (movable <= 8) {
+        // Where a member lands only depends on its alignment and size, so members alike in
+        // both are interchangeable and only distinct orders of those shapes are tried.
+        auto shape = [&](size_t index) {
+            const ShaderType& member = type.members[index].type;
+            return std::make_pair(member.alignment, member.size);
+        };
+        auto byShape = [&](size_t a, size_t b) {
+            return shape(a) < shape(b);
+        };
+
+        std::vector<size_t> candidate = order;
+        std::sort(candidate.begin(), candidate.begin() + movable, byShape);
+        do {
+            consider(candidate);
+        } while (
+            std::next_permutation(candidate.begin(), candidate.begin() + movable, byShape)
+        );
+
+        if (best) {
+            // Members alike in shape keep their declared order.
+            std::vector<size_t>& members = *best;
+            for (size_t i = 0; i < movable; i++) {
+                for (size_t j = i + 1; j < movable; j++) {
+                    if (shape(members[i]) == shape(members[j]) && members[j] < members[i]) {
+                        std::swap(members[i], members[j]);
+                    }
+                }
+            }
+            advice.reordered = LayOut(type, members);
+        }
+        return advice;
+    }
+
+    auto alignmentOf = [&](size_t index) {
+        return type.members[index].type.alignment;
+    };
+
+    std::vector<size_t> sorted = order;
+    std::stable_sort(sorted.begin(), sorted.begin() + movable, [&](size_t a, size_t b) {
+        return alignmentOf(a) > alignmentOf(b);
+    });
+    consider(sorted);
+
+    // Fill each gap with the member that leaves the smallest one, preferring larger
+    // alignments, which are harder to place later.
+    std::vector<size_t> greedy;
+    std::vector<size_t> remaining(order.begin(), order.begin() + movable);
+    int offset = 0;
+    while (!remaining.empty()) {
+        auto gap = [&](size_t index) {
+            return RoundUp(offset, alignmentOf(index)) - offset;
+        };
+        auto fitsBetter = [&](size_t a, size_t b) {
+            return std::make_pair(gap(a), -alignmentOf(a)) <
+                   std::make_pair(gap(b), -alignmentOf(b));
+        };
+        auto next = std::min_element(remaining.begin(), remaining.end(), fitsBetter);
+
+        offset = RoundUp(offset, alignmentOf(*next)) + type.members[*next].type.size;
+        greedy.push_back(*next);
+        remaining.erase(next);
+    }
+    greedy.insert(greedy.end(), order.begin() + movable, order.end());
+    consider(greedy);
+
+    if (best) {
+        advice.reordered = LayOut(type, *best);
+    }
+    return advice;
+}
+
+std::string GlslTypeName(const ShaderType& type) {
+    // A buffer reference is declared by the name of the block it points to.
+    if (type.isStruct() || type.basicType == glslang::EbtReference) {
+        return type.typeName;
+    }
+
+    const char* scalar;
+    const char* prefix;
+    switch (type.basicType) {
+        case glslang::EbtDouble:
+            scalar = "double";
+            prefix = "d";
+            break;
+        case glslang::EbtFloat16:
+            scalar = "float16_t";
+            prefix = "f16";
+            break;
+        case glslang::EbtInt:
+            scalar = "int";
+            prefix = "i";
+            break;
+        case glslang::EbtUint:
+            scalar = "uint";
+            prefix = "u";
+            break;
+        case glslang::EbtBool:
+            scalar = "bool";
+            prefix = "b";
+            break;
+        case glslang::EbtInt8:
+            scalar = "int8_t";
+            prefix = "i8";
+            break;
+        case glslang::EbtUint8:
+            scalar = "uint8_t";
+            prefix = "u8";
+            break;
+        case glslang::EbtInt16:
+            scalar = "int16_t";
+            prefix = "i16";
+            break;
+        case glslang::EbtUint16:
+            scalar = "uint16_t";
+            prefix = "u16";
+            break;
+        case glslang::EbtInt64:
+            scalar = "int64_t";
+            prefix = "i64";
+            break;
+        case glslang::EbtUint64:
+            scalar = "uint64_t";
+            prefix = "u64";
+            break;
+        default:
+            scalar = "float";
+            prefix = "";
+            break;
+    }
+
+    if (type.isMatrix()) {
+        std::string name = std::string(prefix) + "mat" + std::to_string(type.matrixCols);
+        if (type.matrixCols != type.matrixRows) {
+            name += "x" + std::to_string(type.matrixRows);
+        }
+        return name;
+    } else if (type.isVector()) {
+        return std::string(prefix) + "vec" + std::to_string(type.vectorSize);
+    }
+    return scalar;
+}
+
+std::string GlslMemberDeclarations(const ShaderType& type) {
+    std::string declarations;
+    for (const ShaderMember& member : type.members) {
+        // Members inherit the block's majorness, so only members that override it need theirs.
+        if (member.type.isMatrix() && member.type.rowMajor != type.rowMajor) {
+            declarations +=
+                member.type.rowMajor ? "layout(row_major) " : "layout(column_major) ";
+        }
+
+        declarations += GlslTypeName(member.type) + " " + member.name;
+        for (int size : member.type.arraySizes) {
+            declarations += "[" + (size != 0 ? std::to_string(size) : "") + "]";
+        }
+        declarations += ";\n";
+    }
+    return declarations;
+}
+
+std::string FormatLayoutReport(const std::vector<LayoutAdvice>& advice) {
+    std::stringstream json;
+    json << "{\n";
+    json << "  \"blocks\": [";
+
+    for (size_t i = 0; i < advice.size(); i++) {
+        const LayoutAdvice& block = advice[i];
+
+        char ratio[32];
+        snprintf(
+            ratio,
+            sizeof(ratio),
+            "%.4f",
+            block.size > 0 ? static_cast<double>(block.padding) / block.size : 0.0
+        );
+
+        json << (i == 0 ? "\n" : ",\n") << "    { \"shader\": " << JsonString(block.shader)
+             << ", \"name\": " << JsonString(block.name) << ", \"size\": " << block.size
+             << ", \"padding\": " << block.padding << ", \"paddingRatio\": " << ratio
+             << ", \"reorderedSize\": " << block.reorderedSize()
+             << ", \"reorderedPadding\": " << block.reorderedPadding() << ", \"order\": [";
+        if (block.reordered) {
+            const std::vector<ShaderMember>& members = block.reordered->members;
+            for (size_t j = 0; j < members.size(); j++) {
+                json << (j == 0 ? "" : ", ") << JsonString(members[j].name);
+            }
+        }
+        json << "] }";
+    }
+
+    json << "\n  ]\n";
+    json << "}\n";
+    return json.str();
+}
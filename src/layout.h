@@ -0,0 +1,55 @@
+#pragma once
+
+#include "reflection.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// How much of a struct or block with an explicit layout is padding, and the member order that
+// needs the least of it.
+struct LayoutAdvice {
+    // Name of the shader the type belongs to, filled in by the caller.
+    std::string shader;
+    std::string name;
+    int size = 0;
+    // Bytes not holding member data: gaps between members, padding at the end, and padding
+    // inside array elements and matrices, such as std140 rounding float[] elements up to 16.
+    int padding = 0;
+    // The type with its members reordered and laid out again, if that makes it smaller. Not
+    // set for types with members at explicit offsets, whose order is fixed.
+    std::optional<ShaderType> reordered;
+
+    int reorderedSize() const {
+        return reordered ? (reordered->isArray() ? reordered->elementSize : reordered->size)
+                         : size;
+    }
+
+    int reorderedPadding() const;
+};
+
+// Analyzes a struct or block type that has a layout. A trailing runtime array stays last.
+// Orders of up to 8 members are searched exhaustively, skipping those that only swap members
+// of the same alignment and size. Larger types use the better of sorting by alignment and
+// greedily filling each gap.
+LayoutAdvice AdviseLayout(const std::string& name, const ShaderType& type);
+
+// Size in bytes of one component of a scalar, vector or matrix of a type, e.g. 2 for
+// float16_t and 8 for double.
+int ComponentSize(glslang::TBasicType type);
+
+// The GLSL name of a type without its array dimensions, e.g. f16vec3 or dmat4. Structs and
+// buffer references are named by their struct or block type.
+std::string GlslTypeName(const ShaderType& type);
+
+// The members of a struct or block type as GLSL declarations, one per line. Matrices whose
+// majorness differs from the type's carry their own row_major or column_major qualifier.
+std::string GlslMemberDeclarations(const ShaderType& type);
+
+// Formats advice for every analyzed type as a JSON report:
+//
+//   { "blocks": [ { "shader", "name", "size", "padding", "paddingRatio", "reorderedSize",
+//                   "reorderedPadding", "order": [member names] }, ... ] }
+//
+// order is empty when no order is smaller than the declared one.
+std::string FormatLayoutReport(const std::vector<LayoutAdvice>& advice);
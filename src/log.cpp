@@ -0,0 +1,44 @@
+#include "log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+static thread_local OutputCapture* t_outputCapture = nullptr;
+
+ScopedOutputCapture::ScopedOutputCapture(OutputCapture* capture) : previous(t_outputCapture) {
+    t_outputCapture = capture;
+}
+
+ScopedOutputCapture::~ScopedOutputCapture() {
+    t_outputCapture = previous;
+}
+
+OutputCapture* CurrentOutputCapture() {
+    return t_outputCapture;
+}
+
+void Print(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    if (!t_outputCapture) {
+        vprintf(format, args);
+        va_end(args);
+        return;
+    }
+
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    int length = vsnprintf(nullptr, 0, format, argsCopy);
+    va_end(argsCopy);
+
+    if (length > 0) {
+        std::string text(length, '\0');
+        vsnprintf(text.data(), text.size() + 1, format, args);
+
+        std::lock_guard<std::mutex> lock(t_outputCapture->mutex);
+        t_outputCapture->text += text;
+    }
+
+    va_end(args);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+
+// Collects everything printed with Print on the threads it is installed on, so diagnostics
+// can be sent elsewhere (e.g. back to a client of the compile server) instead of stdout.
+struct OutputCapture {
+    std::mutex mutex;
+    std::string text;
+};
+
+// Installs an OutputCapture on the current thread for its lifetime.
+class ScopedOutputCapture {
+  public:
+    explicit ScopedOutputCapture(OutputCapture* capture);
+    ~ScopedOutputCapture();
+
+    ScopedOutputCapture(const ScopedOutputCapture&) = delete;
+    ScopedOutputCapture& operator=(const ScopedOutputCapture&) = delete;
+
+  private:
+    OutputCapture* previous;
+};
+
+// Returns the capture installed on the current thread, or nullptr if output goes to stdout.
+OutputCapture* CurrentOutputCapture();
+
+// printf to stdout, or to the current thread's OutputCapture if one is installed.
+void Print(const char* format, ...) __attribute__((format(printf, 1, 2)));
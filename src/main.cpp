@@ -1,729 +1,1369 @@
 #include <filesystem>
 #include <glslang/Include/Common.h>
 #include <glslang/Public/ShaderLang.h>
-#include <glslang/Public/ResourceLimits.h>
 #include <SPIRV/GlslangToSpv.h>
 
 #include <glslang/Include/intermediate.h>
 
+#include "args.h"
+#include "cache.h"
+#include "compiler.h"
+#include "cost.h"
+#include "hash.h"
+#include "header.h"
+#include "layout.h"
+#include "optimizer.h"
+#include "pack.h"
+#include "log.h"
+#include "permutation.h"
+#include "profile.h"
+#include "reflection.h"
+#include "server.h"
+#include "watch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <set>
 #include <sstream>
 #include <string_view>
 #include <string>
 #include <fstream>
+#include <thread>
+#include <vector>
 
 #include <stdio.h>
 #include <stdint.h>
+#include <unistd.h>
 #include <unordered_map>
+#include <unordered_set>
 
-struct Args {
-    std::string inputFile;
-    std::string outputFile;
-    std::optional<std::string> structPrefix;
-    std::optional<std::string> globalPrefix;
-
-    std::string extraPrelude;
-    std::unordered_map<std::string, std::string> customTypeMap;
-    EShLanguage stage;
-
-    static EShLanguage guessStageFromFileName(const std::string& fileName) {
-        if (fileName.find(".vert") != std::string::npos) {
-            return EShLanguage::EShLangVertex;
-        } else if (fileName.find(".frag") != std::string::npos) {
-            return EShLanguage::EShLangFragment;
-        } else if (fileName.find(".comp") != std::string::npos) {
-            return EShLanguage::EShLangCompute;
-        } else {
-            return EShLanguage::EShLangVertex; // default to vertex shader
-        }
+static std::shared_ptr<const std::string> ReadFileShared(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return nullptr;
     }
 
-    Args(int argc, char* argv[]) {
-        std::optional<std::string> inputFile;
-        std::optional<std::string> outputFile;
-        std::optional<EShLanguage> stage;
+    return std::make_shared<const std::string>(
+        std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>()
+    );
+}
 
-        for (int i = 1; i < argc; i++) {
-            std::string_view arg = argv[i];
+// Include file contents kept in memory across compiles by the server. Entries are
+// revalidated against the file's modification time and size on every lookup.
+class IncludeCache {
+  public:
+    std::shared_ptr<const std::string> load(const std::filesystem::path& path) {
+        std::error_code error;
+        std::filesystem::file_time_type lastWrite =
+            std::filesystem::last_write_time(path, error);
+        uintmax_t size = std::filesystem::file_size(path, error);
+        if (error) {
+            return nullptr;
+        }
 
-            if (arg == "-o" || arg == "--output") {
-                if (i + 1 < argc) {
-                    outputFile = argv[++i];
-                } else {
-                    printf("No output file specified\n");
-                    exit(1);
-                }
-            } else if (arg == "-s" || arg == "--stage") {
-                if (i + 1 < argc) {
-                    std::string_view stageStr = argv[++i];
-                    if (stageStr == "vert" || stageStr == "vertex") {
-                        stage = EShLanguage::EShLangVertex;
-                    } else if (stageStr == "frag" || stageStr == "fragment") {
-                        stage = EShLanguage::EShLangFragment;
-                    } else if (stageStr == "comp" || stageStr == "compute") {
-                        stage = EShLanguage::EShLangCompute;
-                    } else {
-                        printf("Unknown stage %s\n", stageStr.data());
-                        exit(1);
-                    }
-                } else {
-                    printf("No stage specified\n");
-                    exit(1);
-                }
-            } else if (arg == "-p" || arg == "--prefix") {
-                if (i + 1 < argc) {
-                    structPrefix = argv[++i];
-                } else {
-                    printf("No struct prefix specified\n");
-                    exit(1);
-                }
-            } else if (arg == "-g" || arg == "--global-prefix") {
-                if (i + 1 < argc) {
-                    globalPrefix = argv[++i];
-                } else {
-                    printf("No global prefix specified\n");
-                    exit(1);
-                }
-            } else if (arg == "-m" || arg == "--map") {
-                if (i + 1 < argc) {
-                    std::string_view typeMap = argv[++i];
-                    size_t equals = typeMap.find('=');
-                    if (equals == std::string::npos) {
-                        printf("Invalid type map %s\n", typeMap.data());
-                        exit(1);
-                    }
+        std::string key = path.string();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (it != entries.end() && it->second.lastWrite == lastWrite &&
+                it->second.size == size) {
+                return it->second.contents;
+            }
+        }
+
+        std::shared_ptr<const std::string> contents = ReadFileShared(path);
+        if (!contents) {
+            return nullptr;
+        }
 
-                    std::string_view key = typeMap.substr(0, equals);
-                    std::string_view value = typeMap.substr(equals + 1);
+        std::lock_guard<std::mutex> lock(mutex);
+        entries[key] = { lastWrite, size, contents };
+        return contents;
+    }
 
-                    customTypeMap[std::string(key)] = std::string(value);
-                } else {
-                    printf("No type map specified\n");
-                    exit(1);
-                }
-            } else if (arg == "-P" || arg == "--prelude") {
-                if (i + 1 < argc) {
-                    std::string extraPreludeFile = argv[++i];
-                    std::ifstream file(extraPreludeFile);
-                    if (!file.is_open()) {
-                        printf(
-                            "Failed to open extra prelude file %s\n",
-                            extraPreludeFile.data()
-                        );
-                        exit(1);
-                    }
+  private:
+    struct Entry {
+        std::filesystem::file_time_type lastWrite;
+        uintmax_t size;
+        std::shared_ptr<const std::string> contents;
+    };
 
-                    extraPrelude = std::string(
-                        (std::istreambuf_iterator<char>(file)),
-                        std::istreambuf_iterator<char>()
-                    );
-                } else {
-                    printf("No extra prelude file specified\n");
-                    exit(1);
-                }
-            } else if (arg == "-h" || arg == "--help") {
-                printf("Usage: %s [options] <input file>\n", argv[0]);
-                printf("Options:\n");
-                printf("  -o, --output <file>      Output file\n");
-                printf("  -s, --stage <stage>      Shader stage (vert, frag, comp)\n");
-                printf("  -p, --prefix <prefix>    Struct prefix\n");
-                printf("  -g, --global-prefix <prefix> Global prefix\n");
-                printf("  -m, --map <key>=<value>  Custom type map\n");
-                printf("  -P, --prelude <file>     Extra prelude file\n");
-                printf("  -h, --help               Show this help message\n");
-
-                exit(0);
-            } else {
-                inputFile = arg;
-            }
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+};
+
+// Resolves includes relative to the including file, opening them from workingDirectory,
+// which is the process working directory if empty. With an includeCache, contents are shared
+// across compiles instead of read from disk every time.
+static IncludeResolver
+FileIncludeResolver(const std::filesystem::path& workingDirectory, IncludeCache* includeCache) {
+    return [workingDirectory, includeCache](
+               const std::string& headerName,
+               const std::string& includerName
+           ) -> std::optional<ResolvedInclude> {
+        std::filesystem::path lookupBase = std::filesystem::path(includerName).parent_path();
+        std::filesystem::path headerPath = (lookupBase / headerName).lexically_normal();
+        std::filesystem::path openPath = workingDirectory / headerPath;
+
+        std::shared_ptr<const std::string> contents =
+            includeCache ? includeCache->load(openPath) : ReadFileShared(openPath);
+        if (!contents) {
+            Print("Failed to open include file %s\n", headerPath.string().c_str());
+            return ResolvedInclude { headerPath.string(), nullptr };
         }
 
-        if (inputFile) {
-            this->inputFile = *inputFile;
-            if (!outputFile) {
-                size_t lastSlash = this->inputFile.find_last_of("/\\");
-                size_t lastDot = this->inputFile.find_last_of(".");
-                if (lastDot == std::string::npos) {
-                    lastDot = this->inputFile.size();
-                }
+        return ResolvedInclude { headerPath.string(), std::move(contents) };
+    };
+}
 
-                if (lastSlash == std::string::npos) {
-                    lastSlash = 0;
-                } else {
-                    lastSlash++;
-                }
+// The defines a variant of an input is compiled with: those of the permutation axes set in
+// the variant.
+static std::string VariantDefines(const ShaderInput& input, uint32_t variant) {
+    return input.permutations ? input.permutations->defines(variant) : "";
+}
 
-                size_t start = lastSlash;
-                size_t end = lastDot;
+// Hashes everything that affects the SPIR-V and reflection of a program, given the
+// preprocessed source of each of its stages.
+static uint64_t CacheKey(
+    const Args& args,
+    const ShaderInput& input,
+    const std::vector<std::string>& preprocessedSources
+) {
+    Hasher hasher;
+    for (size_t i = 0; i < input.stages.size(); i++) {
+        hasher.update(preprocessedSources[i]);
+        hasher.update(static_cast<uint64_t>(input.stages[i].stage));
+    }
+    hasher.update(TargetVersionKey());
+    hasher.update(static_cast<uint64_t>(args.optimizerOptions.level));
+    hasher.update(static_cast<uint64_t>(args.optimizerOptions.stripDebugInfo));
+    hasher.update(static_cast<uint64_t>(args.optimizerOptions.validate));
+    hasher.update(args.extraPrelude);
+
+    // Sorted, so that the key doesn't depend on hash map iteration order.
+    std::vector<std::pair<std::string, std::string>> typeMap(
+        args.customTypeMap.begin(),
+        args.customTypeMap.end()
+    );
+    std::sort(typeMap.begin(), typeMap.end());
+    for (const auto& [key, value] : typeMap) {
+        hasher.update(key);
+        hasher.update(value);
+    }
 
-                this->outputFile = this->inputFile.substr(start, end - start) + ".h";
-            } else {
-                this->outputFile = *outputFile;
-            }
-            if (stage) {
-                this->stage = *stage;
-            } else {
-                this->stage = guessStageFromFileName(this->inputFile);
-            }
-        } else {
-            printf("No input file specified\n");
-            exit(1);
+    return hasher.digest();
+}
+
+// Escapes a path for use in a Makefile rule. Ninja's depfile parser accepts the same syntax.
+static std::string EscapeDepFilePath(const std::string& path) {
+    std::string escaped;
+    for (char c : path) {
+        if (c == ' ' || c == '#') {
+            escaped += '\\';
+        } else if (c == '$') {
+            escaped += '$';
         }
+        escaped += c;
     }
-};
-static std::string g_FirstPath;
+    return escaped;
+}
 
-class BasicIncluder : public glslang::TShader::Includer {
-  public:
-    IncludeResult*
-    includeLocal(const char* headerName, const char* includerName, size_t) override {
-        std::filesystem::path lookupBase = std::filesystem::current_path();
-        if (includerName && includerName[0] != '\0') {
-            lookupBase = std::filesystem::path(includerName).parent_path();
-        } else {
-            lookupBase = std::filesystem::path(g_FirstPath).parent_path();
-        }
+static std::string
+GenerateDepFile(const ShaderInput& input, const std::vector<std::string>& includedFiles) {
+    std::string depFile = EscapeDepFilePath(input.outputFile) + ":";
+    for (const ShaderStageInput& stage : input.stages) {
+        depFile += " \\\n  " + EscapeDepFilePath(stage.inputFile);
+    }
+    if (input.permutationFile) {
+        depFile += " \\\n  " + EscapeDepFilePath(*input.permutationFile);
+    }
+    for (const std::string& includedFile : includedFiles) {
+        depFile += " \\\n  " + EscapeDepFilePath(includedFile);
+    }
+    depFile += "\n";
+    return depFile;
+}
 
-        std::filesystem::path headerPath = lookupBase / headerName;
-        if (!std::filesystem::exists(headerPath)) {
-            printf("Failed to open include file %ls\n", headerPath.c_str());
-            return nullptr;
-        }
+// One variant of an input, as compiled by a worker.
+struct CompiledVariant {
+    std::optional<ShaderReflection> reflection;
+    // Files included by any of the stages, in the order first included. Also collected when
+    // the compile fails, as far as it got.
+    std::vector<std::string> includedFiles;
+    // Includes that weren't found, where they would have been.
+    std::vector<std::string> missingFiles;
+};
 
-        std::ifstream file(headerPath);
-        if (!file.is_open()) {
-            printf("Failed to open include file %ls\n", headerPath.c_str());
-            return nullptr;
+// Adds the files of list missing from files, keeping their order.
+static void AddFiles(std::vector<std::string>& files, const std::vector<std::string>& list) {
+    for (const std::string& file : list) {
+        if (std::find(files.begin(), files.end(), file) == files.end()) {
+            files.push_back(file);
         }
+    }
+}
 
-        std::string headerSource(
-            (std::istreambuf_iterator<char>(file)),
-            std::istreambuf_iterator<char>()
-        );
+// The compile cache as a CompileRequest of one input uses it, keyed by everything about the
+// input and arguments that affects the program, besides the preprocessed sources.
+class InputProgramCache : public ProgramCache {
+  public:
+    InputProgramCache(const Args& args, const ShaderInput& input, CompileCache& cache)
+        : args(args),
+          input(input),
+          cache(cache) {}
+
+    std::optional<ShaderReflection>
+    load(const std::vector<std::string>& preprocessedSources) override {
+        PhaseTimer timer("cache", input.stages[0].inputFile);
+        return cache.load(CacheKey(args, input, preprocessedSources));
+    }
+
+    void store(
+        const std::vector<std::string>& preprocessedSources,
+        const ShaderReflection& reflection
+    ) override {
+        PhaseTimer timer("cache", input.stages[0].inputFile);
+        cache.store(CacheKey(args, input, preprocessedSources), reflection);
+    }
 
-        char* content = new char[headerSource.size()];
-        memcpy(content, headerSource.c_str(), headerSource.size());
-        size_t length = headerSource.size();
+  private:
+    const Args& args;
+    const ShaderInput& input;
+    CompileCache& cache;
+};
 
-        IncludeResult* result = new IncludeResult(headerName, content, length, content);
+// Holds compiles back while the process has more resident memory than --max-rss, so that
+// compiles run one at a time rather than side by side when memory is tight. A compile starts
+// right away when none is running, whatever is resident: memory the process keeps after
+// its compiles finish won't go away by waiting, and failing would fail every later compile
+// of a server or watch. A compile that grows the process past the limit isn't stopped.
+class ResidentLimit {
+  public:
+    // Waits until no compile is running, or the process is under limit.
+    void enter(uint64_t limit) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running > 0 && overLimit(limit)) {
+            finished.wait(lock);
+        }
+        running++;
+    }
 
-        return result;
+    // Ends a compile that enter let start.
+    void leave() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+        }
+        finished.notify_all();
     }
 
-    void releaseInclude(IncludeResult* result) override {
-        delete[] static_cast<char*>(result->userData);
-        delete result;
+  private:
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t running = 0;
+
+    // Memory freed by finished compiles is usually kept by the allocator, so it is handed
+    // back before measuring.
+    static bool overLimit(uint64_t limit) {
+        ReleaseFreeHeap();
+        return ResidentBytes() > static_cast<int64_t>(limit);
     }
 };
 
-static const char* s_defaultShaderPreamble =
-    "#extension GL_GOOGLE_include_directive : enable\n";
+// Shared by every compile in the process, as resident memory is.
+static ResidentLimit s_residentLimit;
+
+// Compiles the stages of an input into a program with compiler, with the given defines.
+// Errors are reported for this input only, so a failing shader doesn't stop the rest of a
+// batch.
+static bool CompileProgram(
+    const Compiler& compiler,
+    const Args& args,
+    const ShaderInput& input,
+    const std::string& defines,
+    CompileCache* cache,
+    IncludeCache* includeCache,
+    CompiledVariant& result
+) {
+    CompileRequest request;
+    for (const ShaderStageInput& stage : input.stages) {
+        PhaseTimer timer("read", stage.inputFile);
+
+        std::ifstream file(args.resolvePath(stage.inputFile));
+        if (!file.is_open()) {
+            Print("Failed to open file %s\n", stage.inputFile.c_str());
+            return false;
+        }
 
-static glslang::TProgram*
-CompileShader(const char* shaderSource, const char*, EShLanguage stage) {
-    glslang::TShader* shader = new glslang::TShader(stage);
-    shader->setStrings(&shaderSource, 1);
-    shader->setPreamble(s_defaultShaderPreamble);
-    shader->setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, 100);
-    shader->setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_2);
-    shader->setEnvTarget(glslang::EshTargetSpv, glslang::EShTargetSpv_1_5);
+        request.stages.push_back({
+            stage.stage,
+            stage.inputFile,
+            std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()),
+        });
+    }
 
-    const TBuiltInResource* resources = GetDefaultResources();
+    request.includeResolver = FileIncludeResolver(args.workingDirectory, includeCache);
+    request.defines = defines;
+    request.optimizerOptions = args.optimizerOptions;
 
-    glslang::TShader::Includer* includer = new BasicIncluder;
+    std::optional<InputProgramCache> programCache;
+    if (cache) {
+        request.cache = &programCache.emplace(args, input, *cache);
+    }
 
-    if (!shader->parse(resources, 100, false, EShMsgDefault, *includer)) {
-        printf("Failed to parse shader!\n");
-        printf("%s", shader->getInfoLog());
-        return nullptr;
+    if (args.maxResidentBytes > 0) {
+        s_residentLimit.enter(args.maxResidentBytes);
     }
 
-    glslang::TProgram* program = new glslang::TProgram;
-    program->addShader(shader);
+    CompileResult compiled = compiler.compile(request);
 
-    if (!program->link(EShMsgDefault)) {
-        printf("Failed to link shader!\n");
-        printf("%s", program->getInfoLog());
-        return nullptr;
+    if (args.maxResidentBytes > 0) {
+        s_residentLimit.leave();
     }
 
-    if (!program->buildReflection()) {
-        printf("Failed to build reflection\n");
-        return nullptr;
+    if (!compiled.log.empty()) {
+        Print("%s", compiled.log.c_str());
     }
 
-    return program;
-}
+    // Collected whether or not the compile succeeded, so that a watch keeps watching the
+    // include that broke it.
+    AddFiles(result.includedFiles, compiled.includedFiles);
+    AddFiles(result.missingFiles, compiled.missingFiles);
 
-static const char* s_shaderHeaderPrelude = R"(#pragma once
-#include <stdint.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-)";
+    if (!compiled.success()) {
+        return false;
+    }
 
-static const char* s_shaderHeaderPostlude = R"(#ifdef __cplusplus
+    result.reflection = std::move(compiled.reflection);
+    return true;
 }
-#endif
-)";
-
-struct HeaderGenerator {
-    glslang::TProgram* program;
-
-    std::string structPrefix;
-    std::string globalPrefix;
-    std::string shaderName;
-    std::unordered_map<std::string, std::string> customTypeMap;
-    std::string extraPrelude;
-    EShLanguage stage;
-
-    HeaderGenerator(glslang::TProgram* program, const Args& args) : program(program) {
-        if (args.structPrefix) {
-            structPrefix = *args.structPrefix;
-        } else {
-            structPrefix = "";
-        }
 
-        if (args.globalPrefix) {
-            globalPrefix = *args.globalPrefix;
-        } else {
-            globalPrefix = "";
+// Combines the reflection of every compiled variant of a permuted input, so the header
+// declares each block, uniform and attribute that any variant uses. The first variant using
+// a name decides its type, with a warning if a later one disagrees.
+static ShaderReflection MergeVariantReflections(
+    const ShaderInput& input,
+    const std::vector<CompiledVariant>& variants
+) {
+    const PermutationSpec& spec = *input.permutations;
+    const char* fileName = input.stages[0].inputFile.c_str();
+
+    ShaderReflection merged;
+    std::unordered_map<std::string, uint32_t> firstVariants;
+    std::unordered_set<std::string> warned;
+    bool first = true;
+
+    auto merge = [&](std::vector<ReflectedObject>& into,
+                     const std::vector<ReflectedObject>& from,
+                     uint32_t variant) {
+        for (const ReflectedObject& object : from) {
+            auto it = std::find_if(into.begin(), into.end(), [&](const ReflectedObject& other) {
+                return other.name == object.name;
+            });
+
+            if (it == into.end()) {
+                into.push_back(object);
+                firstVariants.insert({ object.name, variant });
+            } else if (!(it->type == object.type) && warned.insert(object.name).second) {
+                Print(
+                    "%s: %s differs between variants %s and %s, the header uses the former\n",
+                    fileName,
+                    object.name.c_str(),
+                    spec.describe(firstVariants[object.name]).c_str(),
+                    spec.describe(variant).c_str()
+                );
+            }
         }
+    };
 
-        size_t lastSlash = args.inputFile.find_last_of("/\\");
+    for (uint32_t variant = 0; variant < variants.size(); variant++) {
+        if (!variants[variant].reflection) {
+            continue;
+        }
 
-        shaderName = args.inputFile.substr(lastSlash + 1, args.inputFile.size() - lastSlash - 1);
-        for (size_t i = 0; i < shaderName.size(); i++) {
-            if (shaderName[i] == '.' || shaderName[i] == '-') {
-                shaderName[i] = '_';
-                break;
+        const ShaderReflection& reflection = *variants[variant].reflection;
+        merge(merged.uniformBlocks, reflection.uniformBlocks, variant);
+        merge(merged.bufferBlocks, reflection.bufferBlocks, variant);
+        merge(merged.pipeInputs, reflection.pipeInputs, variant);
+        merge(merged.pipeOutputs, reflection.pipeOutputs, variant);
+        merge(merged.uniforms, reflection.uniforms, variant);
+
+        for (const BufferReferenceType& reference : reflection.bufferReferences) {
+            const std::string& name = reference.type.typeName;
+            auto it = std::find_if(
+                merged.bufferReferences.begin(),
+                merged.bufferReferences.end(),
+                [&](const BufferReferenceType& other) { return other.type.typeName == name; }
+            );
+            if (it == merged.bufferReferences.end()) {
+                merged.bufferReferences.push_back(reference);
+                firstVariants.insert({ name, variant });
+            } else if (!(*it == reference) && warned.insert(name).second) {
+                Print(
+                    "%s: %s differs between variants %s and %s, the header uses the former\n",
+                    fileName,
+                    name.c_str(),
+                    spec.describe(firstVariants[name]).c_str(),
+                    spec.describe(variant).c_str()
+                );
             }
         }
 
-        customTypeMap = args.customTypeMap;
-        extraPrelude = args.extraPrelude;
+        for (const SpecializationConstant& constant : reflection.specializationConstants) {
+            auto it = std::find_if(
+                merged.specializationConstants.begin(),
+                merged.specializationConstants.end(),
+                [&](const SpecializationConstant& other) { return other.id == constant.id; }
+            );
+            if (it == merged.specializationConstants.end()) {
+                merged.specializationConstants.push_back(constant);
+            } else if (!(*it == constant) && warned.insert(constant.name).second) {
+                Print(
+                    "%s: specialization constant %u differs between variants, the header "
+                    "uses the first\n",
+                    fileName,
+                    constant.id
+                );
+            }
+        }
 
-        stage = args.stage;
+        // Variants can pick their workgroup size with defines, but there is one set of
+        // dispatch constants per header. Shared memory is the most any variant needs.
+        bool sameSize =
+            std::equal(reflection.localSize, reflection.localSize + 3, merged.localSize);
+        if (first) {
+            std::copy_n(reflection.localSize, 3, merged.localSize);
+            std::copy_n(reflection.localSizeSpecIds, 3, merged.localSizeSpecIds);
+            // Every variant has the same stages. Generators that look at which stages the
+            // program has get those of the first variant; the header writes the SPIR-V of
+            // every variant from the variant table instead.
+            merged.stages = reflection.stages;
+            first = false;
+        } else if (!sameSize && warned.insert("workgroup size").second) {
+            Print(
+                "%s: workgroup size differs between variants, the header uses the first\n",
+                fileName
+            );
+        }
+        merged.sharedMemorySize =
+            std::max(merged.sharedMemorySize, reflection.sharedMemorySize);
     }
 
-    void generate(std::ofstream& outFile) {
-        outFile << s_shaderHeaderPrelude;
+    std::sort(
+        merged.specializationConstants.begin(),
+        merged.specializationConstants.end(),
+        [](const SpecializationConstant& a, const SpecializationConstant& b) {
+            return a.id < b.id;
+        }
+    );
 
-        if (!extraPrelude.empty()) {
-            outFile << extraPrelude;
+    std::sort(
+        merged.bufferReferences.begin(),
+        merged.bufferReferences.end(),
+        [](const BufferReferenceType& a, const BufferReferenceType& b) {
+            return a.type.typeName < b.type.typeName;
         }
+    );
 
-        outFile << "static const uint32_t " << globalPrefix << shaderName << "_spv[] = {\n";
+    return merged;
+}
 
-        glslang::TIntermediate* intermediate = program->getIntermediate(stage);
+// Collects the SPIR-V of every variant of a permuted input, keeping only one copy of each
+// distinct module. Excluded variants have no reflection and get no module.
+static VariantTable
+BuildVariantTable(const ShaderInput& input, const std::vector<CompiledVariant>& variants) {
+    VariantTable table;
 
-        if (!intermediate) {
-            printf("Failed to get intermediate for stage %d\n", stage);
-            return;
-        }
+    for (size_t i = 0; i < input.stages.size(); i++) {
+        VariantTable::Stage stage;
+        stage.stage = input.stages[i].stage;
 
-        std::vector<unsigned int> spirv;
-        glslang::GlslangToSpv(*intermediate, spirv);
+        std::unordered_map<uint64_t, std::vector<int>> modulesByHash;
 
-        for (size_t j = 0; j < spirv.size(); j++) {
-            if (j % 8 == 0) {
-                outFile << "    ";
-            }
-            outFile << spirv[j];
-            if (j != spirv.size() - 1) {
-                outFile << ",";
+        for (const CompiledVariant& variant : variants) {
+            if (!variant.reflection) {
+                stage.variantModules.push_back(-1);
+                continue;
             }
 
-            if (j % 8 == 7) {
-                outFile << "\n";
-            }
-        }
+            const ShaderStageBinary& binary = variant.reflection->stages[i];
 
-        outFile << "};\n";
+            Hasher hasher;
+            hasher.update(binary.spirv.data(), binary.spirv.size() * sizeof(uint32_t));
+            std::vector<int>& candidates = modulesByHash[hasher.digest()];
 
-        outFile << "static const size_t " << globalPrefix << shaderName
-                << "_spv_size = " << spirv.size() << ";\n";
+            auto it = std::find_if(candidates.begin(), candidates.end(), [&](int module) {
+                return stage.modules[module].spirv == binary.spirv;
+            });
 
-        outFile << "static const char* " << globalPrefix << shaderName << "_name = \""
-                << shaderName << "\";\n";
+            if (it != candidates.end()) {
+                stage.variantModules.push_back(*it);
+            } else {
+                int module = static_cast<int>(stage.modules.size());
+                candidates.push_back(module);
+                stage.variantModules.push_back(module);
+                stage.modules.push_back(binary);
+            }
+        }
 
-        std::unordered_set<std::string> handledUniforms;
-        std::unordered_map<std::string, const glslang::TType&> structsEncountered;
+        table.stages.push_back(std::move(stage));
+    }
 
-        // Gather uniform block info
-        for (int i = 0; i < program->getNumUniformBlocks(); i++) {
-            const glslang::TObjectReflection& uniformBlock = program->getUniformBlock(i);
+    return table;
+}
 
-            std::string uniformBlockName = uniformBlock.name;
+// Files included by any variant, in the order first included.
+static std::vector<std::string> IncludedFiles(const std::vector<CompiledVariant>& variants) {
+    std::vector<std::string> includedFiles;
+    for (const CompiledVariant& variant : variants) {
+        AddFiles(includedFiles, variant.includedFiles);
+    }
+    return includedFiles;
+}
 
-            const glslang::TType& blockType = *uniformBlock.getType();
+// Every file an input was compiled from: its stages, its permutation file, everything they
+// included and the includes that weren't found, relative to the working directory of the
+// arguments.
+static std::vector<std::string>
+InputDependencies(const ShaderInput& input, const std::vector<CompiledVariant>& variants) {
+    std::vector<std::string> files;
+    for (const ShaderStageInput& stage : input.stages) {
+        files.push_back(stage.inputFile);
+    }
+    if (input.permutationFile) {
+        files.push_back(*input.permutationFile);
+    }
+    for (std::string& includedFile : IncludedFiles(variants)) {
+        files.push_back(std::move(includedFile));
+    }
+    for (const CompiledVariant& variant : variants) {
+        AddFiles(files, variant.missingFiles);
+    }
+    return files;
+}
 
-            if (blockType.getBasicType() == glslang::EbtBlock) {
-                structsEncountered.insert({ uniformBlockName, blockType });
-                const glslang::TTypeList* members = blockType.getStruct();
+// The files an input was compiled from, for watching them.
+struct InputFileList {
+    // As InputDependencies lists them.
+    std::vector<std::string> files;
+    // Whether a variant failed to compile. It may have stopped before reaching every file it
+    // uses, so the files of the previous compile still count.
+    bool compileFailed = false;
+};
 
-                for (size_t j = 0; j < members->size(); j++) {
-                    std::string memberName = members->at(j).type->getFieldName().c_str();
-                    handledUniforms.insert(memberName);
+// Static cost of every entry point of an input, for each variant that isn't excluded.
+static std::vector<ShaderCost>
+InputCosts(const ShaderInput& input, const std::vector<CompiledVariant>& variants) {
+    PhaseTimer timer("cost", input.stages[0].inputFile.c_str());
 
-                    const glslang::TType& memberType = *members->at(j).type;
+    std::vector<ShaderCost> costs;
+    for (uint32_t variant = 0; variant < variants.size(); variant++) {
+        const std::optional<ShaderReflection>& reflection = variants[variant].reflection;
+        if (!reflection) {
+            continue;
+        }
 
-                    if (memberType.isStruct()) {
-                        structsEncountered.insert({ memberType.getTypeName().c_str(),
-                                                    memberType });
-                    }
+        for (const ShaderStageBinary& binary : reflection->stages) {
+            for (ShaderCost& cost : AnalyzeCost(binary.spirv, binary.stage, *reflection)) {
+                cost.shader = ShaderName(input);
+                if (input.permutations) {
+                    cost.variant = input.permutations->describe(variant);
                 }
+                costs.push_back(std::move(cost));
             }
+        }
+    }
+    return costs;
+}
 
-            outFile << "#define SLOT_" << shaderName << "_" << uniformBlockName << " "
-                    << uniformBlock.getBinding() << "\n";
+// Adds the header of an input, and any other files, to outputs once all its variants are
+// compiled, its modules to packModules with SpirvFormat::Pack and the padding analysis of its
+// blocks to layoutAdvice with a layout report. variants is indexed by
+// variant, and has a single entry if the input isn't permuted. Returns false if any variant
+// that isn't excluded failed.
+static bool GenerateOutputs(
+    const Args& args,
+    const ShaderInput& input,
+    const std::vector<CompiledVariant>& variants,
+    std::vector<OutputFile>& outputs,
+    std::vector<PackModule>& packModules,
+    std::vector<LayoutAdvice>& layoutAdvice
+) {
+    const char* fileName = input.stages[0].inputFile.c_str();
+
+    for (uint32_t variant = 0; variant < variants.size(); variant++) {
+        bool excluded = input.permutations && input.permutations->isExcluded(variant);
+        if (!excluded && !variants[variant].reflection) {
+            return false;
         }
+    }
 
-        // Gather buffer block info
-        for (int i = 0; i < program->getNumBufferBlocks(); i++) {
-            const glslang::TObjectReflection& bufferBlock = program->getBufferBlock(i);
+    std::optional<ShaderReflection> merged;
+    std::optional<VariantTable> table;
+    if (input.permutations) {
+        PhaseTimer timer("variants", fileName);
+        merged = MergeVariantReflections(input, variants);
+        table = BuildVariantTable(input, variants);
+    }
 
-            std::string bufferBlockName = bufferBlock.name;
+    const ShaderReflection& reflection = merged ? *merged : *variants[0].reflection;
 
-            const glslang::TType& blockType = *bufferBlock.getType();
+    std::stringstream outFile;
 
-            if (blockType.getBasicType() == glslang::EbtBlock) {
-                structsEncountered.insert({ bufferBlockName, blockType });
-                const glslang::TTypeList* members = blockType.getStruct();
+    {
+        PhaseTimer timer("generate", fileName);
 
-                for (size_t j = 0; j < members->size(); j++) {
-                    std::string memberName = members->at(j).type->getFieldName().c_str();
-                    if (bufferBlock.name.empty()) {
-                        handledUniforms.insert(memberName);
-                    } else {
-                        handledUniforms.insert(bufferBlockName + "." + memberName);
-                    }
+        HeaderExtras extras;
+        extras.packModules = &packModules;
+        if (args.layoutReportFile) {
+            extras.layoutAdvice = &layoutAdvice;
+        }
 
-                    const glslang::TType& memberType = *members->at(j).type;
+        if (!GenerateHeader(
+                reflection,
+                args.headerOptions(),
+                input,
+                table ? &*table : nullptr,
+                extras,
+                outFile
+            )) {
+            return false;
+        }
 
-                    if (memberType.isStruct()) {
-                        structsEncountered.insert({ memberType.getTypeName().c_str(),
-                                                    memberType });
-                    }
+        // Inputs with no block to reorder get no include, not an empty one.
+        if (args.reorderBlocks && !extras.layoutInclude.empty()) {
+            outputs.push_back({ LayoutIncludePath(input), std::move(extras.layoutInclude) });
+        }
+    }
+
+    if (args.spirvFormat == SpirvFormat::Embed) {
+        auto addSpirvFile = [&](const std::string& path, const std::vector<uint32_t>& spirv) {
+            std::string spirvBytes(
+                reinterpret_cast<const char*>(spirv.data()),
+                spirv.size() * sizeof(uint32_t)
+            );
+            outputs.push_back({ path, spirvBytes });
+        };
+
+        if (table) {
+            for (const VariantTable::Stage& stage : table->stages) {
+                for (size_t i = 0; i < stage.modules.size(); i++) {
+                    addSpirvFile(
+                        SpirvSidecarPath(input, stage.stage, i),
+                        stage.modules[i].spirv
+                    );
                 }
             }
-            outFile << "#define SLOT_" << shaderName << "_" << bufferBlockName << " "
-                    << bufferBlock.getBinding() << "\n";
+        } else {
+            for (const ShaderStageBinary& binary : reflection.stages) {
+                addSpirvFile(SpirvSidecarPath(input, binary.stage), binary.spirv);
+            }
         }
+    }
+
+    outputs.push_back({ input.outputFile, outFile.str() });
+
+    if (input.depFile) {
+        outputs.push_back({ *input.depFile, GenerateDepFile(input, IncludedFiles(variants)) });
+    }
+
+    return true;
+}
+
+static size_t CompileInputs(
+    const Compiler& compiler,
+    const Args& args,
+    IncludeCache* includeCache,
+    std::vector<OutputFile>& outputs,
+    std::vector<InputFileList>* inputDependencies = nullptr
+);
+
+// Compiles every input again, bypassing the compile cache and with a different number of
+// worker threads, and checks that each output matches the first compile byte for byte, so
+// the outputs are safe to cache remotely. Prints the first difference in each output that
+// doesn't match.
+static bool VerifyDeterminism(
+    const Compiler& compiler,
+    const Args& args,
+    IncludeCache* includeCache,
+    const std::vector<OutputFile>& outputs
+) {
+    Args again = args;
+    again.verifyDeterminism = false;
+    again.cacheDir.reset();
+    again.cacheStats = false;
+    again.timeReport.reset();
+    again.jobs = args.jobs > 1 ? 1 : std::max(std::thread::hardware_concurrency(), 2u);
+
+    // Diagnostics were already printed by the first compile.
+    std::vector<OutputFile> againOutputs;
+    {
+        OutputCapture capture;
+        ScopedOutputCapture scopedCapture(&capture);
+        CompileInputs(compiler, again, includeCache, againOutputs);
+    }
+
+    std::unordered_map<std::string, const std::string*> againContents;
+    for (const OutputFile& output : againOutputs) {
+        againContents[output.path] = &output.contents;
+    }
 
-        // Generate location and binding defines
-        for (int i = 0; i < program->getNumPipeInputs(); i++) {
-            const glslang::TObjectReflection& input = program->getPipeInput(i);
+    bool deterministic = true;
+    for (const OutputFile& output : outputs) {
+        // The time report is expected to change.
+        if (args.timeReportFile && output.path == *args.timeReportFile) {
+            continue;
+        }
 
-            outFile << "#define ATTR_" << shaderName << "_" << input.name << " "
-                    << input.layoutLocation() << "\n";
+        auto it = againContents.find(output.path);
+        if (it == againContents.end()) {
+            Print("%s: only written by the first compile\n", output.path.c_str());
+            deterministic = false;
+            continue;
         }
 
-        for (int i = 0; i < program->getNumPipeOutputs(); i++) {
-            const glslang::TObjectReflection& output = program->getPipeOutput(i);
+        const std::string& first = output.contents;
+        const std::string& second = *it->second;
+        if (first == second) {
+            continue;
+        }
 
-            outFile << "#define ATTR_" << shaderName << "_" << output.name << " "
-                    << output.layoutLocation() << "\n";
+        size_t offset = 0;
+        while (offset < first.size() && offset < second.size() &&
+               first[offset] == second[offset]) {
+            offset++;
         }
+        Print(
+            "%s: differs between two compiles, first at byte %zu\n",
+            output.path.c_str(),
+            offset
+        );
+        deterministic = false;
+    }
 
-        for (int i = 0; i < program->getNumUniformVariables(); i++) {
-            const glslang::TObjectReflection& uniform = program->getUniform(i);
+    // Both compiles ran in the same directory, so an output that depends on where the tree is
+    // checked out looks deterministic. Look for the usual cause, an absolute path made from
+    // relative arguments. Depfiles name the inputs as given and are left out.
+    bool relativeInputs = true;
+    std::unordered_set<std::string> depFiles;
+    for (const ShaderInput& input : args.inputs) {
+        for (const ShaderStageInput& stage : input.stages) {
+            relativeInputs &= std::filesystem::path(stage.inputFile).is_relative();
+        }
+        if (input.depFile) {
+            depFiles.insert(*input.depFile);
+        }
+    }
 
-            if (handledUniforms.find(uniform.name) != handledUniforms.end()) {
+    std::error_code error;
+    std::string directory = std::filesystem::absolute(args.resolvePath("."), error)
+                                .lexically_normal()
+                                .parent_path()
+                                .string();
+    if (relativeInputs && !error && directory.size() > 1) {
+        for (const OutputFile& output : outputs) {
+            if (depFiles.count(output.path) ||
+                (args.timeReportFile && output.path == *args.timeReportFile)) {
                 continue;
             }
 
-            outFile << "#define SLOT_" << shaderName << "_" << uniform.name << " "
-                    << uniform.getBinding() << "\n";
+            if (output.contents.find(directory) != std::string::npos) {
+                Print(
+                    "%s: contains the working directory %s, so it depends on where it's "
+                    "generated\n",
+                    output.path.c_str(),
+                    directory.c_str()
+                );
+                deterministic = false;
+            }
+        }
+    }
+
+    return deterministic;
+}
+
+// Compiles every input on a pool of args.jobs worker threads. Returns the number of inputs
+// that failed. Outputs are collected in input order rather than written. inputDependencies,
+// if given, receives the files each input was compiled from, see InputDependencies.
+static size_t CompileInputs(
+    const Compiler& compiler,
+    const Args& args,
+    IncludeCache* includeCache,
+    std::vector<OutputFile>& outputs,
+    std::vector<InputFileList>* inputDependencies
+) {
+    std::optional<CompileCache> cache;
+    if (args.cacheDir) {
+        cache.emplace(args.resolvePath(*args.cacheDir), args.cacheSize);
+    }
 
-            const glslang::TType& type = *uniform.getType();
+    std::vector<std::vector<OutputFile>> inputOutputs(args.inputs.size());
+    std::vector<std::vector<PackModule>> inputPackModules(args.inputs.size());
+    std::vector<std::vector<LayoutAdvice>> inputLayoutAdvice(args.inputs.size());
+    std::vector<std::vector<ShaderCost>> inputCosts(args.inputs.size());
+    if (inputDependencies) {
+        inputDependencies->assign(args.inputs.size(), {});
+    }
 
-            if (type.getBasicType() == glslang::EbtStruct) {
-                structsEncountered.insert({ uniform.name, type });
+    // Every variant of every input is a separate work item, so the variants of a permuted
+    // input compile concurrently. Whichever worker finishes the last variant of an input
+    // generates its outputs.
+    struct WorkItem {
+        size_t input;
+        uint32_t variant;
+    };
+
+    std::vector<WorkItem> items;
+    std::vector<std::vector<CompiledVariant>> inputVariants(args.inputs.size());
+    std::vector<std::atomic<size_t>> remainingVariants(args.inputs.size());
+    std::vector<std::atomic<bool>> compileFailed(args.inputs.size());
+
+    std::atomic<size_t> failedInputs = 0;
+
+    for (size_t i = 0; i < args.inputs.size(); i++) {
+        const std::optional<PermutationSpec>& permutations = args.inputs[i].permutations;
+        uint32_t variantCount = permutations ? permutations->variantCount() : 1;
+
+        inputVariants[i].resize(variantCount);
+        for (uint32_t variant = 0; variant < variantCount; variant++) {
+            if (!permutations || !permutations->isExcluded(variant)) {
+                items.push_back({ i, variant });
+                remainingVariants[i]++;
             }
         }
 
-        for (auto& [uniformBlockName, uniformBlock] : structsEncountered) {
-            outFile << "typedef struct " << structPrefix << shaderName << "_"
-                    << uniformBlockName << " " << structPrefix << uniformBlockName << ";\n";
+        // No worker would ever finish the input, so it would silently produce nothing.
+        if (remainingVariants[i] == 0) {
+            Print(
+                "%s: every variant is excluded, nothing to compile\n",
+                args.inputs[i].stages[0].inputFile.c_str()
+            );
+            failedInputs++;
         }
+    }
 
-        for (auto& [uniformBlockName, uniformBlock] : structsEncountered) {
-            generateStruct(uniformBlockName, uniformBlock, outFile);
-        }
+    std::atomic<size_t> nextItem = 0;
 
-        outFile << s_shaderHeaderPostlude;
+    std::optional<TimeReport> timeReport;
+    if (args.timeReport) {
+        timeReport.emplace();
     }
 
-    std::string getTypeGlslName(const glslang::TType& type) {
-        std::string typeName;
-        if (type.getBasicType() == glslang::EbtStruct) {
-            typeName = type.getTypeName().c_str();
-            return typeName;
+    // Workers print to wherever the calling thread prints, e.g. a server request's capture.
+    OutputCapture* capture = CurrentOutputCapture();
+
+    auto worker = [&]() {
+        ScopedOutputCapture scopedCapture(capture);
+        ScopedTimeReport scopedReport(timeReport ? &*timeReport : nullptr);
+
+        for (size_t i = nextItem++; i < items.size(); i = nextItem++) {
+            size_t inputIndex = items[i].input;
+            uint32_t variant = items[i].variant;
+            const ShaderInput& input = args.inputs[inputIndex];
+            std::vector<CompiledVariant>& variants = inputVariants[inputIndex];
+
+            if (!CompileProgram(
+                    compiler,
+                    args,
+                    input,
+                    VariantDefines(input, variant),
+                    cache ? &*cache : nullptr,
+                    includeCache,
+                    variants[variant]
+                )) {
+                compileFailed[inputIndex] = true;
+                if (input.permutations) {
+                    Print(
+                        "%s: failed to compile variant %s\n",
+                        input.stages[0].inputFile.c_str(),
+                        input.permutations->describe(variant).c_str()
+                    );
+                }
+            }
+
+            if (--remainingVariants[inputIndex] == 0) {
+                if (inputDependencies) {
+                    (*inputDependencies)[inputIndex] = {
+                        InputDependencies(input, variants),
+                        compileFailed[inputIndex],
+                    };
+                }
+
+                if (!GenerateOutputs(
+                        args,
+                        input,
+                        variants,
+                        inputOutputs[inputIndex],
+                        inputPackModules[inputIndex],
+                        inputLayoutAdvice[inputIndex]
+                    )) {
+                    failedInputs++;
+                } else if (args.costReportFile || !args.costLimits.empty()) {
+                    inputCosts[inputIndex] = InputCosts(input, variants);
+                    if (!CheckCostLimits(inputCosts[inputIndex], args.costLimits)) {
+                        failedInputs++;
+                    }
+                }
+                variants.clear();
+            }
         }
-        switch (type.getBasicType()) {
-            case glslang::EbtFloat:
-                typeName = "float";
-                break;
-            case glslang::EbtInt:
-                typeName = "int";
-                break;
-            case glslang::EbtUint:
-                typeName = "uint";
-                break;
-            case glslang::EbtBool:
-                typeName = "bool";
-                break;
-            case glslang::EbtStruct:
-                typeName = structPrefix + type.getTypeName().c_str();
-                break;
-            default:
-                return "unknown";
+    };
+
+    size_t workerCount = std::min<size_t>(args.jobs, items.size());
+    if (workerCount <= 1) {
+        worker();
+    } else {
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < workerCount; i++) {
+            workers.emplace_back(worker);
         }
 
-        if (type.isVector()) {
-            if (typeName == "float") {
-                typeName = "vec";
-            }
-            typeName += std::to_string(type.getVectorSize());
-        } else if (type.isArray()) {
-            if (type.isSizedArray()) {
-                typeName += "[" + std::to_string(type.getOuterArraySize()) + "]";
-            } else {
-                typeName += "[]";
-            }
-        } else if (type.isMatrix()) {
-            if (typeName == "float") {
-                typeName = "mat";
-            }
-            if (type.getMatrixCols() != type.getMatrixRows()) {
-                typeName += std::to_string(type.getMatrixCols()) + "x" +
-                            std::to_string(type.getMatrixRows());
-            } else {
-                typeName += std::to_string(type.getMatrixCols());
-            }
+        for (std::thread& thread : workers) {
+            thread.join();
         }
+    }
 
-        return typeName;
-    }
-
-    int sizeOfType(const glslang::TType& type) {
-        int size = 0;
-        switch (type.getBasicType()) {
-            case glslang::EbtFloat:
-                size = 4;
-                break;
-            case glslang::EbtInt:
-                size = 4;
-                break;
-            case glslang::EbtUint:
-                size = 4;
-                break;
-            case glslang::EbtBool:
-                size = 4;
-                break;
-            case glslang::EbtStruct: {
-                size = 0;
-                const glslang::TTypeList* members = type.getStruct();
-                for (size_t j = 0; j < members->size(); j++) {
-                    size += sizeOfType(*members->at(j).type);
-                }
-                break;
+    for (std::vector<OutputFile>& files : inputOutputs) {
+        for (OutputFile& file : files) {
+            outputs.push_back(std::move(file));
+        }
+    }
+
+    if (args.packFile) {
+        std::vector<PackModule> packModules;
+        for (std::vector<PackModule>& modules : inputPackModules) {
+            for (PackModule& module : modules) {
+                packModules.push_back(std::move(module));
             }
-            default:
-                size = 0;
         }
 
-        if (type.isVector()) {
-            size *= type.getVectorSize();
-        } else if (type.isArray()) {
-            if (type.isSizedArray()) {
-                size *= type.getOuterArraySize();
+        std::optional<std::string> pack = BuildPack(packModules);
+        if (pack) {
+            outputs.push_back({ *args.packFile, std::move(*pack) });
+            outputs.push_back({ *args.packHeaderFile, GeneratePackHeader(packModules) });
+        } else {
+            // Without a pack none of the headers are usable.
+            failedInputs = args.inputs.size();
+        }
+    }
+
+    if (args.layoutReportFile) {
+        std::vector<LayoutAdvice> layoutAdvice;
+        for (std::vector<LayoutAdvice>& advice : inputLayoutAdvice) {
+            for (LayoutAdvice& block : advice) {
+                layoutAdvice.push_back(std::move(block));
             }
-        } else if (type.isMatrix()) {
-            size *= type.getMatrixCols() * type.getMatrixRows();
-        }
-
-        return size;
-    }
-
-    int getsPaddedTo(const glslang::TType& type) {
-        int padding = 0;
-        switch (type.getBasicType()) {
-            case glslang::EbtFloat:
-                padding = 4;
-                break;
-            case glslang::EbtInt:
-                padding = 4;
-                break;
-            case glslang::EbtUint:
-                padding = 4;
-                break;
-            case glslang::EbtBool:
-                padding = 4;
-                break;
-            case glslang::EbtStruct: {
-                padding = 0;
-                const glslang::TTypeList* members = type.getStruct();
-                for (size_t j = 0; j < members->size(); j++) {
-                    padding += getsPaddedTo(*members->at(j).type);
-                }
-                break;
+        }
+
+        outputs.push_back({ *args.layoutReportFile, FormatLayoutReport(layoutAdvice) });
+    }
+
+    if (args.costReportFile) {
+        std::vector<ShaderCost> costs;
+        for (std::vector<ShaderCost>& entryPoints : inputCosts) {
+            for (ShaderCost& cost : entryPoints) {
+                costs.push_back(std::move(cost));
             }
-            default:
-                padding = 0;
         }
 
-        if (type.isVector()) {
-            if (type.getVectorSize() == 3) {
-                padding = 16;
+        // The baseline is read before any output is written, so it can be the report itself.
+        std::optional<std::vector<ShaderCost>> baseline;
+        if (args.costBaselineFile) {
+            std::shared_ptr<const std::string> report =
+                ReadFileShared(args.resolvePath(*args.costBaselineFile));
+            if (report) {
+                baseline = ParseCostReport(*report, *args.costBaselineFile);
             } else {
-                padding *= type.getVectorSize();
+                Print("Failed to open cost baseline %s\n", args.costBaselineFile->c_str());
+            }
+            if (!baseline) {
+                failedInputs = args.inputs.size();
             }
-        } else if (type.isMatrix()) {
-            padding = 16;
         }
 
-        return padding;
+        outputs.push_back(
+            { *args.costReportFile, FormatCostReport(costs, baseline ? &*baseline : nullptr) }
+        );
     }
 
-    void generateStruct(
-        const std::string& structName,
-        const glslang::TType& structType,
-        std::ofstream& outFile
-    ) {
-        const glslang::TTypeList* members = structType.getStruct();
+    // Outputs that change from one compile to the next can't be trusted by build caches, so
+    // the whole run fails.
+    if (args.verifyDeterminism && failedInputs == 0 &&
+        !VerifyDeterminism(compiler, args, includeCache, outputs)) {
+        failedInputs = args.inputs.size();
+    }
 
-        outFile << "/// Struct for " << structName << "\n";
-        std::stringstream structString;
-        structString << "{\n";
+    if (cache) {
+        cache->evict();
 
-        int sizeSoFar = 0;
-        int paddingCounter = 0;
-        int maxPadding = 0;
+        if (args.cacheStats) {
+            cache->printStats();
+        }
+    }
 
-        for (size_t j = 0; j < members->size(); j++) {
-            const glslang::TType& memberType = *members->at(j).type;
+    if (timeReport) {
+        std::string report = timeReport->format(*args.timeReport);
+        if (args.timeReportFile) {
+            outputs.push_back({ *args.timeReportFile, report });
+        } else {
+            Print("%s", report.c_str());
+        }
+    }
+
+    if (failedInputs > 0 && args.inputs.size() > 1) {
+        Print("%zu of %zu shaders failed\n", failedInputs.load(), args.inputs.size());
+    }
 
-            std::string memberName = members->at(j).type->getFieldName().c_str();
-            std::string typeString = getFieldString(memberType, memberName);
+    return failedInputs;
+}
 
-            int padding = getsPaddedTo(memberType);
-            if (padding > maxPadding) {
-                maxPadding = padding;
-            }
+// Writes contents to path, unless the file already has exactly that content. Leaving the file
+// untouched keeps its timestamp, so build systems don't rebuild everything that includes it.
+// The new content is written to a temporary file and renamed into place, so readers never
+// see a partially written file.
+static bool WriteFileIfChanged(const std::string& path, const std::string& contents) {
+    std::ifstream existingFile(path, std::ios::binary);
+    if (existingFile.is_open()) {
+        std::string existing(std::istreambuf_iterator<char>(existingFile), {});
+        if (existing == contents) {
+            return true;
+        }
+    }
+    existingFile.close();
+
+    size_t threadId = std::hash<std::thread::id>()(std::this_thread::get_id());
+    std::string tempPath =
+        path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(threadId);
+
+    std::ofstream outFile(tempPath, std::ios::binary);
+    if (!outFile.is_open()) {
+        Print("Failed to open output file %s\n", tempPath.c_str());
+        return false;
+    }
+
+    outFile.write(contents.data(), contents.size());
+    outFile.close();
+
+    std::error_code error;
+    if (outFile.fail()) {
+        Print("Failed to write output file %s\n", tempPath.c_str());
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        Print("Failed to write output file %s: %s\n", path.c_str(), error.message().c_str());
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    return true;
+}
 
-            if (sizeSoFar % padding != 0) {
-                int paddingNeeded = padding - (sizeSoFar % padding);
-                structString << "    uint8_t _padding" << paddingCounter++ << "["
-                             << paddingNeeded << "];\n";
-                sizeSoFar += paddingNeeded;
+static bool WriteOutputs(const std::vector<OutputFile>& outputs) {
+    bool success = true;
+    for (const OutputFile& output : outputs) {
+        success &= WriteFileIfChanged(output.path, output.contents);
+    }
+    return success;
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+static ServerResponse
+HandleServerRequest(
+    const Compiler& compiler,
+    const ServerRequest& request,
+    IncludeCache& includeCache
+) {
+    OutputCapture capture;
+    ServerResponse response;
+
+    {
+        ScopedOutputCapture scopedCapture(&capture);
+
+        std::vector<std::string> args = request.args;
+        std::vector<char*> argv;
+        for (std::string& arg : args) {
+            argv.push_back(arg.data());
+        }
+        argv.push_back(nullptr);
+
+        try {
+            Args parsedArgs(
+                static_cast<int>(argv.size() - 1),
+                argv.data(),
+                request.workingDirectory
+            );
+            if (parsedArgs.watch) {
+                Print("--watch can't be used with --client\n");
+                throw ArgsExit { 1 };
             }
 
-            structString << "    " << typeString << ";\n";
+            size_t failedInputs =
+                CompileInputs(compiler, parsedArgs, &includeCache, response.outputs);
+            response.exitCode = failedInputs > 0 ? 1 : 0;
+        } catch (const ArgsExit& exit) {
+            response.exitCode = exit.code;
+        }
+    }
+
+    response.output = std::move(capture.text);
+    return response;
+}
+
+// How long changes have to stop arriving for before recompiling, so that a burst of saves,
+// such as an editor writing a file and then renaming it into place, compiles once.
+static const std::chrono::milliseconds s_watchDebounce(20);
+
+// Recompiles the inputs affected by each change to the files they were compiled from, and
+// writes their outputs, until the process is interrupted. dependencies has the files of each
+// input as of the first compile. Only returns if watching fails, with the exit code to use.
+static int Watch(
+    const Compiler& compiler,
+    Args& args,
+    IncludeCache& includeCache,
+    const std::vector<InputFileList>& dependencies
+) {
+    FileWatcher watcher;
+    if (!watcher.valid()) {
+        return 1;
+    }
+
+    // Which inputs use each file, and which files each input uses, both by WatchKey. Rebuilt
+    // for every input that is recompiled, as its includes may have changed.
+    std::unordered_map<std::string, std::set<size_t>> dependents;
+    std::vector<std::vector<std::string>> inputFiles(args.inputs.size());
 
-            sizeSoFar += sizeOfType(memberType);
+    auto track = [&](size_t input, const InputFileList& list) {
+        std::vector<std::string> previous;
+        if (list.compileFailed) {
+            previous = inputFiles[input];
         }
 
-        bool lastElementIsUnboundedArray =
-            members->size() > 0 && members->at(members->size() - 1).type->isArray() &&
-            !members->at(members->size() - 1).type->isSizedArray();
+        for (const std::string& file : inputFiles[input]) {
+            dependents[file].erase(input);
+        }
 
-        if (sizeSoFar % maxPadding != 0 && !lastElementIsUnboundedArray) {
-            int paddingNeeded = maxPadding - (sizeSoFar % maxPadding);
-            structString << "    uint8_t _padding" << paddingCounter++ << "[" << paddingNeeded
-                         << "];\n";
-            sizeSoFar += paddingNeeded;
+        inputFiles[input].clear();
+        for (const std::string& file : list.files) {
+            std::string key = WatchKey(args.resolvePath(file).string());
+            if (watcher.watch(key)) {
+                dependents[key].insert(input);
+                inputFiles[input].push_back(key);
+            }
         }
 
-        structString << "}";
+        // Already watched.
+        for (const std::string& key : previous) {
+            dependents[key].insert(input);
+            AddFiles(inputFiles[input], { key });
+        }
+    };
 
-        outFile << "typedef struct " << structPrefix << shaderName << "_" << structName << " "
-                << structString.str() << " " << structPrefix << shaderName << "_" << structName
-                << ";\n";
+    for (size_t i = 0; i < args.inputs.size(); i++) {
+        track(i, dependencies[i]);
     }
 
-    std::string getFieldString(const glslang::TType& type, const std::string& name) {
-        if (customTypeMap.find(getTypeGlslName(type)) != customTypeMap.end()) {
-            return customTypeMap[getTypeGlslName(type)] + " " + name;
+    Print("Watching %zu files for changes\n", dependents.size());
+
+    while (true) {
+        std::chrono::steady_clock::time_point firstChange;
+        std::vector<std::string> changed = watcher.wait(s_watchDebounce, firstChange);
+        if (changed.empty()) {
+            return 1;
         }
-        std::string fieldString;
-        switch (type.getBasicType()) {
-            case glslang::EbtFloat:
-                fieldString = "float";
-                break;
-            case glslang::EbtInt:
-                fieldString = "int";
-                break;
-            case glslang::EbtUint:
-                fieldString = "uint";
-                break;
-            case glslang::EbtBool:
-                fieldString = "bool";
-                break;
-            case glslang::EbtStruct:
-                fieldString = structPrefix + type.getTypeName().c_str();
-                break;
-            default:
-                return "unknown";
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::set<size_t> affected;
+        for (const std::string& file : changed) {
+            auto it = dependents.find(file);
+            if (it != dependents.end()) {
+                affected.insert(it->second.begin(), it->second.end());
+            }
         }
 
-        if (type.isVector()) {
-            fieldString += " " + name + "[" + std::to_string(type.getVectorSize()) + "]";
-        } else if (type.isArray()) {
-            if (type.isSizedArray()) {
-                fieldString +=
-                    " " + name + "[" + std::to_string(type.getOuterArraySize()) + "]";
-            } else {
-                fieldString += " " + name + "[]";
+        // Permutation files are read along with the arguments, so changed ones are read again.
+        // Inputs keep their previous permutations if that fails.
+        for (size_t i : affected) {
+            ShaderInput& input = args.inputs[i];
+            if (!input.permutationFile) {
+                continue;
+            }
+
+            std::filesystem::path path = args.resolvePath(*input.permutationFile);
+            if (std::find(changed.begin(), changed.end(), WatchKey(path.string())) !=
+                changed.end()) {
+                std::optional<PermutationSpec> permutations =
+                    ReadPermutationSpec(path, *input.permutationFile);
+                if (permutations) {
+                    input.permutations = std::move(permutations);
+                }
             }
-        } else if (type.isMatrix()) {
-            fieldString += " " + name + "[" + std::to_string(type.getMatrixCols()) + "]";
-        } else {
-            fieldString += " " + name;
         }
 
-        return fieldString;
+        // A pack or a report covers every input, so any change rebuilds all of them.
+        std::vector<size_t> recompiled(affected.begin(), affected.end());
+        bool wholeRunOutput = args.packFile || args.layoutReportFile || args.costReportFile;
+        if (!recompiled.empty() && wholeRunOutput) {
+            recompiled.clear();
+            for (size_t i = 0; i < args.inputs.size(); i++) {
+                recompiled.push_back(i);
+            }
+        }
+
+        if (recompiled.empty()) {
+            continue;
+        }
+
+        Args subset = args;
+        subset.inputs.clear();
+        for (size_t i : recompiled) {
+            subset.inputs.push_back(args.inputs[i]);
+        }
+
+        std::vector<OutputFile> outputs;
+        std::vector<InputFileList> subsetDependencies;
+        size_t failedInputs =
+            CompileInputs(compiler, subset, &includeCache, outputs, &subsetDependencies);
+        WriteOutputs(outputs);
+
+        for (size_t i = 0; i < recompiled.size(); i++) {
+            track(recompiled[i], subsetDependencies[i]);
+        }
+
+        // The latency from the first change to written outputs includes the debounce.
+        Print(
+            "Recompiled %zu of %zu shaders in %.2f ms, %.2f ms after the change%s\n",
+            recompiled.size(),
+            args.inputs.size(),
+            MillisecondsSince(start),
+            MillisecondsSince(firstChange),
+            failedInputs > 0 ? ", with errors" : ""
+        );
     }
-};
+}
 
 int main(int argc, char* argv[]) {
-    Args args(argc, argv);
+    auto start = std::chrono::steady_clock::now();
+
+    // --server, --client and --verify-pack change how the rest of the command line is handled,
+    // so they are picked out before the regular arguments are parsed.
+    std::optional<std::string> serverSocket;
+    std::optional<std::string> clientSocket;
+    std::optional<std::string> verifyPack;
+    std::vector<char*> forwardedArgs = { argv[0] };
+    bool timing = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if ((arg == "--server" || arg == "--client") && i + 1 < argc) {
+            (arg == "--server" ? serverSocket : clientSocket) = argv[++i];
+            continue;
+        }
 
-    glslang::InitializeProcess();
+        if (arg == "--verify-pack" && i + 1 < argc) {
+            verifyPack = argv[++i];
+            continue;
+        }
 
-    std::ifstream file(args.inputFile);
-    if (!file.is_open()) {
-        printf("Failed to open file %s\n", args.inputFile.c_str());
-        return 1;
+        timing |= arg == "--timing";
+        forwardedArgs.push_back(argv[i]);
     }
+    forwardedArgs.push_back(nullptr);
 
-    g_FirstPath = args.inputFile;
+    if (verifyPack) {
+        return VerifyPack(*verifyPack) ? 0 : 1;
+    }
 
-    std::string shaderSource(std::istreambuf_iterator<char>(file), {});
+    if (serverSocket) {
+        Compiler compiler;
 
-    glslang::TProgram* program =
-        CompileShader(shaderSource.c_str(), args.inputFile.c_str(), args.stage);
-    if (!program) {
-        return 1;
+        IncludeCache includeCache;
+        return RunServer(*serverSocket, [&](const ServerRequest& request) {
+            return HandleServerRequest(compiler, request, includeCache);
+        });
     }
 
-    std::ofstream outFile(args.outputFile);
-    if (!outFile.is_open()) {
-        printf("Failed to open output file %s\n", args.outputFile.c_str());
-        return 1;
+    if (clientSocket) {
+        ServerRequest request;
+        request.workingDirectory = std::filesystem::current_path().string();
+        request.args.assign(forwardedArgs.begin(), forwardedArgs.end() - 1);
+
+        std::optional<ServerResponse> response = SendRequest(*clientSocket, request);
+        if (response) {
+            fputs(response->output.c_str(), stdout);
+
+            int exitCode = response->exitCode;
+            if (!WriteOutputs(response->outputs)) {
+                exitCode = 1;
+            }
+
+            if (timing) {
+                Print(
+                    "Request took %.2f ms, %.2f ms in the server\n",
+                    MillisecondsSince(start),
+                    response->serverMicroseconds / 1000.0
+                );
+            }
+
+            return exitCode;
+        }
+
+        fprintf(stderr, "No server on %s, compiling locally\n", clientSocket->c_str());
     }
 
-    HeaderGenerator headerGen(program, args);
+    std::optional<Args> args;
+    try {
+        args.emplace(static_cast<int>(forwardedArgs.size() - 1), forwardedArgs.data());
+    } catch (const ArgsExit& exit) {
+        return exit.code;
+    }
 
-    headerGen.generate(outFile);
+    Compiler compiler;
 
-    outFile.close();
+    // Watching keeps include contents in memory between compiles.
+    std::optional<IncludeCache> includeCache;
+    if (args->watch) {
+        includeCache.emplace();
+    }
 
-    delete program;
+    std::vector<OutputFile> outputs;
+    std::vector<InputFileList> dependencies;
+    size_t failedInputs = CompileInputs(
+        compiler,
+        *args,
+        includeCache ? &*includeCache : nullptr,
+        outputs,
+        args->watch ? &dependencies : nullptr
+    );
+
+    bool written = WriteOutputs(outputs);
+
+    if (args->timing) {
+        Print(
+            "Compiled %zu shaders in %.2f ms\n",
+            args->inputs.size(),
+            MillisecondsSince(start)
+        );
+    }
 
-    glslang::FinalizeProcess();
+    if (args->watch) {
+        return Watch(compiler, *args, *includeCache, dependencies);
+    }
 
-    return 0;
+    return failedInputs > 0 || !written ? 1 : 0;
 }
@@ -0,0 +1,158 @@
+#include "optimizer.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <unordered_set>
+
+#ifdef GLSLOP_ENABLE_OPT
+#include <spirv-tools/libspirv.hpp>
+#include <spirv-tools/optimizer.hpp>
+
+// Must match the Vulkan version the shaders are compiled for in CompileShader.
+static const spv_target_env s_targetEnv = SPV_ENV_VULKAN_1_2;
+
+bool OptimizerAvailable() {
+    return true;
+}
+
+// Collects SPIRV-Tools diagnostics into messages, one indented line each.
+static spvtools::MessageConsumer MessageCollector(std::string& messages) {
+    return [&messages](
+               spv_message_level_t,
+               const char*,
+               const spv_position_t& position,
+               const char* message
+           ) {
+        messages += "  " + std::to_string(position.index) + ": " + message + "\n";
+    };
+}
+
+static void RegisterLevelPasses(spvtools::Optimizer& optimizer, OptimizationLevel level) {
+    if (level == OptimizationLevel::Performance) {
+        optimizer.RegisterPerformancePasses();
+    } else if (level == OptimizationLevel::Size) {
+        optimizer.RegisterSizePasses();
+    }
+}
+
+bool OptimizeSpirv(
+    std::vector<uint32_t>& spirv,
+    const OptimizerOptions& options,
+    const char* fileName
+) {
+    std::string messages;
+    spvtools::MessageConsumer consumer = MessageCollector(messages);
+
+    if (options.level != OptimizationLevel::None || options.stripDebugInfo) {
+        spvtools::Optimizer optimizer(s_targetEnv);
+        optimizer.SetMessageConsumer(consumer);
+
+        RegisterLevelPasses(optimizer, options.level);
+
+        if (options.stripDebugInfo) {
+            optimizer.RegisterPass(spvtools::CreateStripDebugInfoPass());
+        }
+
+        // The input comes straight from glslang, so only the final module is validated, by
+        // ValidateSpirv.
+        spvtools::OptimizerOptions optimizerOptions;
+        optimizerOptions.set_run_validator(false);
+
+        std::vector<uint32_t> optimized;
+        if (!optimizer.Run(spirv.data(), spirv.size(), &optimized, optimizerOptions)) {
+            Print("%s: failed to optimize SPIR-V\n%s", fileName, messages.c_str());
+            return false;
+        }
+
+        spirv = std::move(optimized);
+    }
+
+    return true;
+}
+
+bool ValidateSpirv(const std::vector<uint32_t>& spirv, const char* fileName) {
+    std::string messages;
+    spvtools::SpirvTools tools(s_targetEnv);
+    tools.SetMessageConsumer(MessageCollector(messages));
+
+    if (!tools.Validate(spirv)) {
+        Print("%s: SPIR-V failed validation\n%s", fileName, messages.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool EliminateDeadStageOutputs(
+    std::vector<uint32_t>& producer,
+    const std::vector<uint32_t>& consumer,
+    const OptimizerOptions& options,
+    const char* fileName
+) {
+    std::string messages;
+
+    spvtools::OptimizerOptions optimizerOptions;
+    optimizerOptions.set_run_validator(false);
+
+    // The analysis pass only records which input locations and builtins the consumer
+    // reads. The module it produces is identical to its input and is thrown away.
+    std::unordered_set<uint32_t> liveLocations;
+    std::unordered_set<uint32_t> liveBuiltins;
+    {
+        spvtools::Optimizer analyzer(s_targetEnv);
+        analyzer.SetMessageConsumer(MessageCollector(messages));
+        analyzer.RegisterPass(
+            spvtools::CreateAnalyzeLiveInputPass(&liveLocations, &liveBuiltins)
+        );
+
+        std::vector<uint32_t> unused;
+        if (!analyzer.Run(consumer.data(), consumer.size(), &unused, optimizerOptions)) {
+            Print("%s: failed to analyze stage inputs\n%s", fileName, messages.c_str());
+            return false;
+        }
+    }
+
+    spvtools::Optimizer optimizer(s_targetEnv);
+    optimizer.SetMessageConsumer(MessageCollector(messages));
+    optimizer.RegisterPass(
+        spvtools::CreateEliminateDeadOutputStoresPass(&liveLocations, &liveBuiltins)
+    );
+    RegisterLevelPasses(optimizer, options.level);
+
+    std::vector<uint32_t> optimized;
+    if (!optimizer.Run(producer.data(), producer.size(), &optimized, optimizerOptions)) {
+        Print("%s: failed to remove dead stage outputs\n%s", fileName, messages.c_str());
+        return false;
+    }
+
+    producer = std::move(optimized);
+    return true;
+}
+
+#else
+
+bool OptimizerAvailable() {
+    return false;
+}
+
+bool OptimizeSpirv(std::vector<uint32_t>&, const OptimizerOptions&, const char* fileName) {
+    Print("%s: glslop was built without SPIRV-Tools, can't optimize or validate\n", fileName);
+    return false;
+}
+
+bool ValidateSpirv(const std::vector<uint32_t>&, const char* fileName) {
+    Print("%s: glslop was built without SPIRV-Tools, can't optimize or validate\n", fileName);
+    return false;
+}
+
+bool EliminateDeadStageOutputs(
+    std::vector<uint32_t>&,
+    const std::vector<uint32_t>&,
+    const OptimizerOptions&,
+    const char* fileName
+) {
+    Print("%s: glslop was built without SPIRV-Tools, can't optimize or validate\n", fileName);
+    return false;
+}
+
+#endif
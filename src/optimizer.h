@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+enum class OptimizationLevel {
+    None,
+    // spirv-opt -O
+    Performance,
+    // spirv-opt -Os
+    Size,
+};
+
+struct OptimizerOptions {
+    OptimizationLevel level = OptimizationLevel::None;
+    // Strip OpName, OpSource, OpLine and other debug instructions.
+    bool stripDebugInfo = false;
+    // Run the SPIR-V validator on the final module.
+    bool validate = false;
+
+    bool enabled() const {
+        return level != OptimizationLevel::None || stripDebugInfo || validate;
+    }
+
+    // Whether the modules come out different from how glslang generated them. Validating
+    // alone leaves them as they are.
+    bool changesSpirv() const {
+        return level != OptimizationLevel::None || stripDebugInfo;
+    }
+};
+
+// Whether glslop was built with SPIRV-Tools, and can therefore optimize and validate.
+bool OptimizerAvailable();
+
+// Optimizes a module in place with SPIRV-Tools, if options ask for any optimization.
+// Diagnostics are printed prefixed with fileName. Returns false if the module is rejected.
+bool OptimizeSpirv(
+    std::vector<uint32_t>& spirv,
+    const OptimizerOptions& options,
+    const char* fileName
+);
+
+// Runs the SPIR-V validator on a module, printing why it's invalid prefixed with fileName.
+// Run on the final module, after every other transformation.
+bool ValidateSpirv(const std::vector<uint32_t>& spirv, const char* fileName);
+
+// Removes stores to outputs of producer that consumer, the next stage of the same linked
+// program, never reads, then runs the optimization passes on producer again so the code
+// computing them goes too. Only needed when options.level isn't None.
+bool EliminateDeadStageOutputs(
+    std::vector<uint32_t>& producer,
+    const std::vector<uint32_t>& consumer,
+    const OptimizerOptions& options,
+    const char* fileName
+);
@@ -0,0 +1,414 @@
+#include "pack.h"
+#include "hash.h"
+#include "log.h"
+#include "reflection.h"
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <string.h>
+
+// Bump whenever the layout changes. Readers reject packs of any other version.
+static const uint32_t s_packFormatVersion = 1;
+
+static const char s_packMagic[8] = { 'G', 'L', 'S', 'L', 'O', 'P', 'P', 'K' };
+
+static const size_t s_packBlobAlignment = 16;
+
+static const uint32_t s_spirvMagic = 0x07230203;
+
+// Mirrors glslop_pack_header in the generated header.
+struct PackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint64_t entriesOffset;
+    uint64_t fileSize;
+};
+
+// Mirrors glslop_pack_entry in the generated header.
+struct PackEntry {
+    uint64_t nameHash;
+    // FNV-1a of the SPIR-V bytes.
+    uint64_t contentHash;
+    uint64_t spirvOffset;
+    // In bytes, as vkCreateShaderModule takes it.
+    uint64_t spirvSize;
+    uint64_t reflectionOffset;
+    uint32_t reflectionSize;
+    // VkShaderStageFlagBits.
+    uint32_t stage;
+    uint64_t nameOffset;
+};
+
+static_assert(sizeof(PackHeader) == 32, "pack header layout");
+static_assert(sizeof(PackEntry) == 56, "pack entry layout");
+
+static const char* s_packHeaderPrelude = R"(#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef GLSLOP_PACK_FORMAT_DEFINED
+#define GLSLOP_PACK_FORMAT_DEFINED
+)";
+
+// Follows the GLSLOP_PACK_MAGIC and GLSLOP_PACK_VERSION defines, which GeneratePackHeader
+// writes from the values BuildPack uses.
+static const char* s_packFormatDefinition = R"(
+/// Starts every pack. Integers are little-endian and offsets are from the start of the pack.
+typedef struct glslop_pack_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_count;
+    uint64_t entries_offset;
+    uint64_t file_size;
+} glslop_pack_header;
+
+/// One SPIR-V module. Entries are sorted by name_hash.
+typedef struct glslop_pack_entry {
+    uint64_t name_hash;
+    uint64_t content_hash;
+    uint64_t spirv_offset;
+    /// In bytes, as vkCreateShaderModule takes it.
+    uint64_t spirv_size;
+    /// Reflection of the program the module belongs to, in glslop's own serialization, the
+    /// one its compile cache uses. It has a version of its own and there is no C decoder for
+    /// it: C code gets layouts and bindings from the generated shader headers instead, and
+    /// tools linked with glslop read it with DeserializeReflection.
+    uint64_t reflection_offset;
+    uint32_t reflection_size;
+    /// VkShaderStageFlagBits
+    uint32_t stage;
+    /// NUL-terminated module name.
+    uint64_t name_offset;
+} glslop_pack_entry;
+
+/// The name hash modules are looked up by: 64-bit FNV-1a.
+static inline uint64_t glslop_pack_hash(const char* name) {
+    uint64_t hash = UINT64_C(14695981039346656037);
+    for (; *name; name++) {
+        hash ^= (uint8_t)*name;
+        hash *= UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+/// Returns the entries of a pack and their count, or NULL if data isn't a pack of
+/// GLSLOP_PACK_VERSION. data must be aligned to at least 8 bytes, as mmap'd memory is.
+static inline const glslop_pack_entry*
+glslop_pack_entries(const void* data, size_t size, uint32_t* count) {
+    const glslop_pack_header* header = (const glslop_pack_header*)data;
+    if (size < sizeof(glslop_pack_header) || memcmp(header->magic, GLSLOP_PACK_MAGIC, 8) != 0 ||
+        header->version != GLSLOP_PACK_VERSION || header->file_size != size ||
+        header->entries_offset > size ||
+        (size - header->entries_offset) / sizeof(glslop_pack_entry) < header->entry_count) {
+        return NULL;
+    }
+    *count = header->entry_count;
+    return (const glslop_pack_entry*)((const uint8_t*)data + header->entries_offset);
+}
+
+/// Finds a module by name hash, or returns NULL if the pack is invalid or has no such module.
+static inline const glslop_pack_entry*
+glslop_pack_find(const void* data, size_t size, uint64_t name_hash) {
+    uint32_t count = 0;
+    const glslop_pack_entry* entries = glslop_pack_entries(data, size, &count);
+    uint32_t low = 0;
+    uint32_t high = count;
+    while (entries && low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (entries[middle].name_hash < name_hash) {
+            low = middle + 1;
+        } else if (entries[middle].name_hash > name_hash) {
+            high = middle;
+        } else {
+            return &entries[middle];
+        }
+    }
+    return NULL;
+}
+
+/// The words of a module, to pass to vkCreateShaderModule with entry->spirv_size.
+static inline const uint32_t*
+glslop_pack_spirv(const void* data, const glslop_pack_entry* entry) {
+    return (const uint32_t*)((const uint8_t*)data + entry->spirv_offset);
+}
+
+/// The name of a module.
+static inline const char* glslop_pack_name(const void* data, const glslop_pack_entry* entry) {
+    return (const char*)data + entry->name_offset;
+}
+
+#endif
+)";
+
+static const char* s_packHeaderPostlude = R"(#ifdef __cplusplus
+}
+#endif
+)";
+
+uint64_t PackNameHash(const std::string& name) {
+    Hasher hasher;
+    hasher.update(name.data(), name.size());
+    return hasher.digest();
+}
+
+static uint64_t ContentHash(const void* data, size_t size) {
+    Hasher hasher;
+    hasher.update(data, size);
+    return hasher.digest();
+}
+
+static void AlignTo(std::string& data, size_t alignment) {
+    data.resize((data.size() + alignment - 1) / alignment * alignment, '\0');
+}
+
+std::optional<std::string> BuildPack(const std::vector<PackModule>& modules) {
+    std::vector<size_t> order(modules.size());
+    std::vector<uint64_t> nameHashes;
+    for (size_t i = 0; i < modules.size(); i++) {
+        order[i] = i;
+        nameHashes.push_back(PackNameHash(modules[i].name));
+    }
+
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return nameHashes[a] < nameHashes[b];
+    });
+
+    for (size_t i = 1; i < order.size(); i++) {
+        const PackModule& previous = modules[order[i - 1]];
+        const PackModule& current = modules[order[i]];
+        if (previous.name == current.name) {
+            Print("Two shaders in the pack are named %s\n", current.name.c_str());
+            return std::nullopt;
+        } else if (nameHashes[order[i - 1]] == nameHashes[order[i]]) {
+            Print(
+                "The names %s and %s have the same hash, rename one of them\n",
+                previous.name.c_str(),
+                current.name.c_str()
+            );
+            return std::nullopt;
+        }
+    }
+
+    PackHeader header = {};
+    memcpy(header.magic, s_packMagic, sizeof(s_packMagic));
+    header.version = s_packFormatVersion;
+    header.entryCount = static_cast<uint32_t>(modules.size());
+    header.entriesOffset = sizeof(PackHeader);
+
+    std::string data(sizeof(PackHeader) + sizeof(PackEntry) * modules.size(), '\0');
+    std::vector<PackEntry> entries(modules.size());
+
+    // Blobs already written, by content hash, to find duplicates.
+    std::unordered_map<uint64_t, std::vector<std::pair<uint64_t, size_t>>> blobs;
+
+    auto addBlob = [&](const void* bytes, size_t size, uint64_t hash) -> uint64_t {
+        for (auto [offset, blobSize] : blobs[hash]) {
+            if (blobSize == size && memcmp(data.data() + offset, bytes, size) == 0) {
+                return offset;
+            }
+        }
+
+        AlignTo(data, s_packBlobAlignment);
+        uint64_t offset = data.size();
+        data.append(static_cast<const char*>(bytes), size);
+        blobs[hash].push_back({ offset, size });
+        return offset;
+    };
+
+    for (size_t i = 0; i < order.size(); i++) {
+        const PackModule& module = modules[order[i]];
+        PackEntry& entry = entries[i];
+
+        size_t spirvSize = module.spirv.size() * sizeof(uint32_t);
+        entry.nameHash = nameHashes[order[i]];
+        entry.contentHash = ContentHash(module.spirv.data(), spirvSize);
+        entry.spirvOffset = addBlob(module.spirv.data(), spirvSize, entry.contentHash);
+        entry.spirvSize = spirvSize;
+        entry.reflectionOffset = addBlob(
+            module.reflection.data(),
+            module.reflection.size(),
+            ContentHash(module.reflection.data(), module.reflection.size())
+        );
+        entry.reflectionSize = static_cast<uint32_t>(module.reflection.size());
+        entry.stage = VulkanStageFlag(module.stage);
+    }
+
+    for (size_t i = 0; i < order.size(); i++) {
+        const std::string& name = modules[order[i]].name;
+        entries[i].nameOffset = data.size();
+        data.append(name.c_str(), name.size() + 1);
+    }
+
+    AlignTo(data, s_packBlobAlignment);
+    header.fileSize = data.size();
+
+    memcpy(data.data(), &header, sizeof(header));
+    memcpy(data.data() + sizeof(header), entries.data(), sizeof(PackEntry) * entries.size());
+
+    return data;
+}
+
+std::string GeneratePackHeader(const std::vector<PackModule>& modules) {
+    std::string header = s_packHeaderPrelude;
+    header += "#define GLSLOP_PACK_MAGIC \"" + std::string(s_packMagic, sizeof(s_packMagic)) +
+              "\"\n";
+    header += "#define GLSLOP_PACK_VERSION " + std::to_string(s_packFormatVersion) + "\n";
+    header += s_packFormatDefinition;
+
+    header += "\n/// Name hashes of the modules in the pack\n";
+    for (const PackModule& module : modules) {
+        header += "#define GLSLOP_PACK_KEY_" + module.name + " UINT64_C(0x" +
+                  HashToString(PackNameHash(module.name)) + ")\n";
+    }
+
+    header += s_packHeaderPostlude;
+    return header;
+}
+
+// Whether [offset, offset + size) lies within a file of fileSize bytes.
+static bool InBounds(uint64_t offset, uint64_t size, uint64_t fileSize) {
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+bool VerifyPack(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        Print("Failed to open pack %s\n", path.c_str());
+        return false;
+    }
+
+    std::string data(std::istreambuf_iterator<char>(file), {});
+
+    PackHeader header = {};
+    if (data.size() < sizeof(header)) {
+        Print("%s: too small to be a pack\n", path.c_str());
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+
+    if (memcmp(header.magic, s_packMagic, sizeof(s_packMagic)) != 0) {
+        Print("%s: not a pack\n", path.c_str());
+        return false;
+    }
+
+    if (header.version != s_packFormatVersion) {
+        Print(
+            "%s: pack format version %u, expected %u\n",
+            path.c_str(),
+            header.version,
+            s_packFormatVersion
+        );
+        return false;
+    }
+
+    if (header.fileSize != data.size()) {
+        Print(
+            "%s: header says %llu bytes, file has %zu\n",
+            path.c_str(),
+            static_cast<unsigned long long>(header.fileSize),
+            data.size()
+        );
+        return false;
+    }
+
+    if (header.entriesOffset % 8 != 0 ||
+        !InBounds(
+            header.entriesOffset,
+            static_cast<uint64_t>(header.entryCount) * sizeof(PackEntry),
+            data.size()
+        )) {
+        Print("%s: entries out of bounds\n", path.c_str());
+        return false;
+    }
+
+    std::vector<PackEntry> entries(header.entryCount);
+    memcpy(
+        entries.data(),
+        data.data() + header.entriesOffset,
+        sizeof(PackEntry) * entries.size()
+    );
+
+    size_t errors = 0;
+    std::unordered_set<uint64_t> distinctSpirv;
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        const PackEntry& entry = entries[i];
+
+        auto error = [&](const char* message) {
+            Print("%s: entry %zu: %s\n", path.c_str(), i, message);
+            errors++;
+        };
+
+        if (i > 0 && entries[i - 1].nameHash >= entry.nameHash) {
+            error("not sorted by name hash");
+        }
+
+        const char* name = nullptr;
+        if (entry.nameOffset >= data.size() ||
+            memchr(data.data() + entry.nameOffset, '\0', data.size() - entry.nameOffset) ==
+                nullptr) {
+            error("name out of bounds");
+        } else {
+            name = data.data() + entry.nameOffset;
+            if (PackNameHash(name) != entry.nameHash) {
+                error("name doesn't match its hash");
+            }
+        }
+
+        if (entry.spirvOffset % s_packBlobAlignment != 0 || entry.spirvSize % 4 != 0 ||
+            entry.spirvSize < 5 * sizeof(uint32_t) ||
+            !InBounds(entry.spirvOffset, entry.spirvSize, data.size())) {
+            error("SPIR-V out of bounds or misaligned");
+        } else {
+            const char* spirv = data.data() + entry.spirvOffset;
+
+            uint32_t magic = 0;
+            memcpy(&magic, spirv, sizeof(magic));
+            if (magic != s_spirvMagic) {
+                error("SPIR-V has the wrong magic number");
+            }
+
+            if (ContentHash(spirv, entry.spirvSize) != entry.contentHash) {
+                error("SPIR-V doesn't match its content hash");
+            }
+
+            distinctSpirv.insert(entry.spirvOffset);
+        }
+
+        // Exactly one of the vertex to compute stage bits.
+        if (entry.stage == 0 || entry.stage > 0x20 || (entry.stage & (entry.stage - 1)) != 0) {
+            error("invalid stage");
+        }
+
+        if (!InBounds(entry.reflectionOffset, entry.reflectionSize, data.size()) ||
+            !DeserializeReflection(
+                std::string_view(data).substr(entry.reflectionOffset, entry.reflectionSize)
+            )) {
+            error("reflection is invalid");
+        }
+    }
+
+    if (errors > 0) {
+        Print("%s: %zu errors\n", path.c_str(), errors);
+        return false;
+    }
+
+    Print(
+        "%s: version %u, %u modules, %zu distinct, %zu bytes, OK\n",
+        path.c_str(),
+        header.version,
+        header.entryCount,
+        distinctSpirv.size(),
+        data.size()
+    );
+    return true;
+}
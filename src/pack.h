@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glslang/Public/ShaderLang.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+// A pack is a single file holding the SPIR-V of every shader of a run, laid out so it can be
+// memory-mapped and the words passed straight to vkCreateShaderModule:
+//
+//   header       magic, format version, entry count, offset of the entries, file size
+//   entries      one per module, sorted by name hash for binary search
+//   blobs        SPIR-V and serialized reflection, each aligned to 16 bytes and stored once
+//                however many modules share it. Reflection is in SerializeReflection's
+//                format, which only glslop itself decodes.
+//   names        NUL-terminated module names
+//
+// All integers are little-endian and all offsets are from the start of the file. The layout
+// is described to C by GeneratePackHeader.
+
+// One module to write into a pack.
+struct PackModule {
+    // Name the module is looked up by, the symbol its array would otherwise have.
+    std::string name;
+    EShLanguage stage;
+    std::vector<uint32_t> spirv;
+    // SerializeReflection of the program the module belongs to, without its SPIR-V.
+    std::string reflection;
+};
+
+// Key modules are looked up by: 64-bit FNV-1a of the name.
+uint64_t PackNameHash(const std::string& name);
+
+// Builds a pack of modules. Prints why and returns std::nullopt if two modules have the same
+// name or name hash.
+std::optional<std::string> BuildPack(const std::vector<PackModule>& modules);
+
+// Generates the C header for reading packs, with a key define for each of modules.
+std::string GeneratePackHeader(const std::vector<PackModule>& modules);
+
+// Checks that a pack file is well formed: its version, that every offset is in bounds and
+// aligned, names match their hashes, SPIR-V matches its content hash and reflection
+// deserializes. Prints any problems and a summary. Returns true if the pack is valid.
+bool VerifyPack(const std::string& path);
@@ -0,0 +1,165 @@
+#include "permutation.h"
+#include "log.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+// 65536 variants is already far more than is practical to compile into one header.
+static const size_t s_maxAxes = 16;
+
+bool PermutationSpec::isExcluded(uint32_t variant) const {
+    for (const Exclusion& exclusion : exclusions) {
+        if ((variant & exclusion.mask) == exclusion.value) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string PermutationSpec::defines(uint32_t variant) const {
+    std::string result;
+    for (size_t i = 0; i < axes.size(); i++) {
+        if (variant & (1u << i)) {
+            result += "#define " + axes[i] + " 1\n";
+        }
+    }
+    return result;
+}
+
+std::string PermutationSpec::describe(uint32_t variant) const {
+    std::string result;
+    for (size_t i = 0; i < axes.size(); i++) {
+        if (variant & (1u << i)) {
+            result += (result.empty() ? "" : "|") + axes[i];
+        }
+    }
+    return result.empty() ? "none" : result;
+}
+
+static bool IsIdentifier(const std::string& name) {
+    if (name.empty() || (name[0] >= '0' && name[0] <= '9')) {
+        return false;
+    }
+
+    for (char c : name) {
+        bool alphanumeric =
+            (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        if (!alphanumeric && c != '_') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::optional<PermutationSpec>
+ReadPermutationSpec(const std::filesystem::path& path, const std::string& fileName) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        Print("Failed to open permutation file %s\n", fileName.c_str());
+        return std::nullopt;
+    }
+
+    PermutationSpec spec;
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+
+        std::istringstream lineStream(line);
+        std::vector<std::string> words;
+        for (std::string word; lineStream >> word;) {
+            words.push_back(word);
+        }
+
+        if (words.empty() || words[0][0] == '#') {
+            continue;
+        }
+
+        if (words[0] == "axis") {
+            if (words.size() != 2 || !IsIdentifier(words[1])) {
+                Print("%s:%d: expected axis <NAME>\n", fileName.c_str(), lineNumber);
+                return std::nullopt;
+            }
+
+            if (std::find(spec.axes.begin(), spec.axes.end(), words[1]) != spec.axes.end()) {
+                Print(
+                    "%s:%d: axis %s is already defined\n",
+                    fileName.c_str(),
+                    lineNumber,
+                    words[1].c_str()
+                );
+                return std::nullopt;
+            }
+
+            if (spec.axes.size() == s_maxAxes) {
+                Print(
+                    "%s:%d: at most %zu axes are supported\n",
+                    fileName.c_str(),
+                    lineNumber,
+                    s_maxAxes
+                );
+                return std::nullopt;
+            }
+
+            spec.axes.push_back(words[1]);
+        } else if (words[0] == "exclude") {
+            if (words.size() < 2) {
+                Print("%s:%d: expected exclude <term>...\n", fileName.c_str(), lineNumber);
+                return std::nullopt;
+            }
+
+            PermutationSpec::Exclusion exclusion = { 0, 0 };
+            for (size_t i = 1; i < words.size(); i++) {
+                bool negated = words[i][0] == '!';
+                std::string axis = negated ? words[i].substr(1) : words[i];
+
+                auto it = std::find(spec.axes.begin(), spec.axes.end(), axis);
+                if (it == spec.axes.end()) {
+                    Print(
+                        "%s:%d: unknown axis %s\n",
+                        fileName.c_str(),
+                        lineNumber,
+                        axis.c_str()
+                    );
+                    return std::nullopt;
+                }
+
+                uint32_t bit = 1u << (it - spec.axes.begin());
+                exclusion.mask |= bit;
+                if (!negated) {
+                    exclusion.value |= bit;
+                }
+            }
+
+            spec.exclusions.push_back(exclusion);
+        } else {
+            Print(
+                "%s:%d: unknown directive %s\n",
+                fileName.c_str(),
+                lineNumber,
+                words[0].c_str()
+            );
+            return std::nullopt;
+        }
+    }
+
+    if (spec.axes.empty()) {
+        Print("%s: no axes defined\n", fileName.c_str());
+        return std::nullopt;
+    }
+
+    bool anyIncluded = false;
+    for (uint32_t variant = 0; variant < spec.variantCount() && !anyIncluded; variant++) {
+        anyIncluded = !spec.isExcluded(variant);
+    }
+
+    if (!anyIncluded) {
+        Print("%s: every variant is excluded\n", fileName.c_str());
+        return std::nullopt;
+    }
+
+    return spec;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+// A matrix of shader variants to compile from one source. Every axis is a define that is
+// either set or not, and one bit of the variant index: with axes A, B and C, variant 5 is
+// compiled with A and C defined.
+struct PermutationSpec {
+    // Variants whose bits under mask equal value are not compiled.
+    struct Exclusion {
+        uint32_t mask;
+        uint32_t value;
+    };
+
+    std::vector<std::string> axes;
+    std::vector<Exclusion> exclusions;
+
+    uint32_t variantCount() const {
+        return 1u << axes.size();
+    }
+
+    bool isExcluded(uint32_t variant) const;
+
+    // #define lines for the axes set in variant, to append to the shader preamble.
+    std::string defines(uint32_t variant) const;
+
+    // The axes set in variant joined with '|', or "none", for diagnostics and comments.
+    std::string describe(uint32_t variant) const;
+};
+
+// Reads a permutation spec. Every non-empty line not starting with '#' is one of:
+//
+//   axis <NAME>            adds a define axis, the first being bit 0
+//   exclude <term>...      skips variants matching every term, where a term is an axis
+//                          name (set) or !<NAME> (not set)
+//
+// Prints why and returns std::nullopt if the file can't be read or is invalid.
+std::optional<PermutationSpec>
+ReadPermutationSpec(const std::filesystem::path& path, const std::string& fileName);
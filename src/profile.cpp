@@ -0,0 +1,383 @@
+#include "profile.h"
+#include "json.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <sstream>
+
+#include <stdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#define GLSLOP_HAVE_MALLINFO2 1
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+static thread_local TimeReport* t_timeReport = nullptr;
+
+// Small sequential thread numbers read better in a trace viewer than native thread ids.
+static std::atomic<uint32_t> s_nextThreadNumber = 1;
+static thread_local uint32_t t_threadNumber = 0;
+
+static uint32_t CurrentThreadNumber() {
+    if (t_threadNumber == 0) {
+        t_threadNumber = s_nextThreadNumber++;
+    }
+    return t_threadNumber;
+}
+
+int64_t HeapBytesInUse() {
+#if defined(GLSLOP_HAVE_MALLINFO2)
+    struct mallinfo2 info = mallinfo2();
+    return static_cast<int64_t>(info.uordblks + info.hblkhd);
+#elif defined(__APPLE__)
+    malloc_statistics_t statistics;
+    malloc_zone_statistics(nullptr, &statistics);
+    return static_cast<int64_t>(statistics.size_in_use);
+#else
+    return 0;
+#endif
+}
+
+int64_t PeakResidentBytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return static_cast<int64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+int64_t ResidentBytes() {
+#if defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(
+            mach_task_self(),
+            MACH_TASK_BASIC_INFO,
+            reinterpret_cast<task_info_t>(&info),
+            &count
+        ) != KERN_SUCCESS) {
+        return 0;
+    }
+    return static_cast<int64_t>(info.resident_size);
+#else
+    // The second field of statm is the resident set, in pages.
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm) {
+        return 0;
+    }
+    long pages = 0;
+    int read = fscanf(statm, "%*s %ld", &pages);
+    fclose(statm);
+    return read == 1 ? static_cast<int64_t>(pages) * sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+void ReleaseFreeHeap() {
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
+
+TimeReport::TimeReport() : start(std::chrono::steady_clock::now()) {}
+
+void TimeReport::record(PhaseEvent event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(std::move(event));
+}
+
+int64_t TimeReport::now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start
+    )
+        .count();
+}
+
+std::string TimeReport::format(TimeReportFormat format) const {
+    switch (format) {
+        case TimeReportFormat::Text:
+            return formatText();
+        case TimeReportFormat::Json:
+            return formatJson();
+        case TimeReportFormat::Trace:
+            return formatTrace();
+    }
+    return "";
+}
+
+struct PhaseSummary {
+    std::string phase;
+    size_t count = 0;
+    int64_t totalMicroseconds = 0;
+    int64_t maxMicroseconds = 0;
+    int64_t maxHeapDelta = 0;
+};
+
+struct ShaderSummary {
+    std::string shader;
+    // Phase name to total microseconds, in the order phases were first seen.
+    std::vector<std::pair<std::string, int64_t>> phases;
+    // Most process-wide heap in use at the end of any phase of the shader. Not a peak, see
+    // PhaseEvent::heapBytes.
+    int64_t maxPhaseEndHeapBytes = 0;
+};
+
+// Sums events up per phase and per shader, in the order each was first started.
+static void Summarize(
+    std::vector<PhaseEvent> events,
+    std::vector<PhaseSummary>& phases,
+    std::vector<ShaderSummary>& shaders
+) {
+    std::stable_sort(
+        events.begin(),
+        events.end(),
+        [](const PhaseEvent& a, const PhaseEvent& b) {
+            return a.startMicroseconds < b.startMicroseconds;
+        }
+    );
+
+    std::map<std::string, size_t> phaseIndices;
+    std::map<std::string, size_t> shaderIndices;
+
+    for (const PhaseEvent& event : events) {
+        auto [phaseIt, newPhase] = phaseIndices.try_emplace(event.phase, phases.size());
+        if (newPhase) {
+            phases.push_back({ event.phase });
+        }
+
+        PhaseSummary& phase = phases[phaseIt->second];
+        phase.count++;
+        phase.totalMicroseconds += event.durationMicroseconds;
+        phase.maxMicroseconds = std::max(phase.maxMicroseconds, event.durationMicroseconds);
+        phase.maxHeapDelta = std::max(phase.maxHeapDelta, event.heapDelta);
+
+        auto [shaderIt, newShader] = shaderIndices.try_emplace(event.shader, shaders.size());
+        if (newShader) {
+            shaders.push_back({ event.shader, {} });
+        }
+
+        ShaderSummary& shader = shaders[shaderIt->second];
+        shader.maxPhaseEndHeapBytes = std::max(shader.maxPhaseEndHeapBytes, event.heapBytes);
+        auto shaderPhase = std::find_if(
+            shader.phases.begin(),
+            shader.phases.end(),
+            [&](const std::pair<std::string, int64_t>& entry) {
+                return entry.first == event.phase;
+            }
+        );
+        if (shaderPhase == shader.phases.end()) {
+            shader.phases.push_back({ event.phase, event.durationMicroseconds });
+        } else {
+            shaderPhase->second += event.durationMicroseconds;
+        }
+    }
+}
+
+std::string TimeReport::formatText() const {
+    std::vector<PhaseSummary> phases;
+    std::vector<ShaderSummary> shaders;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Summarize(events, phases, shaders);
+    }
+
+    std::string text;
+    char line[256];
+
+    snprintf(
+        line,
+        sizeof(line),
+        "Time report, peak RSS %.1f MB\n"
+        "Heap is sampled process-wide as phases start and end: net growth, not peaks\n"
+        "%-12s %6s %12s %10s %16s\n",
+        PeakResidentBytes() / (1024.0 * 1024.0),
+        "Phase",
+        "Count",
+        "Total ms",
+        "Max ms",
+        "Max net heap KB"
+    );
+    text += line;
+
+    for (const PhaseSummary& phase : phases) {
+        snprintf(
+            line,
+            sizeof(line),
+            "%-12s %6zu %12.2f %10.2f %16.1f\n",
+            phase.phase.c_str(),
+            phase.count,
+            phase.totalMicroseconds / 1000.0,
+            phase.maxMicroseconds / 1000.0,
+            phase.maxHeapDelta / 1024.0
+        );
+        text += line;
+    }
+
+    text += "Per shader (ms, process heap at phase end KB, max):\n";
+    for (const ShaderSummary& shader : shaders) {
+        text += "  " + shader.shader + ":";
+        for (const auto& [phase, microseconds] : shader.phases) {
+            snprintf(line, sizeof(line), " %s %.2f", phase.c_str(), microseconds / 1000.0);
+            text += line;
+        }
+        snprintf(
+            line,
+            sizeof(line),
+            ", heap at phase end %.1f\n",
+            shader.maxPhaseEndHeapBytes / 1024.0
+        );
+        text += line;
+    }
+
+    return text;
+}
+
+std::string TimeReport::formatJson() const {
+    std::vector<PhaseEvent> sortedEvents;
+    std::vector<PhaseSummary> phases;
+    std::vector<ShaderSummary> shaders;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sortedEvents = events;
+        Summarize(events, phases, shaders);
+    }
+
+    std::stringstream json;
+    json << "{\n";
+    json << "  \"peakResidentBytes\": " << PeakResidentBytes() << ",\n";
+
+    json << "  \"phases\": [";
+    for (size_t i = 0; i < phases.size(); i++) {
+        const PhaseSummary& phase = phases[i];
+        json << (i == 0 ? "\n" : ",\n") << "    { \"phase\": " << JsonString(phase.phase)
+             << ", \"count\": " << phase.count
+             << ", \"totalMicroseconds\": " << phase.totalMicroseconds
+             << ", \"maxMicroseconds\": " << phase.maxMicroseconds
+             << ", \"maxHeapDelta\": " << phase.maxHeapDelta << " }";
+    }
+    json << "\n  ],\n";
+
+    json << "  \"shaders\": [";
+    for (size_t i = 0; i < shaders.size(); i++) {
+        const ShaderSummary& shader = shaders[i];
+        json << (i == 0 ? "\n" : ",\n") << "    { \"shader\": " << JsonString(shader.shader)
+             << ", \"phases\": {";
+        for (size_t j = 0; j < shader.phases.size(); j++) {
+            json << (j == 0 ? " " : ", ") << JsonString(shader.phases[j].first) << ": "
+                 << shader.phases[j].second;
+        }
+        json << " }, \"maxPhaseEndHeapBytes\": " << shader.maxPhaseEndHeapBytes << " }";
+    }
+    json << "\n  ],\n";
+
+    std::stable_sort(
+        sortedEvents.begin(),
+        sortedEvents.end(),
+        [](const PhaseEvent& a, const PhaseEvent& b) {
+            return a.startMicroseconds < b.startMicroseconds;
+        }
+    );
+
+    json << "  \"events\": [";
+    for (size_t i = 0; i < sortedEvents.size(); i++) {
+        const PhaseEvent& event = sortedEvents[i];
+        json << (i == 0 ? "\n" : ",\n") << "    { \"phase\": " << JsonString(event.phase)
+             << ", \"shader\": " << JsonString(event.shader) << ", \"thread\": " << event.thread
+             << ", \"startMicroseconds\": " << event.startMicroseconds
+             << ", \"durationMicroseconds\": " << event.durationMicroseconds
+             << ", \"heapBytes\": " << event.heapBytes << ", \"heapDelta\": " << event.heapDelta
+             << " }";
+    }
+    json << "\n  ]\n";
+    json << "}\n";
+
+    return json.str();
+}
+
+std::string TimeReport::formatTrace() const {
+    std::vector<PhaseEvent> sortedEvents;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sortedEvents = events;
+    }
+
+    std::stable_sort(
+        sortedEvents.begin(),
+        sortedEvents.end(),
+        [](const PhaseEvent& a, const PhaseEvent& b) {
+            return a.startMicroseconds < b.startMicroseconds;
+        }
+    );
+
+    std::stringstream json;
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    json << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"glslop\"}}";
+
+    for (const PhaseEvent& event : sortedEvents) {
+        // A complete event for the phase, and a counter sample of the heap when it ended.
+        json << ",\n{\"name\":" << JsonString(event.phase)
+             << ",\"cat\":\"glslop\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+             << ",\"ts\":" << event.startMicroseconds
+             << ",\"dur\":" << event.durationMicroseconds
+             << ",\"args\":{\"shader\":" << JsonString(event.shader)
+             << ",\"heapDelta\":" << event.heapDelta << "}}";
+        json << ",\n{\"name\":\"heap\",\"ph\":\"C\",\"pid\":1,\"ts\":"
+             << event.startMicroseconds + event.durationMicroseconds
+             << ",\"args\":{\"bytes\":" << event.heapBytes << "}}";
+    }
+
+    json << "\n]}\n";
+    return json.str();
+}
+
+ScopedTimeReport::ScopedTimeReport(TimeReport* report) : previous(t_timeReport) {
+    t_timeReport = report;
+}
+
+ScopedTimeReport::~ScopedTimeReport() {
+    t_timeReport = previous;
+}
+
+TimeReport* CurrentTimeReport() {
+    return t_timeReport;
+}
+
+PhaseTimer::PhaseTimer(const char* phase, std::string_view shader)
+    : report(t_timeReport),
+      phase(phase) {
+    if (report) {
+        this->shader = shader;
+        startMicroseconds = report->now();
+        startHeapBytes = HeapBytesInUse();
+    }
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (!report) {
+        return;
+    }
+
+    int64_t heapBytes = HeapBytesInUse();
+    report->record({ phase,
+                     shader,
+                     CurrentThreadNumber(),
+                     startMicroseconds,
+                     report->now() - startMicroseconds,
+                     heapBytes,
+                     heapBytes - startHeapBytes });
+}
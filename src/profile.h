@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <stdint.h>
+
+enum class TimeReportFormat {
+    Text,
+    Json,
+    // Chrome's trace_event format, for chrome://tracing or Perfetto.
+    Trace,
+};
+
+// One timed phase of compiling a shader, e.g. parsing or SPIR-V generation.
+struct PhaseEvent {
+    std::string phase;
+    std::string shader;
+    uint32_t thread;
+    int64_t startMicroseconds;
+    int64_t durationMicroseconds;
+    // Heap in use when the phase ended, and its net growth from the start of the phase. These
+    // are samples of the process-wide heap, not peaks: memory allocated and freed within the
+    // phase doesn't show, and with several jobs their allocations are included too.
+    int64_t heapBytes;
+    int64_t heapDelta;
+};
+
+// Collects phase timings from every thread it is installed on.
+class TimeReport {
+  public:
+    TimeReport();
+
+    void record(PhaseEvent event);
+
+    // Microseconds since the report was created.
+    int64_t now() const;
+
+    std::string format(TimeReportFormat format) const;
+
+  private:
+    std::string formatText() const;
+    std::string formatJson() const;
+    std::string formatTrace() const;
+
+    std::chrono::steady_clock::time_point start;
+
+    mutable std::mutex mutex;
+    std::vector<PhaseEvent> events;
+};
+
+// Installs a TimeReport on the current thread for its lifetime.
+class ScopedTimeReport {
+  public:
+    explicit ScopedTimeReport(TimeReport* report);
+    ~ScopedTimeReport();
+
+    ScopedTimeReport(const ScopedTimeReport&) = delete;
+    ScopedTimeReport& operator=(const ScopedTimeReport&) = delete;
+
+  private:
+    TimeReport* previous;
+};
+
+// Returns the report installed on the current thread, or nullptr if nothing is recorded.
+TimeReport* CurrentTimeReport();
+
+// Records the time from construction to destruction as a phase of shader in the current
+// thread's report. Does nothing, not even copying shader, if no report is installed.
+class PhaseTimer {
+  public:
+    PhaseTimer(const char* phase, std::string_view shader);
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+  private:
+    TimeReport* report;
+    const char* phase;
+    std::string shader;
+    int64_t startMicroseconds;
+    int64_t startHeapBytes;
+};
+
+// Bytes currently allocated on the heap, or 0 where the C library can't tell.
+int64_t HeapBytesInUse();
+
+// Peak resident set size of the process so far, in bytes.
+int64_t PeakResidentBytes();
+
+// Resident set size of the process right now, in bytes, or 0 where it can't be read.
+int64_t ResidentBytes();
+
+// Hands free heap pages back to the system where the C library can, which it otherwise keeps
+// for later allocations, so that ResidentBytes counts what is in use.
+void ReleaseFreeHeap();
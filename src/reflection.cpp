@@ -0,0 +1,822 @@
+#include "reflection.h"
+#include "binary.h"
+#include "log.h"
+
+#include <glslang/Include/Common.h>
+#include <glslang/Include/Types.h>
+#include <glslang/MachineIndependent/localintermediate.h>
+#include <SPIRV/GlslangToSpv.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <stdio.h>
+#include <string.h>
+
+static int RoundUp(int value, int alignment) {
+    return alignment > 0 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+// Fills in the stride of the innermost dimension of an array type, and the layout of its
+// elements.
+static void ConvertArrayLayout(
+    const glslang::TType& type,
+    glslang::TLayoutPacking packing,
+    bool rowMajor,
+    ShaderType& result
+) {
+    if (type.getArraySizes()->getNumDims() > 1) {
+        ConvertArrayLayout(glslang::TType(type, 0), packing, rowMajor, result);
+        return;
+    }
+
+    int size;
+    glslang::TIntermediate::getMemberAlignment(
+        type,
+        size,
+        result.arrayStride,
+        packing,
+        rowMajor
+    );
+
+    glslang::TType elementType(type, 0);
+    int matrixStride;
+    glslang::TIntermediate::getMemberAlignment(
+        elementType,
+        result.elementSize,
+        matrixStride,
+        packing,
+        rowMajor
+    );
+    if (elementType.isMatrix()) {
+        result.matrixStride = matrixStride;
+    }
+}
+
+// Converts a type, laying it out with packing when that is std140, std430 or scalar. Member
+// offsets follow the same rules as GlslangToSpv, so they match the Offset decorations.
+static ShaderType
+ConvertType(const glslang::TType& type, glslang::TLayoutPacking packing, bool rowMajor) {
+    ShaderType result;
+    result.basicType = type.getBasicType();
+    result.vectorSize = type.getVectorSize();
+    result.matrixCols = type.getMatrixCols();
+    result.matrixRows = type.getMatrixRows();
+
+    if (type.isArray()) {
+        const glslang::TArraySizes* arraySizes = type.getArraySizes();
+        for (int i = 0; i < arraySizes->getNumDims(); i++) {
+            result.arraySizes.push_back(arraySizes->getDimSize(i));
+        }
+    }
+
+    bool explicitLayout = packing == glslang::ElpStd140 || packing == glslang::ElpStd430 ||
+                          packing == glslang::ElpScalar;
+
+    if (explicitLayout) {
+        result.rowMajor = rowMajor;
+        result.packing = packing;
+
+        int stride;
+        result.alignment = glslang::TIntermediate::getMemberAlignment(
+            type,
+            result.size,
+            stride,
+            packing,
+            rowMajor
+        );
+
+        if (type.isArray()) {
+            ConvertArrayLayout(type, packing, rowMajor, result);
+        } else if (type.isMatrix()) {
+            result.matrixStride = stride;
+        }
+    }
+
+    if (type.getBasicType() == glslang::EbtReference) {
+        result.typeName = type.getReferentType()->getTypeName().c_str();
+    }
+
+    if (type.isStruct()) {
+        result.typeName = type.getTypeName().c_str();
+
+        int offset = 0;
+        int extent = 0;
+
+        const glslang::TTypeList* members = type.getStruct();
+        for (size_t i = 0; i < members->size(); i++) {
+            const glslang::TType& memberType = *members->at(i).type;
+            const glslang::TQualifier& qualifier = memberType.getQualifier();
+
+            // A member's own row_major or column_major overrides the one it inherits.
+            bool memberRowMajor = qualifier.layoutMatrix != glslang::ElmNone
+                                      ? qualifier.layoutMatrix == glslang::ElmRowMajor
+                                      : rowMajor;
+            ShaderType member = ConvertType(memberType, packing, memberRowMajor);
+
+            if (explicitLayout) {
+                if (qualifier.hasOffset()) {
+                    offset = qualifier.layoutOffset;
+                } else {
+                    offset = RoundUp(offset, member.alignment);
+                }
+
+                member.offset = offset;
+                offset += member.size;
+                extent = std::max(extent, offset);
+            }
+
+            result.members.push_back({ memberType.getFieldName().c_str(), std::move(member) });
+        }
+
+        // Explicit offsets can leave members past the size glslang computes from the types.
+        if (explicitLayout && !type.isArray()) {
+            result.size = std::max(result.size, RoundUp(extent, result.alignment));
+        }
+    }
+
+    return result;
+}
+
+static ShaderType ConvertType(const glslang::TType& type) {
+    const glslang::TQualifier& qualifier = type.getQualifier();
+    return ConvertType(
+        type,
+        qualifier.layoutPacking,
+        qualifier.layoutMatrix == glslang::ElmRowMajor
+    );
+}
+
+static DescriptorType ConvertDescriptorType(const glslang::TType& type) {
+    const glslang::TQualifier& qualifier = type.getQualifier();
+
+    switch (type.getBasicType()) {
+        case glslang::EbtBlock:
+            if (qualifier.isPushConstant()) {
+                return DescriptorType::None;
+            }
+            return qualifier.storage == glslang::EvqBuffer ? DescriptorType::StorageBuffer
+                                                           : DescriptorType::UniformBuffer;
+        case glslang::EbtSampler: {
+            const glslang::TSampler& sampler = type.getSampler();
+            if (sampler.isPureSampler()) {
+                return DescriptorType::Sampler;
+            } else if (sampler.isSubpass()) {
+                return DescriptorType::InputAttachment;
+            } else if (sampler.isImage()) {
+                return sampler.isBuffer() ? DescriptorType::StorageTexelBuffer
+                                          : DescriptorType::StorageImage;
+            } else if (sampler.isBuffer()) {
+                return DescriptorType::UniformTexelBuffer;
+            }
+            return sampler.isCombined() ? DescriptorType::CombinedImageSampler
+                                        : DescriptorType::SampledImage;
+        }
+        case glslang::EbtAccStruct:
+            return DescriptorType::AccelerationStructure;
+        default:
+            return DescriptorType::None;
+    }
+}
+
+static ReflectedObject ConvertObject(const glslang::TObjectReflection& object) {
+    ReflectedObject result;
+    result.name = object.name;
+    result.binding = object.getBinding();
+    result.location = object.layoutLocation();
+    result.type = ConvertType(*object.getType());
+
+    const glslang::TQualifier& qualifier = object.getType()->getQualifier();
+    result.descriptorType = ConvertDescriptorType(*object.getType());
+    result.pushConstant = qualifier.isPushConstant();
+    if (result.descriptorType != DescriptorType::None) {
+        // Vulkan GLSL defaults both to 0.
+        result.set = qualifier.hasSet() ? static_cast<int>(qualifier.layoutSet) : 0;
+        result.binding = std::max(result.binding, 0);
+    }
+
+    for (int stage = 0; stage < EShLangCount; stage++) {
+        if (object.stages & (1 << stage)) {
+            result.stageFlags |= VulkanStageFlag(static_cast<EShLanguage>(stage));
+        }
+    }
+
+    return result;
+}
+
+uint32_t VulkanStageFlag(EShLanguage stage) {
+    switch (stage) {
+        case EShLangVertex:
+            return 0x00000001;
+        case EShLangTessControl:
+            return 0x00000002;
+        case EShLangTessEvaluation:
+            return 0x00000004;
+        case EShLangGeometry:
+            return 0x00000008;
+        case EShLangFragment:
+            return 0x00000010;
+        case EShLangCompute:
+            return 0x00000020;
+        default:
+            return 0;
+    }
+}
+
+// Objects of the program that can be bound: blocks and opaque uniforms.
+static std::vector<const ReflectedObject*> BindableObjects(const ShaderReflection& reflection) {
+    std::vector<const ReflectedObject*> objects;
+    for (const std::vector<ReflectedObject>* list :
+         { &reflection.uniformBlocks, &reflection.bufferBlocks, &reflection.uniforms }) {
+        for (const ReflectedObject& object : *list) {
+            objects.push_back(&object);
+        }
+    }
+    return objects;
+}
+
+std::vector<const ReflectedObject*> DescriptorBindings(const ShaderReflection& reflection) {
+    std::vector<const ReflectedObject*> descriptors;
+    for (const ReflectedObject* object : BindableObjects(reflection)) {
+        if (!object->pushConstant && object->descriptorType != DescriptorType::None) {
+            descriptors.push_back(object);
+        }
+    }
+
+    auto bindingOrder = [](const ReflectedObject* a, const ReflectedObject* b) {
+        return std::make_pair(a->set, a->binding) < std::make_pair(b->set, b->binding);
+    };
+    std::stable_sort(descriptors.begin(), descriptors.end(), bindingOrder);
+
+    // Objects can only share a binding if they alias, and the first one stands for all.
+    descriptors.erase(
+        std::unique(
+            descriptors.begin(),
+            descriptors.end(),
+            [](const ReflectedObject* a, const ReflectedObject* b) {
+                return a->set == b->set && a->binding == b->binding;
+            }
+        ),
+        descriptors.end()
+    );
+
+    return descriptors;
+}
+
+uint32_t DescriptorCount(const ReflectedObject& descriptor) {
+    uint32_t count = 1;
+    for (int size : descriptor.arraySizes) {
+        count *= size;
+    }
+    for (int size : descriptor.type.arraySizes) {
+        count *= size;
+    }
+    return count;
+}
+
+std::vector<const ReflectedObject*> PushConstantBlocks(const ShaderReflection& reflection) {
+    std::vector<const ReflectedObject*> blocks;
+    for (const ReflectedObject* object : BindableObjects(reflection)) {
+        if (object->pushConstant) {
+            blocks.push_back(object);
+        }
+    }
+    return blocks;
+}
+
+PushConstantRange PushConstantBlockRange(const ReflectedObject& block) {
+    const std::vector<ShaderMember>& members = block.type.members;
+    int begin = members.empty() ? 0 : members[0].type.offset;
+    int end = 0;
+    for (const ShaderMember& member : members) {
+        begin = std::min(begin, member.type.offset);
+        end = std::max(end, member.type.offset + member.type.size);
+    }
+    end = RoundUp(end, 4);
+
+    PushConstantRange range;
+    range.offset = begin;
+    range.size = end - begin;
+    return range;
+}
+
+// Collects the specialization constants, shared variables and buffer reference types of a
+// stage. Globals are also listed in the linker objects at the end of the tree, so every
+// symbol is counted once by ID.
+class GlobalCollector : public glslang::TIntermTraverser {
+  public:
+    std::vector<SpecializationConstant>& specializationConstants;
+    std::vector<BufferReferenceType>& bufferReferences;
+    // Dimensions of the arrays of blocks, by block name.
+    std::unordered_map<std::string, std::vector<int>>& blockArraySizes;
+    uint32_t sharedMemorySize = 0;
+
+    GlobalCollector(
+        std::vector<SpecializationConstant>& specializationConstants,
+        std::vector<BufferReferenceType>& bufferReferences,
+        std::unordered_map<std::string, std::vector<int>>& blockArraySizes
+    )
+        : specializationConstants(specializationConstants),
+          bufferReferences(bufferReferences),
+          blockArraySizes(blockArraySizes) {}
+
+    // References can also be made from an address without ever being stored in a variable,
+    // e.g. Node(address).next.
+    bool visitUnary(glslang::TVisit, glslang::TIntermUnary* node) override {
+        addBufferReferences(node->getType());
+        return true;
+    }
+
+    void visitSymbol(glslang::TIntermSymbol* symbol) override {
+        if (!visited.insert(symbol->getId()).second) {
+            return;
+        }
+
+        const glslang::TType& type = symbol->getType();
+        const glslang::TQualifier& qualifier = type.getQualifier();
+
+        addBufferReferences(type);
+
+        if (type.getBasicType() == glslang::EbtBlock && type.isArray()) {
+            std::vector<int>& sizes = blockArraySizes[type.getTypeName().c_str()];
+            sizes.clear();
+            const glslang::TArraySizes* arraySizes = type.getArraySizes();
+            for (int i = 0; i < arraySizes->getNumDims(); i++) {
+                sizes.push_back(arraySizes->getDimSize(i));
+            }
+        }
+
+        if (qualifier.storage == glslang::EvqShared) {
+            int size;
+            int stride;
+            int alignment = glslang::TIntermediate::getMemberAlignment(
+                type,
+                size,
+                stride,
+                glslang::ElpStd430,
+                false
+            );
+            sharedMemorySize = RoundUp(sharedMemorySize, alignment) + size;
+        } else if (qualifier.specConstant && qualifier.hasSpecConstantId()) {
+            addSpecializationConstant(symbol);
+        }
+    }
+
+  private:
+    std::unordered_set<long long> visited;
+
+    // Adds the buffer_reference blocks a type points to, and those they point to in turn.
+    void addBufferReferences(const glslang::TType& type) {
+        if (type.getBasicType() == glslang::EbtReference) {
+            const glslang::TType& referent = *type.getReferentType();
+            std::string name = referent.getTypeName().c_str();
+
+            // Stages of a linked program can use the same block, and blocks can point to
+            // themselves.
+            for (const BufferReferenceType& other : bufferReferences) {
+                if (other.type.typeName == name) {
+                    return;
+                }
+            }
+
+            BufferReferenceType reference;
+            reference.type = ConvertType(referent);
+            const glslang::TQualifier& qualifier = referent.getQualifier();
+            if (qualifier.hasBufferReferenceAlign()) {
+                // glslang stores the alignment as its log2.
+                reference.align = 1u << qualifier.layoutBufferReferenceAlign;
+            }
+            bufferReferences.push_back(std::move(reference));
+
+            addBufferReferences(referent);
+        } else if (type.isStruct()) {
+            for (const glslang::TTypeLoc& member : *type.getStruct()) {
+                addBufferReferences(*member.type);
+            }
+        }
+    }
+
+    void addSpecializationConstant(glslang::TIntermSymbol* symbol) {
+        SpecializationConstant constant;
+        constant.name = symbol->getName().c_str();
+        constant.id = symbol->getType().getQualifier().layoutSpecConstantId;
+        constant.basicType = symbol->getType().getBasicType();
+
+        // Stages of a linked program can declare the same constant.
+        for (const SpecializationConstant& other : specializationConstants) {
+            if (other.id == constant.id) {
+                return;
+            }
+        }
+
+        const glslang::TConstUnionArray& value = symbol->getConstArray();
+        if (!value.empty()) {
+            switch (constant.basicType) {
+                case glslang::EbtFloat:
+                case glslang::EbtDouble:
+                case glslang::EbtFloat16:
+                    constant.floatValue = value[0].getDConst();
+                    break;
+                case glslang::EbtBool:
+                    constant.intValue = value[0].getBConst();
+                    break;
+                case glslang::EbtInt8:
+                    constant.intValue = value[0].getI8Const();
+                    break;
+                case glslang::EbtUint8:
+                    constant.intValue = value[0].getU8Const();
+                    break;
+                case glslang::EbtInt16:
+                    constant.intValue = value[0].getI16Const();
+                    break;
+                case glslang::EbtUint16:
+                    constant.intValue = value[0].getU16Const();
+                    break;
+                case glslang::EbtInt:
+                    constant.intValue = value[0].getIConst();
+                    break;
+                case glslang::EbtUint:
+                    constant.intValue = value[0].getUConst();
+                    break;
+                case glslang::EbtInt64:
+                    constant.intValue = value[0].getI64Const();
+                    break;
+                case glslang::EbtUint64:
+                    constant.intValue = static_cast<int64_t>(value[0].getU64Const());
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        specializationConstants.push_back(std::move(constant));
+    }
+};
+
+// glslang reflects an array of blocks once per element used, as "Block[1]", with the type of
+// an element. Merges those into one object named after the block, with the dimensions of the
+// array, so that it's counted as the descriptors it binds.
+static void MergeBlockArrayElements(
+    std::vector<ReflectedObject>& blocks,
+    const std::unordered_map<std::string, std::vector<int>>& blockArraySizes
+) {
+    std::vector<ReflectedObject> merged;
+    for (ReflectedObject& block : blocks) {
+        size_t bracket = block.name.find('[');
+        if (bracket == std::string::npos) {
+            merged.push_back(std::move(block));
+            continue;
+        }
+
+        std::string name = block.name.substr(0, bracket);
+        auto same = [&](const ReflectedObject& other) {
+            return other.name == name && !other.arraySizes.empty();
+        };
+        auto existing = std::find_if(merged.begin(), merged.end(), same);
+        if (existing != merged.end()) {
+            existing->stageFlags |= block.stageFlags;
+            continue;
+        }
+
+        auto sizes = blockArraySizes.find(name);
+        if (sizes == blockArraySizes.end()) {
+            // Not declared as an array in any stage glslang was given, which shouldn't happen.
+            // Keep the element as reflected.
+            merged.push_back(std::move(block));
+            continue;
+        }
+
+        block.name = name;
+        block.arraySizes = sizes->second;
+        merged.push_back(std::move(block));
+    }
+    blocks = std::move(merged);
+}
+
+std::optional<ShaderReflection>
+ReflectProgram(glslang::TProgram* program, const std::vector<EShLanguage>& stages) {
+    ShaderReflection reflection;
+    std::unordered_map<std::string, std::vector<int>> blockArraySizes;
+
+    for (EShLanguage stage : stages) {
+        glslang::TIntermediate* intermediate = program->getIntermediate(stage);
+
+        if (!intermediate) {
+            Print("Failed to get intermediate for stage %d\n", stage);
+            return std::nullopt;
+        }
+
+        ShaderStageBinary binary;
+        binary.stage = stage;
+
+        std::vector<unsigned int> spirv;
+        glslang::GlslangToSpv(*intermediate, spirv);
+        binary.spirv.assign(spirv.begin(), spirv.end());
+        binary.unoptimizedSize = static_cast<uint32_t>(spirv.size());
+
+        reflection.stages.push_back(std::move(binary));
+
+        GlobalCollector collector(
+            reflection.specializationConstants,
+            reflection.bufferReferences,
+            blockArraySizes
+        );
+        if (intermediate->getTreeRoot()) {
+            intermediate->getTreeRoot()->traverse(&collector);
+        }
+
+        if (stage == EShLangCompute) {
+            for (int i = 0; i < 3; i++) {
+                reflection.localSize[i] = intermediate->getLocalSize(i);
+                int specId = intermediate->getLocalSizeSpecId(i);
+                reflection.localSizeSpecIds[i] = specId >= 0 ? specId : -1;
+            }
+            reflection.sharedMemorySize = collector.sharedMemorySize;
+        }
+    }
+
+    std::sort(
+        reflection.specializationConstants.begin(),
+        reflection.specializationConstants.end(),
+        [](const SpecializationConstant& a, const SpecializationConstant& b) {
+            return a.id < b.id;
+        }
+    );
+
+    std::sort(
+        reflection.bufferReferences.begin(),
+        reflection.bufferReferences.end(),
+        [](const BufferReferenceType& a, const BufferReferenceType& b) {
+            return a.type.typeName < b.type.typeName;
+        }
+    );
+
+    for (int i = 0; i < program->getNumUniformBlocks(); i++) {
+        reflection.uniformBlocks.push_back(ConvertObject(program->getUniformBlock(i)));
+    }
+
+    for (int i = 0; i < program->getNumBufferBlocks(); i++) {
+        reflection.bufferBlocks.push_back(ConvertObject(program->getBufferBlock(i)));
+    }
+
+    MergeBlockArrayElements(reflection.uniformBlocks, blockArraySizes);
+    MergeBlockArrayElements(reflection.bufferBlocks, blockArraySizes);
+
+    for (int i = 0; i < program->getNumPipeInputs(); i++) {
+        reflection.pipeInputs.push_back(ConvertObject(program->getPipeInput(i)));
+    }
+
+    for (int i = 0; i < program->getNumPipeOutputs(); i++) {
+        reflection.pipeOutputs.push_back(ConvertObject(program->getPipeOutput(i)));
+    }
+
+    for (int i = 0; i < program->getNumUniformVariables(); i++) {
+        reflection.uniforms.push_back(ConvertObject(program->getUniform(i)));
+    }
+
+    return reflection;
+}
+
+// Bump whenever the serialized layout changes, so stale cache entries are ignored.
+static const uint32_t s_reflectionFormatVersion = 9;
+
+static void WriteType(BinaryWriter& writer, const ShaderType& value) {
+    writer.u32(value.basicType);
+    writer.i32(value.vectorSize);
+    writer.i32(value.matrixCols);
+    writer.i32(value.matrixRows);
+
+    writer.u32(static_cast<uint32_t>(value.arraySizes.size()));
+    for (int size : value.arraySizes) {
+        writer.i32(size);
+    }
+
+    writer.str(value.typeName);
+
+    writer.i32(value.offset);
+    writer.i32(value.size);
+    writer.i32(value.alignment);
+    writer.i32(value.arrayStride);
+    writer.i32(value.elementSize);
+    writer.i32(value.matrixStride);
+    writer.u32(value.rowMajor);
+    writer.u32(static_cast<uint32_t>(value.packing));
+
+    writer.u32(static_cast<uint32_t>(value.members.size()));
+    for (const ShaderMember& member : value.members) {
+        writer.str(member.name);
+        WriteType(writer, member.type);
+    }
+}
+
+static void WriteObjects(BinaryWriter& writer, const std::vector<ReflectedObject>& values) {
+    writer.u32(static_cast<uint32_t>(values.size()));
+    for (const ReflectedObject& value : values) {
+        writer.str(value.name);
+        writer.i32(value.binding);
+        writer.i32(value.location);
+        writer.i32(value.set);
+        writer.i32(static_cast<int32_t>(value.descriptorType));
+        writer.u32(value.pushConstant);
+        writer.u32(value.stageFlags);
+        WriteType(writer, value.type);
+
+        writer.u32(static_cast<uint32_t>(value.arraySizes.size()));
+        for (int size : value.arraySizes) {
+            writer.i32(size);
+        }
+    }
+}
+
+static ShaderType ReadType(BinaryReader& reader) {
+    ShaderType value;
+    uint32_t basicType = reader.u32();
+    if (basicType >= glslang::EbtNumTypes) {
+        reader.failed = true;
+        return value;
+    }
+    value.basicType = static_cast<glslang::TBasicType>(basicType);
+    value.vectorSize = reader.i32();
+    value.matrixCols = reader.i32();
+    value.matrixRows = reader.i32();
+
+    uint32_t arrayDims = reader.count();
+    for (uint32_t i = 0; i < arrayDims && !reader.failed; i++) {
+        value.arraySizes.push_back(reader.i32());
+    }
+
+    value.typeName = reader.str();
+
+    value.offset = reader.i32();
+    value.size = reader.i32();
+    value.alignment = reader.i32();
+    value.arrayStride = reader.i32();
+    value.elementSize = reader.i32();
+    value.matrixStride = reader.i32();
+    value.rowMajor = reader.u32() != 0;
+
+    uint32_t packing = reader.u32();
+    if (packing >= glslang::ElpCount) {
+        reader.failed = true;
+        return value;
+    }
+    value.packing = static_cast<glslang::TLayoutPacking>(packing);
+
+    uint32_t memberCount = reader.count();
+    for (uint32_t i = 0; i < memberCount && !reader.failed; i++) {
+        ShaderMember member;
+        member.name = reader.str();
+        member.type = ReadType(reader);
+        value.members.push_back(std::move(member));
+    }
+
+    return value;
+}
+
+static std::vector<ReflectedObject> ReadObjects(BinaryReader& reader) {
+    std::vector<ReflectedObject> values;
+    uint32_t objectCount = reader.count();
+    for (uint32_t i = 0; i < objectCount && !reader.failed; i++) {
+        ReflectedObject value;
+        value.name = reader.str();
+        value.binding = reader.i32();
+        value.location = reader.i32();
+        value.set = reader.i32();
+        value.descriptorType = static_cast<DescriptorType>(reader.i32());
+        value.pushConstant = reader.u32() != 0;
+        value.stageFlags = reader.u32();
+        value.type = ReadType(reader);
+
+        uint32_t arrayDims = reader.count();
+        for (uint32_t j = 0; j < arrayDims && !reader.failed; j++) {
+            value.arraySizes.push_back(reader.i32());
+        }
+        values.push_back(std::move(value));
+    }
+    return values;
+}
+
+std::string SerializeReflection(const ShaderReflection& reflection) {
+    BinaryWriter writer;
+    writer.u32(s_reflectionFormatVersion);
+
+    writer.u32(static_cast<uint32_t>(reflection.stages.size()));
+    for (const ShaderStageBinary& binary : reflection.stages) {
+        writer.u32(binary.stage);
+        writer.u32(static_cast<uint32_t>(binary.spirv.size()));
+        writer.data.append(
+            reinterpret_cast<const char*>(binary.spirv.data()),
+            binary.spirv.size() * sizeof(uint32_t)
+        );
+        writer.u32(binary.unoptimizedSize);
+    }
+
+    WriteObjects(writer, reflection.uniformBlocks);
+    WriteObjects(writer, reflection.bufferBlocks);
+    WriteObjects(writer, reflection.pipeInputs);
+    WriteObjects(writer, reflection.pipeOutputs);
+    WriteObjects(writer, reflection.uniforms);
+
+    writer.u32(static_cast<uint32_t>(reflection.bufferReferences.size()));
+    for (const BufferReferenceType& reference : reflection.bufferReferences) {
+        WriteType(writer, reference.type);
+        writer.u32(reference.align);
+    }
+
+    writer.u32(static_cast<uint32_t>(reflection.specializationConstants.size()));
+    for (const SpecializationConstant& constant : reflection.specializationConstants) {
+        writer.str(constant.name);
+        writer.u32(constant.id);
+        writer.u32(constant.basicType);
+        writer.u64(static_cast<uint64_t>(constant.intValue));
+        uint64_t floatBits;
+        memcpy(&floatBits, &constant.floatValue, sizeof(floatBits));
+        writer.u64(floatBits);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        writer.u32(reflection.localSize[i]);
+        writer.i32(reflection.localSizeSpecIds[i]);
+    }
+    writer.u32(reflection.sharedMemorySize);
+
+    return writer.data;
+}
+
+std::optional<ShaderReflection> DeserializeReflection(std::string_view data) {
+    BinaryReader reader { data };
+
+    if (reader.u32() != s_reflectionFormatVersion) {
+        return std::nullopt;
+    }
+
+    ShaderReflection reflection;
+
+    uint32_t stageCount = reader.count();
+    for (uint32_t i = 0; i < stageCount && !reader.failed; i++) {
+        ShaderStageBinary binary;
+        uint32_t stage = reader.u32();
+        if (stage >= EShLangCount) {
+            return std::nullopt;
+        }
+        binary.stage = static_cast<EShLanguage>(stage);
+
+        uint32_t spirvSize = reader.count();
+        if (reader.failed || spirvSize * sizeof(uint32_t) > data.size() - reader.position) {
+            return std::nullopt;
+        }
+        binary.spirv.resize(spirvSize);
+        memcpy(
+            binary.spirv.data(),
+            data.data() + reader.position,
+            spirvSize * sizeof(uint32_t)
+        );
+        reader.position += spirvSize * sizeof(uint32_t);
+        binary.unoptimizedSize = reader.u32();
+
+        reflection.stages.push_back(std::move(binary));
+    }
+
+    reflection.uniformBlocks = ReadObjects(reader);
+    reflection.bufferBlocks = ReadObjects(reader);
+    reflection.pipeInputs = ReadObjects(reader);
+    reflection.pipeOutputs = ReadObjects(reader);
+    reflection.uniforms = ReadObjects(reader);
+
+    uint32_t referenceCount = reader.count();
+    for (uint32_t i = 0; i < referenceCount && !reader.failed; i++) {
+        BufferReferenceType reference;
+        reference.type = ReadType(reader);
+        reference.align = reader.u32();
+        reflection.bufferReferences.push_back(std::move(reference));
+    }
+
+    uint32_t constantCount = reader.count();
+    for (uint32_t i = 0; i < constantCount && !reader.failed; i++) {
+        SpecializationConstant constant;
+        constant.name = reader.str();
+        constant.id = reader.u32();
+        uint32_t basicType = reader.u32();
+        if (basicType >= glslang::EbtNumTypes) {
+            return std::nullopt;
+        }
+        constant.basicType = static_cast<glslang::TBasicType>(basicType);
+        constant.intValue = static_cast<int64_t>(reader.u64());
+        uint64_t floatBits = reader.u64();
+        memcpy(&constant.floatValue, &floatBits, sizeof(floatBits));
+        reflection.specializationConstants.push_back(std::move(constant));
+    }
+
+    for (int i = 0; i < 3; i++) {
+        reflection.localSize[i] = reader.u32();
+        reflection.localSizeSpecIds[i] = reader.i32();
+    }
+    reflection.sharedMemorySize = reader.u32();
+
+    if (reader.failed || reader.position != data.size()) {
+        return std::nullopt;
+    }
+
+    return reflection;
+}
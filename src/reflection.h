@@ -0,0 +1,209 @@
+#pragma once
+
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/Include/BaseTypes.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <stdint.h>
+
+struct ShaderMember;
+
+// A self-contained copy of the parts of a glslang::TType the header generator uses, so that
+// reflection data can outlive the TProgram and be stored in the compile cache.
+struct ShaderType {
+    glslang::TBasicType basicType = glslang::EbtVoid;
+    int vectorSize = 1;
+    int matrixCols = 0;
+    int matrixRows = 0;
+    // Array dimensions, outermost first. Unsized dimensions are 0.
+    std::vector<int> arraySizes;
+    // Name of a struct or block type, or for a buffer reference (EbtReference) the name of the
+    // buffer_reference block it points to. References aren't followed any further, as blocks
+    // can point to themselves, see ShaderReflection::bufferReferences.
+    std::string typeName;
+    std::vector<ShaderMember> members;
+
+    // Layout in bytes, as glslang decorates it in the SPIR-V. Only set for types inside
+    // blocks with an explicit packing (std140, std430 or scalar), otherwise all 0.
+    // Offset from the start of the enclosing struct or block.
+    int offset = 0;
+    // Size of the whole type. For structs this includes the padding at the end.
+    int size = 0;
+    int alignment = 0;
+    // Stride and size of the elements of the innermost array dimension. Outer dimensions are
+    // always tightly packed arrays of the inner ones.
+    int arrayStride = 0;
+    int elementSize = 0;
+    // Stride between the columns of a matrix, or its rows when rowMajor.
+    int matrixStride = 0;
+    bool rowMajor = false;
+    // The packing the layout follows, ElpNone without one.
+    glslang::TLayoutPacking packing = glslang::ElpNone;
+
+    bool isVector() const {
+        return vectorSize > 1 && matrixCols == 0;
+    }
+
+    bool isMatrix() const {
+        return matrixCols > 0;
+    }
+
+    bool isArray() const {
+        return !arraySizes.empty();
+    }
+
+    bool isSizedArray() const {
+        return isArray() && arraySizes[0] != 0;
+    }
+
+    int getOuterArraySize() const {
+        return isArray() ? arraySizes[0] : 0;
+    }
+
+    bool isStruct() const {
+        return basicType == glslang::EbtStruct || basicType == glslang::EbtBlock;
+    }
+
+    bool hasLayout() const {
+        return size > 0;
+    }
+
+    bool operator==(const ShaderType& other) const = default;
+};
+
+struct ShaderMember {
+    std::string name;
+    ShaderType type;
+
+    bool operator==(const ShaderMember& other) const = default;
+};
+
+// How an object is bound, with the values of VkDescriptorType.
+enum class DescriptorType : int32_t {
+    // Not a descriptor, e.g. a push constant block or a member of a block.
+    None = -1,
+    Sampler = 0,
+    CombinedImageSampler = 1,
+    SampledImage = 2,
+    StorageImage = 3,
+    UniformTexelBuffer = 4,
+    StorageTexelBuffer = 5,
+    UniformBuffer = 6,
+    StorageBuffer = 7,
+    InputAttachment = 10,
+    AccelerationStructure = 1000150000,
+};
+
+// A copy of a glslang::TObjectReflection entry.
+struct ReflectedObject {
+    std::string name;
+    int binding = -1;
+    int location = -1;
+    // Descriptor set, or -1 if the object isn't a descriptor.
+    int set = -1;
+    DescriptorType descriptorType = DescriptorType::None;
+    bool pushConstant = false;
+    // VkShaderStageFlags of the stages that use the object.
+    uint32_t stageFlags = 0;
+    ShaderType type;
+    // Dimensions of an array of blocks, which glslang reflects once per element. Those
+    // entries are merged into one named after the block, and type is that of an element.
+    std::vector<int> arraySizes;
+};
+
+// A block type declared with layout(buffer_reference). Shaders reach these through 64-bit
+// device addresses instead of descriptors, so they aren't reflected as objects.
+struct BufferReferenceType {
+    // The block, laid out like a buffer block. Members that are references are 64 bits.
+    ShaderType type;
+    // buffer_reference_align in bytes, which defaults to 16. Every address the shader reads
+    // the block from must be a multiple of it.
+    uint32_t align = 16;
+
+    bool operator==(const BufferReferenceType& other) const = default;
+};
+
+// The SPIR-V module of one stage of a program.
+struct ShaderStageBinary {
+    EShLanguage stage = EShLangVertex;
+    std::vector<uint32_t> spirv;
+    // Size of the SPIR-V as generated by glslang, before any optimization.
+    uint32_t unoptimizedSize = 0;
+};
+
+// A specialization constant declared with layout(constant_id).
+struct SpecializationConstant {
+    std::string name;
+    uint32_t id = 0;
+    glslang::TBasicType basicType = glslang::EbtInt;
+    // The default value. Floating point constants use floatValue, everything else the bits
+    // of intValue.
+    int64_t intValue = 0;
+    double floatValue = 0.0;
+
+    bool operator==(const SpecializationConstant&) const = default;
+};
+
+// Everything the header generator needs from a compiled program.
+struct ShaderReflection {
+    // One module per linked stage, in pipeline order.
+    std::vector<ShaderStageBinary> stages;
+
+    // Reflection of the whole program. Blocks used by several stages appear once.
+    std::vector<ReflectedObject> uniformBlocks;
+    std::vector<ReflectedObject> bufferBlocks;
+    std::vector<ReflectedObject> pipeInputs;
+    std::vector<ReflectedObject> pipeOutputs;
+    std::vector<ReflectedObject> uniforms;
+
+    // Every buffer_reference block type the program refers to, directly or through another
+    // one, sorted by name.
+    std::vector<BufferReferenceType> bufferReferences;
+
+    // Specialization constants of all stages, sorted by ID.
+    std::vector<SpecializationConstant> specializationConstants;
+
+    // Compute only: the workgroup size, the IDs of the specialization constants that override
+    // its dimensions or -1, and the bytes of workgroup shared variables. Shared variables are
+    // laid out as std430, and count whether or not the optimizer later removes them.
+    uint32_t localSize[3] = { 1, 1, 1 };
+    int localSizeSpecIds[3] = { -1, -1, -1 };
+    uint32_t sharedMemorySize = 0;
+};
+
+// The VkShaderStageFlagBits value of a stage.
+uint32_t VulkanStageFlag(EShLanguage stage);
+
+// The descriptors of a program sorted by set and binding, with one entry per binding. Push
+// constant blocks aren't descriptors.
+std::vector<const ReflectedObject*> DescriptorBindings(const ShaderReflection& reflection);
+
+// Number of descriptors bound by an object, counting arrays of blocks and of opaque types.
+// Arrays of descriptors are flattened, and an unsized dimension makes the whole count 0,
+// meaning variable.
+uint32_t DescriptorCount(const ReflectedObject& descriptor);
+
+// The push constant blocks of a program.
+std::vector<const ReflectedObject*> PushConstantBlocks(const ShaderReflection& reflection);
+
+// Bytes of a push constant block its members cover. They can start past 0 with
+// layout(offset), and the size is rounded up to a multiple of 4 as Vulkan requires.
+struct PushConstantRange {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+};
+PushConstantRange PushConstantBlockRange(const ReflectedObject& block);
+
+// Generates SPIR-V for each of the given stages of a linked program and copies its
+// reflection. The program must have had buildReflection() called on it.
+std::optional<ShaderReflection>
+ReflectProgram(glslang::TProgram* program, const std::vector<EShLanguage>& stages);
+
+// Serializes reflection data into a compact binary form and back.
+// DeserializeReflection returns std::nullopt if the data is truncated or malformed.
+std::string SerializeReflection(const ShaderReflection& reflection);
+std::optional<ShaderReflection> DeserializeReflection(std::string_view data);
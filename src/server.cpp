@@ -0,0 +1,271 @@
+#include "server.h"
+#include "binary.h"
+
+#include <chrono>
+#include <thread>
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Every message is a u32 byte count followed by a BinaryWriter payload. Requests start with
+// a magic and protocol version, so a mismatched client and server fail cleanly.
+static const uint32_t s_requestMagic = 0x52534c47; // "GLSR"
+static const uint32_t s_protocolVersion = 1;
+static const uint32_t s_maxMessageSize = 1u << 30;
+
+static bool SendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+static bool ReceiveAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t received = recv(fd, data, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+static bool SendMessage(int fd, const std::string& payload) {
+    uint32_t size = static_cast<uint32_t>(payload.size());
+    return SendAll(fd, reinterpret_cast<const char*>(&size), sizeof(size)) &&
+           SendAll(fd, payload.data(), payload.size());
+}
+
+static std::optional<std::string> ReceiveMessage(int fd) {
+    uint32_t size = 0;
+    if (!ReceiveAll(fd, reinterpret_cast<char*>(&size), sizeof(size)) ||
+        size > s_maxMessageSize) {
+        return std::nullopt;
+    }
+
+    std::string payload(size, '\0');
+    if (!ReceiveAll(fd, payload.data(), size)) {
+        return std::nullopt;
+    }
+    return payload;
+}
+
+static std::string EncodeRequest(const ServerRequest& request) {
+    BinaryWriter writer;
+    writer.u32(s_requestMagic);
+    writer.u32(s_protocolVersion);
+    writer.str(request.workingDirectory);
+    writer.u32(static_cast<uint32_t>(request.args.size()));
+    for (const std::string& arg : request.args) {
+        writer.str(arg);
+    }
+    return writer.data;
+}
+
+static std::optional<ServerRequest> DecodeRequest(std::string_view payload) {
+    BinaryReader reader { payload };
+    if (reader.u32() != s_requestMagic || reader.u32() != s_protocolVersion) {
+        return std::nullopt;
+    }
+
+    ServerRequest request;
+    request.workingDirectory = reader.str();
+    uint32_t argCount = reader.count();
+    for (uint32_t i = 0; i < argCount && !reader.failed; i++) {
+        request.args.push_back(reader.str());
+    }
+
+    if (reader.failed) {
+        return std::nullopt;
+    }
+    return request;
+}
+
+static std::string EncodeResponse(const ServerResponse& response) {
+    BinaryWriter writer;
+    writer.i32(response.exitCode);
+    writer.str(response.output);
+    writer.u32(static_cast<uint32_t>(response.outputs.size()));
+    for (const OutputFile& output : response.outputs) {
+        writer.str(output.path);
+        writer.str(output.contents);
+    }
+    writer.u64(response.serverMicroseconds);
+    return writer.data;
+}
+
+static std::optional<ServerResponse> DecodeResponse(std::string_view payload) {
+    BinaryReader reader { payload };
+
+    ServerResponse response;
+    response.exitCode = reader.i32();
+    response.output = reader.str();
+    uint32_t outputCount = reader.count();
+    for (uint32_t i = 0; i < outputCount && !reader.failed; i++) {
+        OutputFile output;
+        output.path = reader.str();
+        output.contents = reader.str();
+        response.outputs.push_back(std::move(output));
+    }
+    response.serverMicroseconds = reader.u64();
+
+    if (reader.failed) {
+        return std::nullopt;
+    }
+    return response;
+}
+
+static bool MakeSocketAddress(const std::string& socketPath, sockaddr_un& address) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    return true;
+}
+
+static int Connect(const std::string& socketPath) {
+    sockaddr_un address;
+    if (!MakeSocketAddress(socketPath, address)) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void HandleConnection(int fd, const RequestHandler& handler) {
+    std::optional<std::string> payload = ReceiveMessage(fd);
+    if (!payload) {
+        close(fd);
+        return;
+    }
+
+    std::optional<ServerRequest> request = DecodeRequest(*payload);
+    if (!request) {
+        printf("Rejected malformed request\n");
+        close(fd);
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ServerResponse response = handler(*request);
+    auto end = std::chrono::steady_clock::now();
+
+    response.serverMicroseconds =
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    printf(
+        "Handled request from %s: exit code %d, %zu outputs, %.2f ms\n",
+        request->workingDirectory.c_str(),
+        response.exitCode,
+        response.outputs.size(),
+        response.serverMicroseconds / 1000.0
+    );
+    fflush(stdout);
+
+    SendMessage(fd, EncodeResponse(response));
+    close(fd);
+}
+
+int RunServer(const std::string& socketPath, const RequestHandler& handler) {
+    sockaddr_un address;
+    if (!MakeSocketAddress(socketPath, address)) {
+        printf("Socket path %s is too long\n", socketPath.c_str());
+        return 1;
+    }
+
+    // A socket file left behind by a server that died can be replaced, a live one can't.
+    int existing = Connect(socketPath);
+    if (existing >= 0) {
+        close(existing);
+        printf("A server is already listening on %s\n", socketPath.c_str());
+        return 1;
+    }
+    unlink(socketPath.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        printf("Failed to create socket: %s\n", strerror(errno));
+        return 1;
+    }
+
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        printf("Failed to bind %s: %s\n", socketPath.c_str(), strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    if (listen(fd, 64) != 0) {
+        printf("Failed to listen on %s: %s\n", socketPath.c_str(), strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    // Clients going away mid-response must not take the server down.
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Listening on %s\n", socketPath.c_str());
+    fflush(stdout);
+
+    while (true) {
+        int client = accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            printf("Failed to accept connection: %s\n", strerror(errno));
+            close(fd);
+            return 1;
+        }
+
+        std::thread(HandleConnection, client, std::cref(handler)).detach();
+    }
+}
+
+std::optional<ServerResponse>
+SendRequest(const std::string& socketPath, const ServerRequest& request) {
+    int fd = Connect(socketPath);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+
+    std::optional<ServerResponse> response;
+    if (SendMessage(fd, EncodeRequest(request))) {
+        std::optional<std::string> payload = ReceiveMessage(fd);
+        if (payload) {
+            response = DecodeResponse(*payload);
+        }
+    }
+
+    close(fd);
+    return response;
+}
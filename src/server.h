@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+// A file produced by a compile, written by whoever requested it.
+struct OutputFile {
+    std::string path;
+    std::string contents;
+};
+
+// A command line to run as if glslop had been started with it in workingDirectory.
+struct ServerRequest {
+    std::string workingDirectory;
+    std::vector<std::string> args;
+};
+
+struct ServerResponse {
+    int exitCode = 0;
+    // Everything the compile printed.
+    std::string output;
+    // Files to write, relative to the request's working directory.
+    std::vector<OutputFile> outputs;
+    // Time spent handling the request in the server.
+    uint64_t serverMicroseconds = 0;
+};
+
+using RequestHandler = std::function<ServerResponse(const ServerRequest&)>;
+
+// Listens on a Unix domain socket and handles each connection on its own thread.
+// Only returns if the socket can't be set up, with the exit code to use.
+int RunServer(const std::string& socketPath, const RequestHandler& handler);
+
+// Sends a request to a running server. Returns std::nullopt if no server is listening on
+// socketPath or the connection fails, so the caller can fall back to compiling itself.
+std::optional<ServerResponse>
+SendRequest(const std::string& socketPath, const ServerRequest& request);
@@ -0,0 +1,183 @@
+#include "vertex.h"
+
+#include <charconv>
+
+// VkFormat of the R8, R8G8, R8G8B8 and R8G8B8A8 UNORM formats, and likewise for 16 and 32
+// bits. The other kinds follow at fixed distances from these.
+static const uint32_t s_firstFormats8[4] = { 9, 16, 23, 37 };
+static const uint32_t s_firstFormats16[4] = { 70, 77, 84, 91 };
+// The 32-bit formats start with UINT, as there are no normalized ones.
+static const uint32_t s_firstFormats32[4] = { 98, 101, 104, 107 };
+
+uint32_t VertexFormat::vkFormat() const {
+    if (bits == 32) {
+        uint32_t first = s_firstFormats32[components - 1];
+        switch (kind) {
+            case Kind::Uint:
+                return first;
+            case Kind::Sint:
+                return first + 1;
+            default:
+                return first + 2;
+        }
+    }
+
+    uint32_t first = bits == 8 ? s_firstFormats8[components - 1]
+                               : s_firstFormats16[components - 1];
+    switch (kind) {
+        case Kind::Unorm:
+            return first;
+        case Kind::Snorm:
+            return first + 1;
+        case Kind::Uint:
+            return first + 4;
+        case Kind::Sint:
+            return first + 5;
+        default:
+            return first + 6;
+    }
+}
+
+std::string VertexFormat::vkFormatName() const {
+    static const char s_channels[4] = { 'R', 'G', 'B', 'A' };
+
+    std::string result = "VK_FORMAT_";
+    for (int i = 0; i < components; i++) {
+        result += s_channels[i] + std::to_string(bits);
+    }
+
+    switch (kind) {
+        case Kind::Unorm:
+            return result + "_UNORM";
+        case Kind::Snorm:
+            return result + "_SNORM";
+        case Kind::Uint:
+            return result + "_UINT";
+        case Kind::Sint:
+            return result + "_SINT";
+        default:
+            return result + "_SFLOAT";
+    }
+}
+
+const char* VertexFormat::componentType() const {
+    bool isSigned = kind == Kind::Snorm || kind == Kind::Sint;
+    switch (bits) {
+        case 8:
+            return isSigned ? "int8_t" : "uint8_t";
+        case 16:
+            return isSigned ? "int16_t" : "uint16_t";
+        default:
+            if (kind == Kind::Float) {
+                return "float";
+            }
+            return isSigned ? "int32_t" : "uint32_t";
+    }
+}
+
+std::string VertexFormat::name() const {
+    static const char* s_kinds[] = { "unorm", "snorm", "uint", "sint", "float" };
+    return s_kinds[static_cast<int>(kind)] + std::to_string(bits) + "x" +
+           std::to_string(components);
+}
+
+std::optional<VertexFormat> ParseVertexFormat(std::string_view format) {
+    static const std::pair<const char*, VertexFormat::Kind> s_kinds[] = {
+        { "unorm", VertexFormat::Kind::Unorm }, { "snorm", VertexFormat::Kind::Snorm },
+        { "uint", VertexFormat::Kind::Uint },   { "sint", VertexFormat::Kind::Sint },
+        { "float", VertexFormat::Kind::Float },
+    };
+
+    VertexFormat result;
+
+    if (format.substr(0, 4) == "half") {
+        result.kind = VertexFormat::Kind::Float;
+        result.bits = 16;
+        format.remove_prefix(4);
+    } else {
+        bool found = false;
+        for (const auto& [name, kind] : s_kinds) {
+            std::string_view kindName = name;
+            if (format.substr(0, kindName.size()) == kindName) {
+                result.kind = kind;
+                format.remove_prefix(kindName.size());
+                found = true;
+                break;
+            }
+        }
+
+        std::from_chars_result bits =
+            std::from_chars(format.data(), format.data() + format.size(), result.bits);
+        if (!found || bits.ec != std::errc()) {
+            return std::nullopt;
+        }
+        format.remove_prefix(bits.ptr - format.data());
+    }
+
+    if (!format.empty()) {
+        if (format[0] != 'x') {
+            return std::nullopt;
+        }
+        format.remove_prefix(1);
+
+        std::from_chars_result components =
+            std::from_chars(format.data(), format.data() + format.size(), result.components);
+        if (components.ec != std::errc() || components.ptr != format.data() + format.size() ||
+            result.components < 1 || result.components > 4) {
+            return std::nullopt;
+        }
+    }
+
+    // Only the combinations Vulkan has formats for.
+    switch (result.kind) {
+        case VertexFormat::Kind::Unorm:
+        case VertexFormat::Kind::Snorm:
+            return result.bits == 8 || result.bits == 16 ? std::optional(result)
+                                                         : std::nullopt;
+        case VertexFormat::Kind::Uint:
+        case VertexFormat::Kind::Sint:
+            return result.bits == 8 || result.bits == 16 || result.bits == 32
+                       ? std::optional(result)
+                       : std::nullopt;
+        case VertexFormat::Kind::Float:
+            return result.bits == 16 || result.bits == 32 ? std::optional(result)
+                                                          : std::nullopt;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<VertexFormat> DefaultVertexFormat(const ShaderType& type) {
+    VertexFormat result;
+    result.bits = 32;
+    result.components = type.vectorSize;
+
+    switch (type.basicType) {
+        case glslang::EbtFloat:
+            result.kind = VertexFormat::Kind::Float;
+            return result;
+        case glslang::EbtInt:
+            result.kind = VertexFormat::Kind::Sint;
+            return result;
+        case glslang::EbtUint:
+            result.kind = VertexFormat::Kind::Uint;
+            return result;
+        default:
+            return std::nullopt;
+    }
+}
+
+bool IsCompatibleVertexFormat(const VertexFormat& format, const ShaderType& type) {
+    switch (type.basicType) {
+        case glslang::EbtFloat:
+            return format.kind == VertexFormat::Kind::Unorm ||
+                   format.kind == VertexFormat::Kind::Snorm ||
+                   format.kind == VertexFormat::Kind::Float;
+        case glslang::EbtInt:
+            return format.kind == VertexFormat::Kind::Sint;
+        case glslang::EbtUint:
+            return format.kind == VertexFormat::Kind::Uint;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "reflection.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <stdint.h>
+
+// How a vertex attribute is stored in a vertex buffer.
+struct VertexFormat {
+    enum class Kind {
+        Unorm,
+        Snorm,
+        Uint,
+        Sint,
+        Float,
+    };
+
+    Kind kind = Kind::Float;
+    // Bits per component: 8, 16 or 32.
+    int bits = 32;
+    // Components, 1 to 4. 0 in a parsed format means as many as the attribute has.
+    int components = 0;
+
+    int size() const {
+        return bits / 8 * components;
+    }
+
+    // The VkFormat value and its name, e.g. 37 and VK_FORMAT_R8G8B8A8_UNORM.
+    uint32_t vkFormat() const;
+    std::string vkFormatName() const;
+
+    // The C type of one component, e.g. uint8_t. 16-bit floats are stored as uint16_t.
+    const char* componentType() const;
+
+    // The name ParseVertexFormat accepts, e.g. unorm8x4.
+    std::string name() const;
+};
+
+// Parses a format written as <kind><bits>[x<components>], where kind is unorm, snorm, uint,
+// sint or float, e.g. unorm8x4 or float16x2. half is short for float16. Without a component
+// count the format has as many components as the attribute. Returns std::nullopt if the
+// format doesn't exist.
+std::optional<VertexFormat> ParseVertexFormat(std::string_view format);
+
+// The format a vector or scalar input is read from by default: 32-bit components of its own
+// type. Returns std::nullopt for types that can't be vertex inputs, such as doubles.
+std::optional<VertexFormat> DefaultVertexFormat(const ShaderType& type);
+
+// Whether a vector or scalar input can be read from format. Float inputs take normalized and
+// float formats, integer inputs integer formats of the same signedness.
+bool IsCompatibleVertexFormat(const VertexFormat& format, const ShaderType& type);
@@ -0,0 +1,128 @@
+#include "watch.h"
+#include "log.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// Every way an editor can leave a new version of a file behind.
+static const uint32_t s_watchMask =
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM;
+
+std::string WatchKey(const std::string& path) {
+    return std::filesystem::path(path).lexically_normal().string();
+}
+
+FileWatcher::FileWatcher() {
+    fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (fd < 0) {
+        Print("Failed to set up inotify: %s\n", strerror(errno));
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool FileWatcher::watch(const std::string& path) {
+    std::string key = WatchKey(path);
+    if (!files.insert(key).second) {
+        return true;
+    }
+
+    std::string directory = std::filesystem::path(key).parent_path().string();
+    if (directoryWatches.count(directory) != 0) {
+        return true;
+    }
+
+    int wd = inotify_add_watch(fd, directory.empty() ? "." : directory.c_str(), s_watchMask);
+    if (wd < 0) {
+        Print("Failed to watch %s: %s\n", directory.c_str(), strerror(errno));
+        files.erase(key);
+        return false;
+    }
+
+    directories[wd] = directory;
+    directoryWatches[directory] = wd;
+    return true;
+}
+
+bool FileWatcher::readEvents(std::unordered_set<std::string>& changed) {
+    alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+
+    while (true) {
+        ssize_t size = read(fd, buffer, sizeof(buffer));
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (size < 0 && errno == EAGAIN) {
+            return true;
+        }
+        if (size <= 0) {
+            Print("Failed to read file changes: %s\n", strerror(errno));
+            return false;
+        }
+
+        for (char* next = buffer; next < buffer + size;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(next);
+            next += sizeof(inotify_event) + event->len;
+
+            auto directory = directories.find(event->wd);
+            if (directory == directories.end() || event->len == 0) {
+                continue;
+            }
+
+            std::string key = WatchKey(
+                (std::filesystem::path(directory->second) / event->name).string()
+            );
+            if (files.count(key) != 0) {
+                changed.insert(key);
+            }
+        }
+    }
+}
+
+std::vector<std::string> FileWatcher::wait(
+    std::chrono::milliseconds debounce,
+    std::chrono::steady_clock::time_point& firstChange
+) {
+    std::unordered_set<std::string> changed;
+
+    // Wait indefinitely for the first change, then only as long as changes keep coming.
+    int timeout = -1;
+    while (true) {
+        pollfd pollFd = { fd, POLLIN, 0 };
+        int ready = poll(&pollFd, 1, timeout);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready < 0) {
+            Print("Failed to wait for file changes: %s\n", strerror(errno));
+            return {};
+        }
+        if (ready == 0) {
+            break;
+        }
+
+        if (!readEvents(changed)) {
+            return {};
+        }
+
+        if (!changed.empty() && timeout < 0) {
+            firstChange = std::chrono::steady_clock::now();
+            timeout = static_cast<int>(debounce.count());
+        }
+    }
+
+    std::vector<std::string> result(changed.begin(), changed.end());
+    std::sort(result.begin(), result.end());
+    return result;
+}
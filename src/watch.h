@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Watches files for changes with inotify. Files are watched through their directories, so
+// files that editors save by writing a temporary file and renaming it over the old one are
+// seen too, as are files that don't exist yet.
+class FileWatcher {
+  public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Whether inotify could be set up. Prints why if not.
+    bool valid() const {
+        return fd >= 0;
+    }
+
+    // Starts watching a file, if it isn't watched already. Returns false if its directory
+    // can't be watched.
+    bool watch(const std::string& path);
+
+    // Blocks until a watched file changes, then collects changes until none arrive for
+    // debounce, so a burst of saves is handled at once. Returns every changed file, named as
+    // WatchKey names it, and sets firstChange to when the first was seen. Returns an empty
+    // list if reading events fails.
+    std::vector<std::string> wait(
+        std::chrono::milliseconds debounce,
+        std::chrono::steady_clock::time_point& firstChange
+    );
+
+  private:
+    int fd;
+    // Watched directories by watch descriptor, and the other way around.
+    std::unordered_map<int, std::string> directories;
+    std::unordered_map<std::string, int> directoryWatches;
+    std::unordered_set<std::string> files;
+
+    // Reads pending events, adding changed watched files to changed. Returns false on error.
+    bool readEvents(std::unordered_set<std::string>& changed);
+};
+
+// The name FileWatcher reports a path by, which is the same for every spelling of it.
+std::string WatchKey(const std::string& path);